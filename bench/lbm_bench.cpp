@@ -0,0 +1,532 @@
+// Steady-state throughput of the headless solvers over a matrix of scenarios. Every scenario
+// gets a fresh device or host solver and lattice, runs warm-up steps and then a number of timed
+// repetitions. Results are printed and optionally written as CSV and JSON.
+
+#include "common/appcontext.h"
+#include "core/vulkan/context.h"
+#include "logs/log.h"
+#include "rocket/cpusolver.h"
+#include "rocket/simu.h"
+
+#include "boost/program_options.hpp"
+#include "fmt/format.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace po = boost::program_options;
+
+namespace
+{
+
+struct Scenario
+{
+    params::SolverEngine engine = params::SolverEngine::Lbm;
+    params::SolverBackend backend = params::SolverBackend::Gpu;
+    int width = 0;
+    int height = 0;
+    params::SolverKernel kernel = params::SolverKernel::Fused;
+    params::CollisionOperator collision = params::CollisionOperator::Bgk;
+    // Pressure solve of the Stable Fluids engine, reported in place of the kernel
+    params::PressureSolver pressureSolver = params::PressureSolver::Jacobi;
+    params::PressurePreconditioner pressurePreconditioner =
+            params::PressurePreconditioner::IncompletePoisson;
+    params::LatticeLayout layout = params::LatticeLayout::SoA;
+    // Workgroup shape of the lattice Boltzmann GPU shaders
+    uint32_t workgroupWidth = 16;
+    uint32_t workgroupHeight = 16;
+    uint64_t steps = 0;
+    // Temporal blocking depth of the CPU backend
+    uint32_t depth = 1;
+};
+
+struct Result
+{
+    Scenario scenario;
+    double medianSeconds = 0.0;
+    double minSeconds = 0.0;
+    double mlups = 0.0;
+    double gbps = 0.0;
+    double msPerStep = 0.0;
+};
+
+auto split(std::string const& list) -> std::vector<std::string>
+{
+    auto items = std::vector<std::string>{};
+    auto stream = std::stringstream(list);
+    auto item = std::string{};
+    while(std::getline(stream, item, ','))
+    {
+        if(!item.empty())
+        {
+            items.push_back(item);
+        }
+    }
+    return items;
+}
+
+auto engineName(params::SolverEngine engine) -> char const*
+{
+    return engine == params::SolverEngine::StableFluids ? "stablefluids" : "lbm";
+}
+
+auto backendName(params::SolverBackend backend) -> char const*
+{
+    return backend == params::SolverBackend::Cpu ? "cpu" : "gpu";
+}
+
+auto kernelName(Scenario const& scenario) -> char const*
+{
+    if(scenario.engine == params::SolverEngine::StableFluids)
+    {
+        switch(scenario.pressureSolver)
+        {
+        case params::PressureSolver::Jacobi: return "jacobi";
+        case params::PressureSolver::Multigrid: return "multigrid";
+        case params::PressureSolver::ConjugateGradient:
+            return scenario.pressurePreconditioner == params::PressurePreconditioner::Jacobi
+                           ? "pcg-jacobi"
+                           : "pcg-poisson";
+        }
+        return "unknown";
+    }
+
+    switch(scenario.kernel)
+    {
+    case params::SolverKernel::MultiPass: return "multipass";
+    case params::SolverKernel::Fused: return "fused";
+    case params::SolverKernel::InPlaceAA: return "aa";
+    }
+    return "unknown";
+}
+
+// Sets the pressure solver, and the preconditioner for conjugate gradient
+auto parsePressureSolver(std::string const& name, Scenario& scenario) -> void
+{
+    if(name == "jacobi")
+    {
+        scenario.pressureSolver = params::PressureSolver::Jacobi;
+    }
+    else if(name == "multigrid")
+    {
+        scenario.pressureSolver = params::PressureSolver::Multigrid;
+    }
+    else if(name == "pcg-jacobi" || name == "pcg-poisson")
+    {
+        scenario.pressureSolver = params::PressureSolver::ConjugateGradient;
+        scenario.pressurePreconditioner =
+                name == "pcg-jacobi" ? params::PressurePreconditioner::Jacobi
+                                     : params::PressurePreconditioner::IncompletePoisson;
+    }
+    else
+    {
+        throw std::invalid_argument("Unknown pressure solver: " + name);
+    }
+}
+
+auto layoutName(params::LatticeLayout layout) -> char const*
+{
+    return layout == params::LatticeLayout::SoA ? "soa" : "aos";
+}
+
+auto parseEngine(std::string const& name) -> params::SolverEngine
+{
+    if(name == "lbm")
+        return params::SolverEngine::Lbm;
+    if(name == "stablefluids")
+        return params::SolverEngine::StableFluids;
+    throw std::invalid_argument("Unknown engine: " + name);
+}
+
+auto parseBackend(std::string const& name) -> params::SolverBackend
+{
+    if(name == "gpu")
+        return params::SolverBackend::Gpu;
+    if(name == "cpu")
+        return params::SolverBackend::Cpu;
+    throw std::invalid_argument("Unknown backend: " + name);
+}
+
+auto parseIsa(std::string const& name) -> params::CpuIsa
+{
+    using params::CpuIsa;
+    for(auto isa : {CpuIsa::Auto, CpuIsa::Scalar, CpuIsa::Avx2, CpuIsa::Avx512})
+    {
+        if(name == app::simu::cpu::isaName(isa))
+            return isa;
+    }
+    throw std::invalid_argument("Unknown instruction set: " + name);
+}
+
+auto parseKernel(std::string const& name) -> params::SolverKernel
+{
+    if(name == "multipass")
+        return params::SolverKernel::MultiPass;
+    if(name == "fused")
+        return params::SolverKernel::Fused;
+    if(name == "aa")
+        return params::SolverKernel::InPlaceAA;
+    throw std::invalid_argument("Unknown kernel: " + name);
+}
+
+auto collisionName(params::CollisionOperator collision) -> char const*
+{
+    switch(collision)
+    {
+    case params::CollisionOperator::Bgk: return "bgk";
+    case params::CollisionOperator::Trt: return "trt";
+    case params::CollisionOperator::Mrt: return "mrt";
+    }
+    return "unknown";
+}
+
+auto parseCollision(std::string const& name) -> params::CollisionOperator
+{
+    if(name == "bgk")
+        return params::CollisionOperator::Bgk;
+    if(name == "trt")
+        return params::CollisionOperator::Trt;
+    if(name == "mrt")
+        return params::CollisionOperator::Mrt;
+    throw std::invalid_argument("Unknown collision operator: " + name);
+}
+
+auto workgroupName(Scenario const& scenario) -> std::string
+{
+    return fmt::format("{}x{}", scenario.workgroupWidth, scenario.workgroupHeight);
+}
+
+auto parseWorkgroup(std::string const& name, Scenario& scenario) -> void
+{
+    auto const x = name.find('x');
+    if(x == std::string::npos)
+    {
+        throw std::invalid_argument("Workgroup must be WxH: " + name);
+    }
+    scenario.workgroupWidth = static_cast<uint32_t>(std::stoul(name.substr(0, x)));
+    scenario.workgroupHeight = static_cast<uint32_t>(std::stoul(name.substr(x + 1)));
+    if(scenario.workgroupWidth == 0 || scenario.workgroupHeight == 0)
+    {
+        throw std::invalid_argument("Empty workgroup: " + name);
+    }
+}
+
+auto parseLayout(std::string const& name) -> params::LatticeLayout
+{
+    if(name == "soa")
+        return params::LatticeLayout::SoA;
+    if(name == "aos")
+        return params::LatticeLayout::AoS;
+    throw std::invalid_argument("Unknown layout: " + name);
+}
+
+auto run(Scenario const& scenario, params::CpuIsa isa, uint64_t warmup, uint32_t repetitions)
+        -> Result
+{
+    auto parameters = params::Params{};
+    parameters.simulationConfig.engine = scenario.engine;
+    parameters.simulationConfig.backend = scenario.backend;
+    parameters.simulationConfig.gridWidth = scenario.width;
+    parameters.simulationConfig.gridHeight = scenario.height;
+    parameters.simulationConfig.kernel = scenario.kernel;
+    parameters.simulationConfig.collision = scenario.collision;
+    parameters.simulationConfig.pressureSolver = scenario.pressureSolver;
+    parameters.simulationConfig.pressurePreconditioner = scenario.pressurePreconditioner;
+    parameters.simulationConfig.layout = scenario.layout;
+    parameters.simulationConfig.workgroupWidth = scenario.workgroupWidth;
+    parameters.simulationConfig.workgroupHeight = scenario.workgroupHeight;
+    parameters.simulationConfig.cpuIsa = isa;
+    parameters.simulationConfig.cpuTemporalDepth = scenario.depth;
+
+    auto seconds = std::vector<double>{};
+    auto measure = [&](auto&& simulate) {
+        if(warmup > 0)
+        {
+            simulate(warmup);
+        }
+        for(uint32_t i = 0; i < repetitions; ++i)
+        {
+            seconds.push_back(simulate(scenario.steps));
+        }
+    };
+
+    if(scenario.backend == params::SolverBackend::Cpu)
+    {
+        auto solver = app::simu::CpuSolver(parameters.simulationConfig);
+        measure([&](uint64_t steps) { return app::simu::timedSimulate(solver, steps); });
+    }
+    else
+    {
+        auto appContext = std::make_shared<app::AppContext>(parameters);
+        auto context = app::vk::Context(appContext);
+        context.initHeadless();
+        measure([&](uint64_t steps) { return context.simulate(steps); });
+    }
+    std::sort(seconds.begin(), seconds.end());
+
+    auto result = Result{};
+    result.scenario = scenario;
+    result.medianSeconds = seconds[seconds.size() / 2];
+    result.minSeconds = seconds.front();
+
+    auto const cells = static_cast<double>(scenario.width) * scenario.height;
+    auto const updates = cells * static_cast<double>(scenario.steps);
+    auto const bytes = updates
+                       * static_cast<double>(app::simu::Simu::modelledBytesPerCell(
+                               parameters.simulationConfig));
+
+    result.mlups = updates / result.medianSeconds * 1e-6;
+    result.gbps = bytes / result.medianSeconds * 1e-9;
+    result.msPerStep = result.medianSeconds / static_cast<double>(scenario.steps) * 1e3;
+
+    return result;
+}
+
+auto writeCsv(std::string const& path, std::vector<Result> const& results) -> void
+{
+    auto file = std::ofstream(path, std::ios::trunc);
+    file << "engine,backend,width,height,kernel,collision,workgroup,layout,depth,steps,"
+            "median_s,min_s,mlups,gbps,ms_per_step\n";
+    for(auto const& r : results)
+    {
+        file << fmt::format(
+                "{},{},{},{},{},{},{},{},{},{},{:.6f},{:.6f},{:.3f},{:.3f},{:.6f}\n",
+                engineName(r.scenario.engine),
+                backendName(r.scenario.backend),
+                r.scenario.width,
+                r.scenario.height,
+                kernelName(r.scenario),
+                collisionName(r.scenario.collision),
+                workgroupName(r.scenario),
+                layoutName(r.scenario.layout),
+                r.scenario.depth,
+                r.scenario.steps,
+                r.medianSeconds,
+                r.minSeconds,
+                r.mlups,
+                r.gbps,
+                r.msPerStep);
+    }
+}
+
+auto writeJson(std::string const& path, std::vector<Result> const& results) -> void
+{
+    auto file = std::ofstream(path, std::ios::trunc);
+    file << "[";
+    for(size_t i = 0; i < results.size(); ++i)
+    {
+        auto const& r = results[i];
+        file << fmt::format(
+                "{}\n  {{\"engine\": \"{}\", \"backend\": \"{}\", \"width\": {}, \"height\": {}, "
+                "\"kernel\": \"{}\", \"collision\": \"{}\", \"workgroup\": \"{}\", "
+                "\"layout\": \"{}\", \"depth\": {}, \"steps\": {}, \"median_s\": {:.6f}, "
+                "\"min_s\": {:.6f}, \"mlups\": {:.3f}, \"gbps\": {:.3f}, \"ms_per_step\": {:.6f}}}",
+                i == 0 ? "" : ",",
+                engineName(r.scenario.engine),
+                backendName(r.scenario.backend),
+                r.scenario.width,
+                r.scenario.height,
+                kernelName(r.scenario),
+                collisionName(r.scenario.collision),
+                workgroupName(r.scenario),
+                layoutName(r.scenario.layout),
+                r.scenario.depth,
+                r.scenario.steps,
+                r.medianSeconds,
+                r.minSeconds,
+                r.mlups,
+                r.gbps,
+                r.msPerStep);
+    }
+    file << "\n]\n";
+}
+
+} // namespace
+
+auto main(int argc, char** argv) -> int
+{
+    auto engines = std::string{"lbm"};
+    auto backends = std::string{"gpu"};
+    auto grids = std::string{"256x64,1024x256,2048x512"};
+    auto kernels = std::string{"multipass,fused,aa"};
+    auto collisions = std::string{"bgk"};
+    auto workgroups = std::string{"16x16"};
+    auto pressureSolvers = std::string{"jacobi,multigrid,pcg-jacobi,pcg-poisson"};
+    auto layouts = std::string{"aos,soa"};
+    auto steps = std::string{"500"};
+    auto isa = std::string{"auto"};
+    auto depths = std::string{"1"};
+    uint64_t warmup = 100;
+    uint32_t repetitions = 5;
+    auto csvPath = std::string{};
+    auto jsonPath = std::string{};
+
+    auto description = po::options_description("lbm_bench options");
+    description.add_options()("help,h", "Show this help")(
+            "engines", po::value(&engines)->default_value(engines), "lbm, stablefluids")(
+            "backends", po::value(&backends)->default_value(backends), "gpu, cpu")(
+            "grids", po::value(&grids)->default_value(grids), "Grid sizes, WxH comma separated")(
+            "kernels", po::value(&kernels)->default_value(kernels), "multipass, fused, aa")(
+            "collisions",
+            po::value(&collisions)->default_value(collisions),
+            "Lattice Boltzmann GPU collision operators: bgk, trt, mrt")(
+            "workgroups",
+            po::value(&workgroups)->default_value(workgroups),
+            "Lattice Boltzmann GPU workgroup shapes, WxH comma separated")(
+            "pressure-solvers",
+            po::value(&pressureSolvers)->default_value(pressureSolvers),
+            "Stable Fluids pressure solvers: jacobi, multigrid, pcg-jacobi, pcg-poisson")(
+            "layouts", po::value(&layouts)->default_value(layouts), "aos, soa")(
+            "steps", po::value(&steps)->default_value(steps), "Timed steps per repetition")(
+            "warmup", po::value(&warmup)->default_value(warmup), "Untimed steps per scenario")(
+            "isa",
+            po::value(&isa)->default_value(isa),
+            "CPU backend instruction set: auto, scalar, avx2, avx512")(
+            "depths",
+            po::value(&depths)->default_value(depths),
+            "CPU backend temporal blocking depths, comma separated")(
+            "repetitions",
+            po::value(&repetitions)->default_value(repetitions),
+            "Timed repetitions, the median is reported")(
+            "csv", po::value(&csvPath), "Write results as CSV")(
+            "json", po::value(&jsonPath), "Write results as JSON");
+
+    auto vm = po::variables_map{};
+    auto cpuIsa = params::CpuIsa::Auto;
+    auto scenarios = std::vector<Scenario>{};
+    try
+    {
+        po::store(po::parse_command_line(argc, argv, description), vm);
+        po::notify(vm);
+
+        if(vm.count("help"))
+        {
+            std::cout << description << "\n";
+            return EXIT_SUCCESS;
+        }
+
+        for(auto const& engine : split(engines))
+        {
+            for(auto const& backend : split(backends))
+            {
+                for(auto const& grid : split(grids))
+                {
+                    auto const x = grid.find('x');
+                    if(x == std::string::npos)
+                    {
+                        throw std::invalid_argument("Grid must be WxH: " + grid);
+                    }
+
+                    auto scenario = Scenario{};
+                    scenario.engine = parseEngine(engine);
+                    scenario.backend = parseBackend(backend);
+                    scenario.width = std::stoi(grid.substr(0, x));
+                    scenario.height = std::stoi(grid.substr(x + 1));
+
+                    // Stable Fluids only runs on the GPU with its own field layout, the CPU
+                    // backend always runs the fused kernel over SoA planes
+                    auto const fluids = scenario.engine == params::SolverEngine::StableFluids;
+                    auto const cpu = scenario.backend == params::SolverBackend::Cpu;
+                    if(fluids && cpu)
+                    {
+                        continue;
+                    }
+                    auto const single = cpu || fluids;
+                    auto const kernelList = fluids ? split(pressureSolvers)
+                                            : cpu  ? std::vector<std::string>{"fused"}
+                                                   : split(kernels);
+                    auto const layoutList =
+                            single ? std::vector<std::string>{"soa"} : split(layouts);
+                    auto const depthList = cpu ? split(depths) : std::vector<std::string>{"1"};
+                    // Only the lattice Boltzmann GPU kernels have a choice of collision and
+                    // workgroup shape
+                    auto const collisionList =
+                            single ? std::vector<std::string>{"bgk"} : split(collisions);
+                    auto const workgroupList =
+                            single ? std::vector<std::string>{"16x16"} : split(workgroups);
+
+                    for(auto const& kernel : kernelList)
+                    {
+                        if(fluids)
+                        {
+                            parsePressureSolver(kernel, scenario);
+                        }
+                        else
+                        {
+                            scenario.kernel = parseKernel(kernel);
+                        }
+                        for(auto const& collision : collisionList)
+                        {
+                            scenario.collision = parseCollision(collision);
+                            for(auto const& workgroup : workgroupList)
+                            {
+                                parseWorkgroup(workgroup, scenario);
+                                for(auto const& layout : layoutList)
+                                {
+                                    scenario.layout = parseLayout(layout);
+                                    for(auto const& depth : depthList)
+                                    {
+                                        scenario.depth =
+                                                static_cast<uint32_t>(std::stoul(depth));
+                                        for(auto const& count : split(steps))
+                                        {
+                                            scenario.steps = std::stoull(count);
+                                            scenarios.push_back(scenario);
+                                        }
+                                    }
+                                }
+                            }
+                        }
+                    }
+                }
+            }
+        }
+        cpuIsa = parseIsa(isa);
+    }
+    catch(std::exception const& e)
+    {
+        std::cerr << e.what() << "\n" << description << "\n";
+        return EXIT_FAILURE;
+    }
+
+    auto log = logs::getLogger("lbm_bench");
+    auto results = std::vector<Result>{};
+
+    for(auto const& scenario : scenarios)
+    {
+        auto const result = run(scenario, cpuIsa, warmup, std::max(repetitions, 1u));
+        log->info(
+                "{} {} {}x{} {} {} {} {} depth {} {} steps: {:.1f} MLUPS, {:.1f} GB/s, {:.4f} "
+                "ms/step",
+                engineName(scenario.engine),
+                backendName(scenario.backend),
+                scenario.width,
+                scenario.height,
+                kernelName(scenario),
+                collisionName(scenario.collision),
+                workgroupName(scenario),
+                layoutName(scenario.layout),
+                scenario.depth,
+                scenario.steps,
+                result.mlups,
+                result.gbps,
+                result.msPerStep);
+        results.push_back(result);
+    }
+
+    if(!csvPath.empty())
+    {
+        writeCsv(csvPath, results);
+    }
+    if(!jsonPath.empty())
+    {
+        writeJson(jsonPath, results);
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,180 @@
+#extension GL_KHR_shader_subgroup_basic : enable
+#extension GL_KHR_shader_subgroup_arithmetic : enable
+
+// Preconditioned conjugate gradient solve of the pressure Poisson equation. The matrix is the
+// negated Laplacian of stablefluids.glsl, so it is symmetric positive definite, and is never
+// stored: every product applies the stencil with the same boundary conditions. The vectors
+// follow the solid plane (residual, preconditioned residual, search direction and the product
+// of the matrix with it), then the solver state: two partial sums per workgroup, the scalars
+// of the iteration and two sets of indirect dispatch arguments, the full grid and a single
+// workgroup, both cleared once the residual norm is below tolerance.
+const uint PLANE_CG_RESIDUAL = PLANE_SOLID + 1;
+const uint PLANE_CG_PRECONDITIONED = PLANE_CG_RESIDUAL + 1;
+const uint PLANE_CG_DIRECTION = PLANE_CG_PRECONDITIONED + 1;
+const uint PLANE_CG_PRODUCT = PLANE_CG_DIRECTION + 1;
+
+const uint CG_RZ = 0;
+const uint CG_ALPHA = 1;
+const uint CG_BETA = 2;
+const uint CG_NORM = 3;
+const uint CG_SCALARS = 4;
+
+// The dispatch arguments are read as integers, aliasing the float planes
+layout(std430, binding = 1) buffer FieldWords
+{
+    uint words[];
+};
+
+float loadVector(uint plane, uint index)
+{
+    return planes[plane * cellCount() + index];
+}
+
+void storeVector(uint plane, uint index, float value)
+{
+    planes[plane * cellCount() + index] = value;
+}
+
+uvec2 groupCount()
+{
+    return uvec2((ubo.gridSize + 15) / 16);
+}
+
+uint partialsBase()
+{
+    return (PLANE_CG_PRODUCT + 1) * cellCount();
+}
+
+uint scalarsBase()
+{
+    uvec2 groups = groupCount();
+    return partialsBase() + 2 * groups.x * groups.y;
+}
+
+uint argumentsBase()
+{
+    return scalarsBase() + CG_SCALARS;
+}
+
+// Neighbours inside the domain that are not walls, the off-diagonal entries of the matrix
+bool isUnknown(ivec2 pos)
+{
+    if(pos.x < 0 || pos.y < 0 || pos.x >= ubo.gridSize.x || pos.y >= ubo.gridSize.y)
+    {
+        return false;
+    }
+    return !isWall(pos, cellIndex(pos));
+}
+
+// Same boundary conditions as neighbourPressure, for any vector
+float neighbourValue(uint plane, ivec2 pos, float centre)
+{
+    if(pos.x >= ubo.gridSize.x)
+    {
+        return -centre;
+    }
+    return isUnknown(pos) ? loadVector(plane, cellIndex(pos)) : centre;
+}
+
+float applyMatrix(uint plane, ivec2 pos, uint index)
+{
+    float centre = loadVector(plane, index);
+    return 4.0 * centre - neighbourValue(plane, pos + ivec2(-1, 0), centre)
+           - neighbourValue(plane, pos + ivec2(1, 0), centre)
+           - neighbourValue(plane, pos + ivec2(0, -1), centre)
+           - neighbourValue(plane, pos + ivec2(0, 1), centre);
+}
+
+// Diagonal of the matrix: one per unknown neighbour and two for the outflow face, mirrored
+// neighbours cancel against the centre
+float diagonal(ivec2 pos)
+{
+    float d = pos.x == ubo.gridSize.x - 1 ? 2.0 : 0.0;
+    d += isUnknown(pos + ivec2(-1, 0)) ? 1.0 : 0.0;
+    d += isUnknown(pos + ivec2(1, 0)) ? 1.0 : 0.0;
+    d += isUnknown(pos + ivec2(0, -1)) ? 1.0 : 0.0;
+    d += isUnknown(pos + ivec2(0, 1)) ? 1.0 : 0.0;
+    return d;
+}
+
+// Enclosed fluid pockets without an outflow have a zero diagonal, they are left alone
+float inverseDiagonal(ivec2 pos)
+{
+    float d = diagonal(pos);
+    return d > 0.0 ? 1.0 / d : 0.0;
+}
+
+shared vec2 subgroupSums[gl_WorkGroupSize.x * gl_WorkGroupSize.y];
+
+// Sum over the workgroup: subgroup additions, then a tree over the subgroup sums in shared
+// memory. Every invocation has to call it.
+vec2 workgroupSum(vec2 value)
+{
+    value = subgroupAdd(value);
+    if(subgroupElect())
+    {
+        subgroupSums[gl_SubgroupID] = value;
+    }
+    barrier();
+
+    for(uint count = gl_NumSubgroups; count > 1; count = (count + 1) / 2)
+    {
+        uint upper = (count + 1) / 2;
+        if(gl_LocalInvocationIndex < count / 2)
+        {
+            subgroupSums[gl_LocalInvocationIndex] += subgroupSums[gl_LocalInvocationIndex + upper];
+        }
+        barrier();
+    }
+    return subgroupSums[0];
+}
+
+// First pass of a reduction, one pair of partial sums per workgroup
+void storePartials(vec2 value)
+{
+    vec2 sum = workgroupSum(value);
+    if(gl_LocalInvocationIndex == 0)
+    {
+        uint group = gl_WorkGroupID.y * gl_NumWorkGroups.x + gl_WorkGroupID.x;
+        planes[partialsBase() + 2 * group] = sum.x;
+        planes[partialsBase() + 2 * group + 1] = sum.y;
+    }
+}
+
+// Second pass, run as a single workgroup over the partials of the first
+vec2 sumPartials()
+{
+    uvec2 groups = groupCount();
+    uint partials = groups.x * groups.y;
+    uint stride = gl_WorkGroupSize.x * gl_WorkGroupSize.y;
+
+    vec2 sum = vec2(0.0);
+    for(uint i = gl_LocalInvocationIndex; i < partials; i += stride)
+    {
+        sum += vec2(planes[partialsBase() + 2 * i], planes[partialsBase() + 2 * i + 1]);
+    }
+    return workgroupSum(sum);
+}
+
+float loadScalar(uint scalar)
+{
+    return planes[scalarsBase() + scalar];
+}
+
+void storeScalar(uint scalar, float value)
+{
+    planes[scalarsBase() + scalar] = value;
+}
+
+// Dispatch arguments of the remaining passes, nothing once the solve has stopped
+void storeArguments(bool stop)
+{
+    uvec2 groups = stop ? uvec2(0) : groupCount();
+    uint base = argumentsBase();
+    words[base] = groups.x;
+    words[base + 1] = groups.y;
+    words[base + 2] = 1;
+    words[base + 3] = stop ? 0 : 1;
+    words[base + 4] = 1;
+    words[base + 5] = 1;
+}
@@ -1,5 +1,20 @@
 #extension GL_ARB_enhanced_layouts : enable
-layout(local_size_x = 16, local_size_y = 16, local_size_z = 1) in;
+
+// Constants of a run, specialized when the pipelines are created (LatticeSpecialization in
+// simu.h) so the driver folds them: the workgroup shape, the lattice size and the collision
+// model. The operator is one of the COLLISION_* constants of lbm.glsl, a positive Smagorinsky
+// constant turns on the eddy viscosity.
+layout(local_size_x_id = 0, local_size_y_id = 1, local_size_z = 1) in;
+layout(constant_id = 2) const int GRID_WIDTH = 1;
+layout(constant_id = 3) const int GRID_HEIGHT = 1;
+layout(constant_id = 4) const float TAU = 0.85;
+layout(constant_id = 5) const int COLLISION = 0;
+layout(constant_id = 6) const float TRT_MAGIC = 0.25;
+layout(constant_id = 7) const float MRT_BULK_RATE = 1.4;
+layout(constant_id = 8) const float MRT_FLUX_RATE = 1.2;
+layout(constant_id = 9) const float SMAGORINSKY = 0.0;
+
+const ivec2 GRID_SIZE = ivec2(GRID_WIDTH, GRID_HEIGHT);
 
 layout(binding = 0) uniform UniformBufferObject
 {
@@ -10,6 +25,8 @@ layout(binding = 0) uniform UniformBufferObject
 }
 ubo;
 
+// Register representation of a single cell. With the AoS layout this is also the storage
+// record, with the SoA layout the fields are gathered from / scattered to separate planes.
 struct GridCell
 {
     vec2 velocity;
@@ -18,22 +35,163 @@ struct GridCell
     float distribution[9];
     int pad;
 };
+
+#ifdef LATTICE_SOA
+// Structure-of-arrays layout. The buffer is split into planes of gridSize.x * gridSize.y
+// floats: velocity.x, velocity.y, density and the solid flag first, then one plane for each of
+// the nine populations. Reading one population of neighbouring cells is a coalesced read of a
+// single plane.
+const uint MACRO_PLANES = 4;
+const uint PLANE_VELOCITY_X = 0;
+const uint PLANE_VELOCITY_Y = 1;
+const uint PLANE_DENSITY = 2;
+const uint PLANE_SOLID = 3;
+
+layout(std430, binding = 1) buffer Grid
+{
+    float planes[];
+};
+#else
 layout(std430, binding = 1) buffer Grid
 {
     layout(align = 16) GridCell data[];
 };
+#endif
 
+// Buffer offsets are counted in cells for both layouts. Parity selects the even or odd step of
+// the in-place AA kernel, the flow statistics reuse it for where the populations are. The output
+// offset is the word of a readback ring the compression or statistics passes write to.
 layout(push_constant) uniform PushConstants
 {
     uint readBufferOffset;
     uint writeBufferOffset;
+    uint parity;
+    uint outputOffset;
 } pc;
 
-GridCell getCell(ivec2 pos, ivec2 offset)
+uint cellCount()
+{
+    return uint(GRID_SIZE.x * GRID_SIZE.y);
+}
+
+#ifdef LATTICE_SOA
+uint macroIndex(uint plane, uint index)
+{
+    return plane * cellCount() + index;
+}
+
+uint distributionIndex(uint offset, uint index, int i)
+{
+    return (MACRO_PLANES + uint(i)) * cellCount() + 9 * offset + index;
+}
+#endif
+
+float loadDistribution(uint offset, uint index, int i)
+{
+#ifdef LATTICE_SOA
+    return planes[distributionIndex(offset, index, i)];
+#else
+    return data[offset + index].distribution[i];
+#endif
+}
+
+void storeDistribution(uint offset, uint index, int i, float value)
+{
+#ifdef LATTICE_SOA
+    planes[distributionIndex(offset, index, i)] = value;
+#else
+    data[offset + index].distribution[i] = value;
+#endif
+}
+
+vec2 loadVelocity(uint offset, uint index)
+{
+#ifdef LATTICE_SOA
+    return vec2(
+            planes[macroIndex(PLANE_VELOCITY_X, index)],
+            planes[macroIndex(PLANE_VELOCITY_Y, index)]);
+#else
+    return data[offset + index].velocity;
+#endif
+}
+
+float loadDensity(uint offset, uint index)
+{
+#ifdef LATTICE_SOA
+    return planes[macroIndex(PLANE_DENSITY, index)];
+#else
+    return data[offset + index].density;
+#endif
+}
+
+int loadSolid(uint offset, uint index)
+{
+#ifdef LATTICE_SOA
+    return int(planes[macroIndex(PLANE_SOLID, index)]);
+#else
+    return data[offset + index].solid;
+#endif
+}
+
+void storeSolid(uint offset, uint index, int solid)
+{
+#ifdef LATTICE_SOA
+    planes[macroIndex(PLANE_SOLID, index)] = float(solid);
+#else
+    data[offset + index].solid = solid;
+#endif
+}
+
+void storeMacro(uint offset, uint index, vec2 velocity, float density)
+{
+#ifdef LATTICE_SOA
+    planes[macroIndex(PLANE_VELOCITY_X, index)] = velocity.x;
+    planes[macroIndex(PLANE_VELOCITY_Y, index)] = velocity.y;
+    planes[macroIndex(PLANE_DENSITY, index)] = density;
+#else
+    data[offset + index].velocity = velocity;
+    data[offset + index].density = density;
+#endif
+}
+
+GridCell loadCell(uint offset, uint index)
+{
+#ifdef LATTICE_SOA
+    GridCell cell;
+    cell.velocity = loadVelocity(offset, index);
+    cell.density = loadDensity(offset, index);
+    cell.solid = loadSolid(offset, index);
+    for(int i = 0; i < 9; ++i)
+    {
+        cell.distribution[i] = loadDistribution(offset, index, i);
+    }
+    cell.pad = 0;
+    return cell;
+#else
+    return data[offset + index];
+#endif
+}
+
+void storeDistributions(uint offset, uint index, GridCell cell)
+{
+#ifdef LATTICE_SOA
+    for(int i = 0; i < 9; ++i)
+    {
+        storeDistribution(offset, index, i, cell.distribution[i]);
+    }
+#else
+    data[offset + index].distribution = cell.distribution;
+#endif
+}
+
+void storeCell(uint offset, uint index, GridCell cell)
 {
-    ivec2 neighborPos = pos + offset;
-    uint index = neighborPos.y * ubo.gridSize.x + neighborPos.x + pc.readBufferOffset;
-    return data[index];
+#ifdef LATTICE_SOA
+    storeMacro(offset, index, cell.velocity, cell.density);
+    storeDistributions(offset, index, cell);
+#else
+    data[offset + index] = cell;
+#endif
 }
 
 // int iron_color(float x)
@@ -0,0 +1,67 @@
+// Error bounded quantization of the velocity and density fields ahead of their readback. The
+// passes write a QuantizedFrameHeader frame (include/rocket/fieldoutput.h) into the readback
+// ring, a tile is the cells of one workgroup. Included after common.glsl.
+layout(constant_id = 10) const float OUTPUT_ERROR_BOUND = 0.001;
+
+const uint TILE_WIDTH = gl_WorkGroupSize.x;
+const uint TILE_HEIGHT = gl_WorkGroupSize.y;
+const uint TILE_CELLS = gl_WorkGroupSize.x * gl_WorkGroupSize.y;
+const uint TILES_X = (uint(GRID_WIDTH) + gl_WorkGroupSize.x - 1) / gl_WorkGroupSize.x;
+const uint TILES_Y = (uint(GRID_HEIGHT) + gl_WorkGroupSize.y - 1) / gl_WorkGroupSize.y;
+const uint TILE_COUNT = TILES_X * TILES_Y;
+
+// Velocity x, velocity y and density, an entry is one tile of one of them
+const uint FIELD_PLANES = 3;
+const uint ENTRY_COUNT = FIELD_PLANES * TILE_COUNT;
+// Bit width of a tile that keeps its floats
+const uint RAW_BITS = 32;
+const uint FRAME_HEADER_WORDS = 16;
+const uint TILE_TABLE_WORDS = 2;
+
+const uint INFO_MINIMUM = 0;
+const uint INFO_BITS = 1;
+const uint INFO_WORDS = 2;
+const uint INFO_ERROR = 3;
+
+// Device local. A slot of TILE_CELLS words per entry holding its packed values, four words of
+// INFO_* per entry, then the offset of every entry in the payload of the frame.
+layout(std430, binding = 3) buffer Scratch
+{
+    uint scratch[];
+};
+
+// Host visible readback ring
+layout(std430, binding = 4) buffer Frames
+{
+    uint frames[];
+};
+
+uint slotIndex(uint entry, uint word)
+{
+    return entry * TILE_CELLS + word;
+}
+
+uint infoIndex(uint entry, uint info)
+{
+    return ENTRY_COUNT * TILE_CELLS + 4 * entry + info;
+}
+
+uint offsetIndex(uint entry)
+{
+    return ENTRY_COUNT * (TILE_CELLS + 4) + entry;
+}
+
+uint tableIndex(uint entry)
+{
+    return pc.outputOffset + FRAME_HEADER_WORDS + TILE_TABLE_WORDS * entry;
+}
+
+uint payloadIndex(uint word)
+{
+    return pc.outputOffset + FRAME_HEADER_WORDS + TILE_TABLE_WORDS * ENTRY_COUNT + word;
+}
+
+uint packedWords(uint bits)
+{
+    return (TILE_CELLS * bits + 31) / 32;
+}
@@ -0,0 +1,375 @@
+// Shared D2Q9 lattice Boltzmann physics. Every step is expressed on the register
+// representation (GridCell) so the multi-pass and fused kernels run identical code.
+
+// Lattice velocities for each direction in the 2DQ9 model
+const vec2 ei[9] = {
+        vec2(0, 0),   // rest
+        vec2(1, 0),   // right
+        vec2(0, 1),   // top
+        vec2(-1, 0),  // left
+        vec2(0, -1),  // bottom
+        vec2(1, 1),   // top-right
+        vec2(-1, 1),  // top-left
+        vec2(-1, -1), // bottom-left
+        vec2(1, -1)   // bottom-right
+};
+
+// Weights for each direction in the 2DQ9 model
+const float wi[9] = {
+        4.0f / 9.0f,  // rest
+        1.0f / 9.0f,  // right
+        1.0f / 9.0f,  // top
+        1.0f / 9.0f,  // left
+        1.0f / 9.0f,  // bottom
+        1.0f / 36.0f, // top-right
+        1.0f / 36.0f, // top-left
+        1.0f / 36.0f, // bottom-left
+        1.0f / 36.0f  // bottom-right
+};
+
+// Opposite direction of each population
+const int opposite[9] = {0, 3, 4, 1, 2, 7, 8, 5, 6};
+
+// Columns ramping up to the inflow velocity, inflowColumns of the CPU kernels
+const int INFLOW_COLUMNS = 20;
+// Speed the inlet is driven at, inletVelocity of rocket/lattice.h
+const float INFLOW_VELOCITY = 8.0;
+
+// Collision operators, matches params::CollisionOperator
+const int COLLISION_BGK = 0;
+const int COLLISION_TRT = 1;
+const int COLLISION_MRT = 2;
+
+// Lallemand-Luo moment basis: density, energy, energy squared, x momentum, x energy flux,
+// y momentum, y energy flux and the two stress components. The rows are orthogonal, the inverse
+// is the transpose divided by the squared row norms.
+const float momentBasis[9][9] = {
+        {1, 1, 1, 1, 1, 1, 1, 1, 1},
+        {-4, -1, -1, -1, -1, 2, 2, 2, 2},
+        {4, -2, -2, -2, -2, 1, 1, 1, 1},
+        {0, 1, 0, -1, 0, 1, -1, -1, 1},
+        {0, -2, 0, 2, 0, 1, -1, -1, 1},
+        {0, 0, 1, 0, -1, 1, 1, -1, -1},
+        {0, 0, -2, 0, 2, 1, 1, -1, -1},
+        {0, 1, -1, 1, -1, 0, 0, 0, 0},
+        {0, 0, 0, 0, 0, 1, -1, 1, -1}};
+const float momentNorm[9] = {9, 36, 36, 6, 12, 6, 12, 4, 4};
+
+float equilibriumDistribution(int i, vec2 u, float rho)
+{
+    float eu = dot(ei[i], u);
+    float u2 = dot(u, u);
+    float feq = wi[i] * rho * (1.0 + 3.0 * eu + 4.5 * eu * eu - 1.5 * u2);
+    return feq;
+}
+
+// Recompute density and velocity from the populations
+void computeMacro(inout GridCell cell)
+{
+    // Compute the macroscopic density by summing the distribution functions
+    cell.density = 0.0;
+    for(int i = 0; i < 9; ++i)
+    {
+        cell.density += cell.distribution[i];
+    }
+
+    // Compute the macroscopic velocity by taking a weighted sum of the distribution functions
+    cell.velocity = vec2(0.0);
+    for(int i = 0; i < 9; ++i)
+    {
+        cell.velocity += cell.distribution[i] * ei[i];
+    }
+    cell.velocity /= (cell.density + 0.01);
+    cell.velocity = clamp(cell.velocity, -500.0, 500.0);
+    cell.density = clamp(cell.density, 0.1, 10.0);
+}
+
+// Shear relaxation rate of the cell. The Smagorinsky model adds an eddy viscosity
+// (Cs * dx)^2 |S|, with the strain rate taken from the non-equilibrium momentum flux of the
+// populations, which gives the effective relaxation time in closed form (Hou et al. 1996).
+float shearRate(GridCell cell, float feq[9])
+{
+    if(SMAGORINSKY <= 0.0)
+    {
+        return 1.0 / TAU;
+    }
+
+    // xx, yy and xy components of the non-equilibrium momentum flux
+    vec3 flux = vec3(0.0);
+    for(int i = 0; i < 9; ++i)
+    {
+        vec2 e = ei[i];
+        flux += (cell.distribution[i] - feq[i]) * vec3(e.x * e.x, e.y * e.y, e.x * e.y);
+    }
+    float norm = sqrt(flux.x * flux.x + flux.y * flux.y + 2.0 * flux.z * flux.z);
+
+    float eddy = 18.0 * sqrt(2.0) * SMAGORINSKY * SMAGORINSKY * norm / cell.density;
+    return 2.0 / (TAU + sqrt(TAU * TAU + eddy));
+}
+
+// Relaxation of the moments: the stress at the shear rate, the energy moments at the bulk rate
+// and the energy fluxes at the flux rate. The conserved moments only differ from equilibrium
+// by the velocity clamp of computeMacro and take the shear rate, so equal rates reduce to BGK.
+void collideMrt(inout GridCell cell, float feq[9], float shear)
+{
+    float rates[9] = {
+            shear,
+            MRT_BULK_RATE,
+            MRT_BULK_RATE,
+            shear,
+            MRT_FLUX_RATE,
+            shear,
+            MRT_FLUX_RATE,
+            shear,
+            shear};
+
+    float relaxed[9];
+    for(int k = 0; k < 9; ++k)
+    {
+        float moment = 0.0;
+        for(int i = 0; i < 9; ++i)
+        {
+            moment += momentBasis[k][i] * (cell.distribution[i] - feq[i]);
+        }
+        relaxed[k] = rates[k] * moment / momentNorm[k];
+    }
+
+    for(int i = 0; i < 9; ++i)
+    {
+        float change = 0.0;
+        for(int k = 0; k < 9; ++k)
+        {
+            change += momentBasis[k][i] * relaxed[k];
+        }
+        cell.distribution[i] -= change;
+    }
+}
+
+// Relaxation of the symmetric part of each population pair at the shear rate and of the
+// antisymmetric part at the rate the magic parameter gives, (tau+ - 1/2)(tau- - 1/2) = magic.
+// The parameter is kept when the eddy viscosity changes the shear rate.
+void collideTrt(inout GridCell cell, float feq[9], float shear)
+{
+    float antisymmetricRate = 1.0 / (0.5 + TRT_MAGIC / (1.0 / shear - 0.5));
+
+    float post[9];
+    for(int i = 0; i < 9; ++i)
+    {
+        int j = opposite[i];
+        float symmetric = 0.5 * (cell.distribution[i] + cell.distribution[j] - feq[i] - feq[j]);
+        float antisymmetric =
+                0.5 * (cell.distribution[i] - cell.distribution[j] - feq[i] + feq[j]);
+        post[i] = cell.distribution[i] - shear * symmetric - antisymmetricRate * antisymmetric;
+    }
+    cell.distribution = post;
+}
+
+// Relaxation towards the equilibrium of the current macroscopic fields with the operator the
+// run selected
+void collide(inout GridCell cell)
+{
+    float feq[9];
+    for(int i = 0; i < 9; ++i)
+    {
+        feq[i] = equilibriumDistribution(i, cell.velocity, cell.density);
+    }
+    float shear = shearRate(cell, feq);
+
+    if(COLLISION == COLLISION_MRT)
+    {
+        collideMrt(cell, feq, shear);
+    }
+    else if(COLLISION == COLLISION_TRT)
+    {
+        collideTrt(cell, feq, shear);
+    }
+    else
+    {
+        for(int i = 0; i < 9; ++i)
+        {
+            cell.distribution[i] -= shear * (cell.distribution[i] - feq[i]);
+        }
+    }
+}
+
+// Solid obstacle, inflow, outflow and wall conditions on freshly streamed populations
+void applyBoundary(inout GridCell cell, ivec2 pos)
+{
+    // Check if the cell is inside the cylinder
+    if(cell.solid == 1)
+    {
+        // Zou/He Boundary Condition
+
+        // Prescribe the macroscopic variables (density and velocity) at the boundary
+        vec2 prescribed_velocity = vec2(0.0); // modify as needed
+        float prescribed_density = 1.0;       // modify as needed
+
+        // Compute the equilibrium distribution
+        float equilibrium_distributions[9];
+        for(int i = 0; i < 9; ++i)
+        {
+            equilibrium_distributions[i] =
+                    equilibriumDistribution(i, prescribed_velocity, prescribed_density);
+        }
+
+        // Apply the Zou/He boundary condition
+        cell.distribution[3] =
+                equilibrium_distributions[3] + cell.distribution[1] - equilibrium_distributions[1];
+        cell.distribution[4] =
+                equilibrium_distributions[4] + cell.distribution[2] - equilibrium_distributions[2];
+        cell.distribution[7] =
+                equilibrium_distributions[7] + cell.distribution[5] - equilibrium_distributions[5];
+        cell.distribution[8] =
+                equilibrium_distributions[8] + cell.distribution[6] - equilibrium_distributions[6];
+
+        // Compute the non-equilibrium part of the distribution function
+        for(int i = 0; i < 9; ++i)
+        {
+            cell.distribution[i] = equilibrium_distributions[i] + cell.distribution[i]
+                                   - equilibrium_distributions[i];
+        }
+
+        cell.velocity = prescribed_velocity;
+        cell.density = prescribed_density;
+
+        // Apply the bounce-back boundary condition
+        // float tmp;
+        //
+        // tmp = cell.distribution[1];
+        // cell.distribution[1] = cell.distribution[3];
+        // cell.distribution[3] = tmp;
+        //
+        // tmp = cell.distribution[2];
+        // cell.distribution[2] = cell.distribution[4];
+        // cell.distribution[4] = tmp;
+        //
+        // tmp = cell.distribution[5];
+        // cell.distribution[5] = cell.distribution[7];
+        // cell.distribution[7] = tmp;
+        //
+        // tmp = cell.distribution[6];
+        // cell.distribution[6] = cell.distribution[8];
+        // cell.distribution[8] = tmp;
+        //
+        // cell.velocity = vec2(0.0);
+    }
+
+    // Check if the cell is at the left boundary
+    // if(pos.x < 6)
+    // {
+    //     // Gradually increase the velocity over a few cells from the boundary
+    //     float max_velocity = 40.0;
+    //     float transition_cells = 6.0;
+    //     float velocity_scale = min(float(pos.x) / transition_cells, 1.0);
+    //     cell.velocity = vec2(max_velocity * velocity_scale, 0.0);
+    //     cell.density = 1.0;
+    //
+    //     // Compute the distribution functions based on the new velocity and the desired density
+    //     for(int i = 0; i < 9; ++i)
+    //     {
+    //         cell.distribution[i] = equilibriumDistribution(i, cell.velocity, cell.density);
+    //     }
+    // }    // Check if the cell is at the left boundary or near it
+    if(pos.x < INFLOW_COLUMNS)
+    {
+        // Set the velocity at the boundary
+        if(pos.x < 1)
+        {
+            cell.velocity = vec2(INFLOW_VELOCITY, 0.0);
+        }
+        // Gradually increase the velocity over a few cells from the boundary
+        else
+        {
+            float max_velocity = INFLOW_VELOCITY;
+            float transition_cells = float(INFLOW_COLUMNS);
+            float velocity_scale = min(float(pos.x) / transition_cells, 1.0);
+            cell.velocity = vec2(max_velocity * velocity_scale, 0.0);
+        }
+        cell.density = 1.0;
+
+        // Compute the distribution functions based on the new velocity and the desired density
+        for(int i = 0; i < 9; ++i)
+        {
+            cell.distribution[i] = equilibriumDistribution(
+                    i, cell.velocity, cell.density);
+        }
+    }
+    // Check if the cell is at the right boundary
+    else if(pos.x == GRID_SIZE.x - 1)
+    {
+        // Prescribe the density at the boundary
+        float prescribed_density = 1.0; // modify as needed
+
+        // Compute the equilibrium distribution based on the current velocity and the prescribed
+        // density
+        float equilibrium_distributions[9];
+        for(int i = 0; i < 9; ++i)
+        {
+            equilibrium_distributions[i] =
+                    equilibriumDistribution(i, cell.velocity, prescribed_density);
+        }
+
+        // Apply the Zou/He boundary condition
+        cell.distribution[1] =
+                equilibrium_distributions[1] + cell.distribution[3] - equilibrium_distributions[3];
+        cell.distribution[5] =
+                equilibrium_distributions[5] + cell.distribution[7] - equilibrium_distributions[7];
+        cell.distribution[8] =
+                equilibrium_distributions[8] + cell.distribution[6] - equilibrium_distributions[6];
+
+        // Compute the non-equilibrium part of the distribution function
+        for(int i = 0; i < 9; ++i)
+        {
+            cell.distribution[i] = equilibrium_distributions[i] + cell.distribution[i]
+                                   - equilibrium_distributions[i];
+        }
+
+        cell.density = prescribed_density;
+    }
+
+    // Check if the cell is at the top or bottom boundary
+    else if(pos.y == 0 || pos.y == GRID_SIZE.y - 1)
+    {
+        // Set the velocity to zero
+        cell.velocity = vec2(0.0, 0.0);
+
+        // Compute the distribution functions based on the new velocity and the desired density
+        // for(int i = 0; i < 9; ++i)
+        // {
+        //     cell.distribution[i] = equilibriumDistribution(
+        //             i, cell.velocity, cell.density); // You need to define this function
+        // }
+
+        // Apply the bounce-back boundary condition
+        float tmp;
+
+        tmp = cell.distribution[2];
+        cell.distribution[2] = cell.distribution[4];
+        cell.distribution[4] = tmp;
+
+        tmp = cell.distribution[5];
+        cell.distribution[5] = cell.distribution[7];
+        cell.distribution[7] = tmp;
+
+        tmp = cell.distribution[6];
+        cell.distribution[6] = cell.distribution[8];
+        cell.distribution[8] = tmp;
+    }
+
+    // Check if the cell is at the top boundary
+    // if(pos.y == 0)
+    // {
+    //     // Copy the distribution functions from the corresponding cell at the bottom boundary
+    //     ivec2 bottomPos = pos + ivec2(0, GRID_SIZE.y - 1);
+    //     uint bottomIndex = pc.readBufferOffset + bottomPos.y * GRID_SIZE.x + bottomPos.x;
+    //     cell.distribution = data[bottomIndex].distribution;
+    // }
+    // // Check if the cell is at the bottom boundary
+    // else if(pos.y == GRID_SIZE.y - 1)
+    // {
+    //     // Copy the distribution functions from the corresponding cell at the top boundary
+    //     ivec2 topPos = pos - ivec2(0, GRID_SIZE.y - 1);
+    //     uint topIndex = pc.readBufferOffset + topPos.y * GRID_SIZE.x + topPos.x;
+    //     cell.distribution = data[topIndex].distribution;
+    // }
+}
@@ -0,0 +1,148 @@
+// Level hierarchy of the geometric multigrid pressure solver. Level 0 is the grid itself: the
+// pressure in slot 0 is the solution, the divergence the right hand side and the walls of
+// stablefluids.glsl the mask. Every coarser level halves the size, rounding up, and keeps four
+// planes of its own after the residual plane of level 0: solution, right hand side, residual
+// and the wall mask. The solver state (reduction partials, residual norm and the indirect
+// dispatch arguments of every level) follows the last level.
+const uint PLANE_RESIDUAL = PLANE_SOLID + 1;
+const uint LEVEL_PLANES = 4;
+
+// The dispatch arguments are read as integers, aliasing the float planes
+layout(std430, binding = 1) buffer FieldWords
+{
+    uint words[];
+};
+
+ivec2 levelSize(uint level)
+{
+    ivec2 size = ubo.gridSize;
+    for(uint l = 0; l < level; ++l)
+    {
+        size = (size + 1) / 2;
+    }
+    return size;
+}
+
+uint levelCellCount(uint level)
+{
+    ivec2 size = levelSize(level);
+    return uint(size.x * size.y);
+}
+
+// First float of the planes of a coarse level
+uint levelBase(uint level)
+{
+    uint base = (PLANE_RESIDUAL + 1) * cellCount();
+    for(uint l = 1; l < level; ++l)
+    {
+        base += LEVEL_PLANES * levelCellCount(l);
+    }
+    return base;
+}
+
+uint stateBase()
+{
+    return levelBase(pc.levels);
+}
+
+uint levelIndex(uint level, ivec2 pos)
+{
+    return uint(pos.y * levelSize(level).x + pos.x);
+}
+
+float loadSolution(uint level, uint index)
+{
+    return level == 0 ? loadPressure(0, index) : planes[levelBase(level) + index];
+}
+
+void storeSolution(uint level, uint index, float value)
+{
+    if(level == 0)
+    {
+        storePressure(0, index, value);
+    }
+    else
+    {
+        planes[levelBase(level) + index] = value;
+    }
+}
+
+float loadRhs(uint level, uint index)
+{
+    return level == 0 ? loadDivergence(index)
+                      : planes[levelBase(level) + levelCellCount(level) + index];
+}
+
+void storeRhs(uint level, uint index, float value)
+{
+    planes[levelBase(level) + levelCellCount(level) + index] = value;
+}
+
+float loadResidual(uint level, uint index)
+{
+    return level == 0 ? planes[PLANE_RESIDUAL * cellCount() + index]
+                      : planes[levelBase(level) + 2 * levelCellCount(level) + index];
+}
+
+void storeResidual(uint level, uint index, float value)
+{
+    if(level == 0)
+    {
+        planes[PLANE_RESIDUAL * cellCount() + index] = value;
+    }
+    else
+    {
+        planes[levelBase(level) + 2 * levelCellCount(level) + index] = value;
+    }
+}
+
+bool loadWall(uint level, ivec2 pos, uint index)
+{
+    return level == 0 ? isWall(pos, index)
+                      : planes[levelBase(level) + 3 * levelCellCount(level) + index] != 0.0;
+}
+
+void storeWall(uint level, uint index, bool wall)
+{
+    planes[levelBase(level) + 3 * levelCellCount(level) + index] = wall ? 1.0 : 0.0;
+}
+
+// Same boundary conditions on every level: zero pressure on the outflow face, zero normal
+// gradient at the other edges and at walls. Both are imposed on cell faces, which line up
+// across levels.
+float neighbourSolution(uint level, ivec2 pos, float centre)
+{
+    ivec2 size = levelSize(level);
+    if(pos.x >= size.x)
+    {
+        return -centre;
+    }
+    if(pos.x < 0 || pos.y < 0 || pos.y >= size.y)
+    {
+        return centre;
+    }
+    uint index = levelIndex(level, pos);
+    return loadWall(level, pos, index) ? centre : loadSolution(level, index);
+}
+
+float neighbourSum(uint level, ivec2 pos, float centre)
+{
+    return neighbourSolution(level, pos + ivec2(-1, 0), centre)
+           + neighbourSolution(level, pos + ivec2(1, 0), centre)
+           + neighbourSolution(level, pos + ivec2(0, -1), centre)
+           + neighbourSolution(level, pos + ivec2(0, 1), centre);
+}
+
+// Square of the cell size of a level in fine cells
+float levelSpacing2(uint level)
+{
+    float h = float(1u << level);
+    return h * h;
+}
+
+// Indirect dispatch arguments of a level, cleared once the residual norm is below tolerance
+uint argumentsOffset(uint level)
+{
+    ivec2 groups = (levelSize(0) + 15) / 16;
+    return stateBase() + uint(groups.x * groups.y) + 1 + 3 * level;
+}
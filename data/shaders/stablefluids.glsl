@@ -0,0 +1,144 @@
+#extension GL_ARB_enhanced_layouts : enable
+layout(local_size_x = 16, local_size_y = 16, local_size_z = 1) in;
+
+// Shared field layout and boundary conditions of the Stable Fluids engine, an Eulerian
+// velocity/pressure solver on a collocated grid with unit cell size and unit time step.
+
+layout(binding = 0) uniform UniformBufferObject
+{
+    vec4 color;
+    ivec2 gridSize;
+    float time;
+    int enabled;
+}
+ubo;
+
+// The buffer is split into planes of gridSize.x * gridSize.y floats: three slots of velocity.x,
+// three of velocity.y, two of pressure, then the divergence and the solid flag.
+const uint VELOCITY_SLOTS = 3;
+const uint PRESSURE_SLOTS = 2;
+const uint PLANE_VELOCITY_X = 0;
+const uint PLANE_VELOCITY_Y = PLANE_VELOCITY_X + VELOCITY_SLOTS;
+const uint PLANE_PRESSURE = PLANE_VELOCITY_Y + VELOCITY_SLOTS;
+const uint PLANE_DIVERGENCE = PLANE_PRESSURE + PRESSURE_SLOTS;
+const uint PLANE_SOLID = PLANE_DIVERGENCE + 1;
+
+layout(std430, binding = 1) buffer Fields
+{
+    float planes[];
+};
+
+// Slots each pass reads and writes, the source is the right hand side of the diffusion solve.
+// The multigrid passes take the level they work on, the red-black colour, the number of levels
+// and the residual norm tolerance.
+layout(push_constant) uniform PushConstants
+{
+    uint velocityRead;
+    uint velocityWrite;
+    uint velocitySource;
+    uint pressureRead;
+    uint pressureWrite;
+    uint level;
+    uint color;
+    uint levels;
+    float tolerance;
+} pc;
+
+// Kinematic viscosity, the same as the lattice Boltzmann engine with the default tau = 0.85
+const float viscosity = (0.85 - 0.5) / 3.0;
+const float inflowVelocity = 8.0;
+const int inflowCells = 20;
+
+uint cellCount()
+{
+    return uint(ubo.gridSize.x * ubo.gridSize.y);
+}
+
+uint cellIndex(ivec2 pos)
+{
+    pos = clamp(pos, ivec2(0), ubo.gridSize - 1);
+    return uint(pos.y * ubo.gridSize.x + pos.x);
+}
+
+vec2 loadVelocity(uint slot, uint index)
+{
+    return vec2(
+            planes[(PLANE_VELOCITY_X + slot) * cellCount() + index],
+            planes[(PLANE_VELOCITY_Y + slot) * cellCount() + index]);
+}
+
+void storeVelocity(uint slot, uint index, vec2 velocity)
+{
+    planes[(PLANE_VELOCITY_X + slot) * cellCount() + index] = velocity.x;
+    planes[(PLANE_VELOCITY_Y + slot) * cellCount() + index] = velocity.y;
+}
+
+float loadPressure(uint slot, uint index)
+{
+    return planes[(PLANE_PRESSURE + slot) * cellCount() + index];
+}
+
+void storePressure(uint slot, uint index, float pressure)
+{
+    planes[(PLANE_PRESSURE + slot) * cellCount() + index] = pressure;
+}
+
+float loadDivergence(uint index)
+{
+    return planes[PLANE_DIVERGENCE * cellCount() + index];
+}
+
+void storeDivergence(uint index, float divergence)
+{
+    planes[PLANE_DIVERGENCE * cellCount() + index] = divergence;
+}
+
+bool loadSolid(uint index)
+{
+    return planes[PLANE_SOLID * cellCount() + index] != 0.0;
+}
+
+void storeSolid(uint index, bool solid)
+{
+    planes[PLANE_SOLID * cellCount() + index] = solid ? 1.0 : 0.0;
+}
+
+// Obstacle cells and the top and bottom rows are no-slip walls
+bool isWall(ivec2 pos, uint index)
+{
+    return pos.y == 0 || pos.y == ubo.gridSize.y - 1 || loadSolid(index);
+}
+
+// Cells whose velocity is prescribed rather than solved for: walls and the inflow ramp, the
+// same profile the lattice Boltzmann engine imposes
+bool prescribedVelocity(ivec2 pos, uint index, out vec2 velocity)
+{
+    if(isWall(pos, index))
+    {
+        velocity = vec2(0.0);
+        return true;
+    }
+    if(pos.x < inflowCells)
+    {
+        float scale = pos.x < 1 ? 1.0 : min(float(pos.x) / float(inflowCells), 1.0);
+        velocity = vec2(inflowVelocity * scale, 0.0);
+        return true;
+    }
+    return false;
+}
+
+// Pressure of a neighbour for the Poisson stencil. Walls and the domain edges mirror the centre
+// cell (zero normal gradient), the outflow face is held at zero.
+float neighbourPressure(uint slot, ivec2 pos, float centre)
+{
+    if(pos.x >= ubo.gridSize.x)
+    {
+        return -centre;
+    }
+    if(pos.x < 0 || pos.y < 0 || pos.y >= ubo.gridSize.y)
+    {
+        return centre;
+    }
+    uint index = cellIndex(pos);
+    return isWall(pos, index) ? centre : loadPressure(slot, index);
+}
@@ -0,0 +1,65 @@
+#extension GL_KHR_shader_subgroup_basic : enable
+#extension GL_KHR_shader_subgroup_arithmetic : enable
+
+// Flow statistics of the lattice, reduced on the device so only a few floats are read back.
+// flow_stats.comp leaves two partials per workgroup, sums of mass, kinetic energy and the x and
+// y force on the solids, and maxima of speed, negated density and density. flow_stats_reduce.comp
+// folds them into a FlowStatistics (include/rocket/flowstats.h) in the readback ring at
+// pc.outputOffset. Included after common.glsl and lbm.glsl.
+
+// Where the post-collision populations of the last step are kept, selected by pc.parity. They
+// are read from the lattice at pc.writeBufferOffset, the macroscopic fields and the solid flags
+// from the one at pc.readBufferOffset.
+const uint POPULATIONS_POST_COLLISION = 0; // slot i of the cell, fused and multi-pass kernels
+const uint POPULATIONS_SWAPPED = 1;        // slot opposite(i) of the cell, after an even AA step
+const uint POPULATIONS_STREAMED = 2;       // slot i of the neighbour at +e_i, after an odd AA step,
+                                           // only for links inside the domain (see lbm_aa.comp)
+
+// Device local, sums and maxima of every workgroup
+layout(std430, binding = 5) buffer StatsPartials
+{
+    vec4 partials[];
+};
+
+// Host visible readback ring
+layout(std430, binding = 6) buffer StatsFrames
+{
+    float statsFrames[];
+};
+
+shared vec4 subgroupSums[gl_WorkGroupSize.x * gl_WorkGroupSize.y];
+shared vec4 subgroupMaxima[gl_WorkGroupSize.x * gl_WorkGroupSize.y];
+
+// Sums and maxima over the workgroup: subgroup arithmetic, then a tree over the subgroup
+// results in shared memory. Every invocation has to call it.
+void workgroupReduce(inout vec4 sums, inout vec4 maxima)
+{
+    sums = subgroupAdd(sums);
+    maxima = subgroupMax(maxima);
+    if(subgroupElect())
+    {
+        subgroupSums[gl_SubgroupID] = sums;
+        subgroupMaxima[gl_SubgroupID] = maxima;
+    }
+    barrier();
+
+    for(uint count = gl_NumSubgroups; count > 1; count = (count + 1) / 2)
+    {
+        uint upper = (count + 1) / 2;
+        if(gl_LocalInvocationIndex < count / 2)
+        {
+            uint other = gl_LocalInvocationIndex + upper;
+            subgroupSums[gl_LocalInvocationIndex] += subgroupSums[other];
+            subgroupMaxima[gl_LocalInvocationIndex] =
+                    max(subgroupMaxima[gl_LocalInvocationIndex], subgroupMaxima[other]);
+        }
+        barrier();
+    }
+    sums = subgroupSums[0];
+    maxima = subgroupMaxima[0];
+}
+
+uvec2 statsGroupCount()
+{
+    return (uvec2(GRID_SIZE) + gl_WorkGroupSize.xy - 1) / gl_WorkGroupSize.xy;
+}
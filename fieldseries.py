@@ -0,0 +1,150 @@
+"""Memory mapped reader of the field series the solver writes (outputseries in config.ini).
+
+The file starts with a 64 byte header. With half or float precision the frames have one fixed
+size: a 16 byte frame header holding the step, then the planes velocity x, velocity y, density
+and vorticity of height x width float16 or float32 values, padded to 16 bytes. Quantized series
+(value_bytes 0) have frames of any size, each frame header also gives the bytes up to the next
+one. Their tiles are decoded on access and the vorticity is derived here. A frame still being
+written is not counted. See FieldSeriesHeader and QuantizedFrameHeader in
+include/rocket/fieldoutput.h.
+"""
+
+import numpy as np
+
+HEADER = np.dtype([
+    ('magic', 'S8'),
+    ('version', '<u4'),
+    ('header_bytes', '<u4'),
+    ('width', '<i4'),
+    ('height', '<i4'),
+    ('value_bytes', '<u4'),
+    ('plane_count', '<u4'),
+    ('frame_bytes', '<u8'),
+    ('reserved', 'V24'),
+])
+
+PLANES = ('velocity_x', 'velocity_y', 'density', 'vorticity')
+
+# Words of the QuantizedFrameHeader, a QuantizedTile and the bit width of a tile of floats
+QUANTIZED_HEADER_WORDS = 16
+TILE_WORDS = 2
+RAW_BITS = 32
+
+
+def vorticity(velocity_x, velocity_y):
+    """Central differences inside the grid and one sided ones on its edges, as the solver"""
+    return np.gradient(velocity_y, axis=1) - np.gradient(velocity_x, axis=0)
+
+
+def dequantize(words, width, height):
+    """Velocity x, velocity y and density of a quantized frame, shaped (3, height, width)"""
+    frame_words, tile_width, tile_height, tiles_x, tiles_y = (int(w) for w in words[:5])
+    bound = words[5:6].view('<f4')[0]
+    assert frame_words <= len(words)
+    tiles = tiles_x * tiles_y
+    cells = tile_width * tile_height
+
+    table = words[QUANTIZED_HEADER_WORDS:QUANTIZED_HEADER_WORDS + TILE_WORDS * 3 * tiles]
+    table = table.reshape(3 * tiles, TILE_WORDS)
+    minimum = table[:, 0].view('<f4')
+    bits = table[:, 1].astype(np.int64)
+    counts = (cells * bits + 31) // 32
+    offsets = QUANTIZED_HEADER_WORDS + len(table) * TILE_WORDS + np.cumsum(counts) - counts
+
+    step = np.float32(2.0) * bound
+    position = np.arange(cells, dtype=np.uint64)
+    fields = np.zeros((3, tiles_y * tile_height, tiles_x * tile_width), dtype=np.float32)
+    for entry in range(3 * tiles):
+        plane, tile = divmod(entry, tiles)
+        width_bits = int(bits[entry])
+        if width_bits == 0:
+            values = np.full(cells, minimum[entry], dtype=np.float32)
+        else:
+            # Least significant bit first, a value may straddle two words
+            packed = np.append(words[offsets[entry]:offsets[entry] + counts[entry]], 0)
+            packed = packed.astype(np.uint64)
+            bit = position * np.uint64(width_bits)
+            word = bit // np.uint64(32)
+            shift = bit % np.uint64(32)
+            value = (packed[word] >> shift) | (packed[word + np.uint64(1)] << (np.uint64(32) - shift))
+            value = (value & np.uint64((1 << width_bits) - 1)).astype(np.uint32)
+            if width_bits == RAW_BITS:
+                values = value.view('<f4')
+            else:
+                values = minimum[entry] + value.astype(np.float32) * step
+
+        y = tile // tiles_x * tile_height
+        x = tile % tiles_x * tile_width
+        fields[plane, y:y + tile_height, x:x + tile_width] = values.reshape(tile_height, tile_width)
+    return fields[:, :height, :width]
+
+
+class FieldSeries:
+    def __init__(self, path):
+        header = np.fromfile(path, dtype=HEADER, count=1)
+        if len(header) != 1 or header['magic'][0] != b'RDFIELDS':
+            raise ValueError(f'{path} is not a field series')
+        if header['version'][0] not in (1, 2):
+            raise ValueError(f'{path} is a version {header["version"][0]} field series')
+
+        self.width = int(header['width'][0])
+        self.height = int(header['height'][0])
+        self.quantized = header['value_bytes'][0] == 0
+        data = np.memmap(path, dtype=np.uint8, mode='r')
+        offset = int(header['header_bytes'][0])
+
+        if self.quantized:
+            # Step from frame header to frame header
+            self._steps = []
+            self._payloads = []
+            while offset + 16 <= len(data):
+                magic = data[offset:offset + 4].tobytes()
+                payload = int(data[offset + 4:offset + 8].view('<u4')[0])
+                if magic != b'FRAM' or offset + 16 + payload > len(data):
+                    break
+                self._steps.append(int(data[offset + 8:offset + 16].view('<u8')[0]))
+                self._payloads.append(data[offset + 16:offset + 16 + payload].view('<u4'))
+                offset += 16 + payload
+            return
+
+        value = np.dtype('<f2' if header['value_bytes'][0] == 2 else '<f4')
+        cells = self.width * self.height
+        frame_bytes = int(header['frame_bytes'][0])
+
+        frame = np.dtype({
+            'names': ['magic', 'step', 'planes'],
+            'formats': ['S4', '<u8', (value, (len(PLANES), self.height, self.width))],
+            'offsets': [0, 8, 16],
+            'itemsize': frame_bytes,
+        })
+        assert 16 + len(PLANES) * cells * value.itemsize <= frame_bytes
+
+        count = (len(data) - offset) // frame_bytes
+        self._frames = np.ndarray((count,), dtype=frame, buffer=data, offset=offset)
+
+    def __len__(self):
+        return len(self._payloads) if self.quantized else len(self._frames)
+
+    @property
+    def steps(self):
+        return np.array(self._steps, dtype=np.uint64) if self.quantized else self._frames['step']
+
+    def frame(self, index):
+        """Planes of one frame by name, views into the mapped file unless quantized"""
+        if self.quantized:
+            fields = dequantize(self._payloads[index], self.width, self.height)
+            planes = [*fields, vorticity(fields[0], fields[1])]
+        else:
+            planes = self._frames[index]['planes']
+        return {name: planes[i] for i, name in enumerate(PLANES)}
+
+    def max_error(self, index):
+        """Largest error of velocity x, velocity y and density the solver measured in a quantized
+        frame"""
+        return self._payloads[index][6:9].view('<f4')
+
+    def plane(self, name):
+        """One plane of every frame, shaped (frames, height, width)"""
+        if self.quantized:
+            return np.stack([self.frame(i)[name] for i in range(len(self))])
+        return self._frames['planes'][:, PLANES.index(name)]
@@ -3,9 +3,80 @@
 #include "entt/signal/dispatcher.hpp"
 
 #include <memory>
+#include <string>
 
 namespace params
 {
+
+// Memory layout of the lattice on the device
+enum class LatticeLayout
+{
+    AoS, // one GridCell record per cell
+    SoA, // one contiguous plane per population and per macroscopic field
+};
+
+// How one lattice Boltzmann step is dispatched
+enum class SolverKernel
+{
+    MultiPass, // separate collision, streaming, boundary and macro passes
+    Fused,     // single pull-stream + boundary + macro + collide pass
+    InPlaceAA, // fused pass with AA-pattern propagation over a single lattice
+};
+
+// Collision operator of the lattice Boltzmann GPU kernels
+enum class CollisionOperator
+{
+    Bgk, // single relaxation time
+    Trt, // two relaxation times, symmetric and antisymmetric population pairs
+    Mrt, // multiple relaxation times in the Lallemand-Luo moment space
+};
+
+// Numerical method advancing the flow
+enum class SolverEngine
+{
+    Lbm,          // D2Q9 lattice Boltzmann
+    StableFluids, // Eulerian velocity/pressure projection, GPU only
+};
+
+// Pressure Poisson solver of the Stable Fluids projection
+enum class PressureSolver
+{
+    Jacobi,            // fixed number of Jacobi sweeps
+    Multigrid,         // geometric multigrid V-cycles until the residual is below tolerance
+    ConjugateGradient, // preconditioned conjugate gradient, also stopped by the tolerance
+};
+
+// Preconditioner of the conjugate gradient pressure solver
+enum class PressurePreconditioner
+{
+    Jacobi,            // inverse of the diagonal
+    IncompletePoisson, // K K^T with K = I - L D^-1, two explicit stencils
+};
+
+// Where the lattice Boltzmann steps run
+enum class SolverBackend
+{
+    Gpu, // Vulkan compute
+    Cpu, // SoA planes on a thread pool, headless only
+};
+
+// How the velocity and density fields are stored when read back
+enum class OutputPrecision
+{
+    Half,      // float16
+    Float,     // float32
+    Quantized, // compressed on the device to integers within an error bound
+};
+
+// Vector instruction set of the CPU backend
+enum class CpuIsa
+{
+    Auto, // widest one the processor supports
+    Scalar,
+    Avx2,
+    Avx512,
+};
+
 struct Params
 {
     struct ScreenConfig
@@ -19,7 +90,86 @@ struct Params
         bool vsync = false;
         bool validationLayers = false;
         bool debugUtils = false;
+        // Pipeline cache file kept between runs, empty keeps the cache in memory only
+        std::string pipelineCache = "pipeline_cache.bin";
     } vulkanConfig;
+
+    struct SimulationConfig
+    {
+        SolverEngine engine = SolverEngine::Lbm;
+        // Jacobi iterations of the Stable Fluids viscous step, 0 leaves the flow inviscid
+        uint32_t diffuseIterations = 4;
+        // Jacobi iterations of the Stable Fluids pressure solve, rounded up to an even count, or
+        // the upper bound on conjugate gradient iterations
+        uint32_t pressureIterations = 40;
+        PressureSolver pressureSolver = PressureSolver::Jacobi;
+        PressurePreconditioner pressurePreconditioner = PressurePreconditioner::IncompletePoisson;
+        // Upper bound on the multigrid V-cycles per step
+        uint32_t pressureCycles = 8;
+        // Root mean square residual at which the multigrid and conjugate gradient solves stop
+        float pressureTolerance = 1e-4f;
+        SolverBackend backend = SolverBackend::Gpu;
+        CpuIsa cpuIsa = CpuIsa::Auto;
+        // Worker threads of the CPU backend, 0 uses every processor the process may run on
+        uint32_t cpuThreads = 0;
+        // Pin CPU workers to processors spread over the NUMA nodes
+        bool cpuPinning = true;
+        // Time steps the CPU backend runs on cache resident rows before moving on, 1 disables
+        // temporal blocking
+        uint32_t cpuTemporalDepth = 1;
+        LatticeLayout layout = LatticeLayout::SoA;
+        SolverKernel kernel = SolverKernel::Fused;
+        CollisionOperator collision = CollisionOperator::Bgk;
+        // Relaxation time of the shear stress, viscosity (tau - 0.5) / 3 in lattice units
+        float tau = 0.85f;
+        // TRT magic parameter (tau+ - 1/2)(tau- - 1/2), 1/4 is the most stable choice
+        float trtMagic = 0.25f;
+        // MRT relaxation rates of the energy moments, which set the bulk viscosity, and of the
+        // energy fluxes
+        float mrtBulkRate = 1.4f;
+        float mrtFluxRate = 1.2f;
+        // Smagorinsky constant Cs of the LES eddy viscosity, 0 disables the model
+        float smagorinsky = 0.0f;
+        // Lattice size in cells
+        int gridWidth = 2048;
+        int gridHeight = 512;
+        // Workgroup shape of the lattice Boltzmann shaders, checked against the device limits
+        uint32_t workgroupWidth = 16;
+        uint32_t workgroupHeight = 16;
+        // Solver steps per displayed frame, the starting point when a frame budget is set
+        uint32_t stepsPerFrame = 4;
+        // Adapt the steps per frame to keep the frame time near this budget, 0 disables
+        float frameBudgetMs = 0.0f;
+        // Render the field every Nth frame
+        uint32_t renderInterval = 1;
+        // Steps between checkpoints of the lattice state, written in the background, 0 disables
+        uint32_t checkpointInterval = 0;
+        std::string checkpointPath = "checkpoint.bin";
+        // Checkpoint the run continues from, empty starts from the initial state
+        std::string restartPath;
+        // Steps between readbacks of the velocity and density fields, 0 disables them
+        uint32_t outputInterval = 0;
+        // Readbacks in flight at once, a readback is dropped when all of them are busy
+        uint32_t outputSlots = 3;
+        // Binary series the fields are appended to, see fieldseries.py, empty disables it.
+        // Continued only when restarting from a checkpoint.
+        std::string outputSeries = "fields.series";
+        // Values of the series, quantized fields are also what is read back
+        OutputPrecision outputPrecision = OutputPrecision::Half;
+        // Largest error of a quantized value in lattice units
+        float outputErrorBound = 0.001f;
+        // CSV file of the latest fields in the columns of visual.py, empty disables it
+        std::string outputCsv;
+        // Steps between flow statistics reduced on the device, 0 disables them. They share
+        // outputSlots with the field readbacks.
+        uint32_t statsInterval = 0;
+        // CSV time history of the statistics with drag and lift coefficients, continued only
+        // when restarting from a checkpoint
+        std::string statsPath = "stats.csv";
+        // GPU timestamps of every solver pass, reported to the log and as JSON
+        bool profile = false;
+        std::string profileOutput = "gpu_profile.json";
+    } simulationConfig;
 };
 } // namespace params
 
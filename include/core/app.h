@@ -5,16 +5,27 @@
 #include "core/vulkan/context.h"
 #include "core/window/windowmanager.h"
 #include "logs/log.h"
+#include "rocket/solver.h"
 
 #include <chrono>
+#include <string>
 
 namespace app
 {
 
+struct LaunchOptions
+{
+    std::string configPath = "data/config.ini";
+    // Run the solver without a window or swapchain, then exit
+    bool headless = false;
+    // Lattice steps to run in headless mode
+    uint64_t steps = 1000;
+};
+
 class Application final
 {
 public:
-    Application();
+    explicit Application(LaunchOptions options = {});
 
     auto init() -> void;
     auto run() -> void;
@@ -26,7 +37,10 @@ private:
     // std::unique_ptr<ConfigHandler> _configHandler;
     std::unique_ptr<WindowManager> _windowManager;
     std::unique_ptr<vk::Context> _vkContext;
+    // Host solver when the CPU backend is selected, replaces the Vulkan context
+    std::unique_ptr<simu::Solver> _cpuSolver;
     logs::Log _log;
+    LaunchOptions _options;
 
     // Total runtime of application
     std::chrono::duration<double> _apprunTime{0};
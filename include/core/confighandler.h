@@ -15,6 +15,8 @@ public:
     ConfigHandler(std::string configFilePath);
     [[nodiscard]] auto loadVulkanConfig() -> std::optional<params::Params::VulkanConfig>;
     [[nodiscard]] auto loadScreenConfig() -> std::optional<params::Params::ScreenConfig>;
+    [[nodiscard]] auto loadSimulationConfig()
+            -> std::optional<params::Params::SimulationConfig>;
 
 private:
     logs::Log _log;
@@ -10,6 +10,7 @@
 #include "event/sub.h"
 #include "logs/log.h"
 #include "model/vertex.h"
+#include "rocket/scheduler.h"
 #include "rocket/simu.h"
 #include "vkmemalloc.h"
 #include "vulkan/vulkan.h"
@@ -24,7 +25,8 @@ class DescriptorSetGenerator;
 class Context final
 {
 public:
-    Context(AppContextPtr const& appContext, GLFWwindow* window);
+    // Without a window the context is headless: no surface, swapchain or graphics pipeline
+    Context(AppContextPtr const& appContext, GLFWwindow* window = nullptr);
     ~Context();
 
     Context(Context const&) = delete;
@@ -33,14 +35,19 @@ public:
     auto operator=(Context&&) -> Context& = delete;
 
     auto init(VkExtent2D swapchainExtent) -> void;
+    auto initHeadless() -> void;
     auto renderFrame(float dt, float elapsed) -> void;
     auto deviceWaitIdle() -> void;
+    // Headless run of the solver, logs the achieved throughput and returns the wall time in
+    // seconds
+    auto simulate(uint64_t steps) -> double;
 
     auto onEvent(event::FrameBufferResizeEvent const& event) -> void;
 
 private:
     auto generatePipelines() -> void;
     auto createInstance() -> void;
+    auto createDevice(VkQueueFlags queueFlags, std::vector<char const*> extensions) -> void;
     [[nodiscard]] auto selectPhysicalDevice() -> VkPhysicalDevice;
     auto createSynchronizationPrimitives() -> void;
     auto createRenderPass() -> void;
@@ -65,8 +72,11 @@ private:
     VkExtent2D _swapchainExtent = {0, 0};
     uint32_t _frameIndex = 0;
     bool _frameBufferResized = false;
+    // Runtime of the last GPU profile report, in seconds
+    float _lastProfileReport = 0.0f;
 
     std::unique_ptr<simu::Simu> _simu;
+    simu::FrameScheduler _scheduler;
 
     GLFWwindow* _window = nullptr;
     std::unique_ptr<Device> _device;
@@ -89,8 +99,11 @@ private:
 
     struct
     {
+        // Timeline semaphores, the values are the last signaled frame of each queue
         VkSemaphore graphics = VK_NULL_HANDLE;
         VkSemaphore compute = VK_NULL_HANDLE;
+        uint64_t graphicsValue = 0;
+        uint64_t computeValue = 0;
         VkFence fence = VK_NULL_HANDLE;
     } _sync;
 
@@ -16,7 +16,7 @@ namespace app::vk
 class Device final
 {
 public:
-    explicit Device(VkPhysicalDevice gpu, GLFWwindow* window);
+    explicit Device(VkPhysicalDevice gpu, GLFWwindow* window = nullptr);
     ~Device();
 
     Device() = delete;
@@ -34,6 +34,16 @@ public:
     [[nodiscard]] auto getLogicalDevice() const -> VkDevice { return _logicalDevice; }
     [[nodiscard]] auto getPhysicalDevice() const -> VkPhysicalDevice { return _physicalDevice; }
     [[nodiscard]] auto getAllocator() const -> VmaAllocator { return _allocator; }
+    [[nodiscard]] auto getPipelineCache() const -> VkPipelineCache { return _pipelineCache; }
+    [[nodiscard]] auto getProperties() const -> VkPhysicalDeviceProperties const&
+    {
+        return _physicalDeviceProperties;
+    }
+    [[nodiscard]] auto getQueueFamilyProperties(uint32_t family) const
+            -> VkQueueFamilyProperties const&
+    {
+        return _queueFamilyProperties.at(family);
+    }
 
     [[nodiscard]] auto getGraphicsQueueFamily() const -> uint32_t
     {
@@ -148,8 +158,17 @@ public:
 
     auto createSampler() -> VkSampler;
 
-    auto loadShaderFromFile(std::string const& path, VkShaderStageFlagBits stage)
+    // The specialization info is referenced, not copied, and has to outlive pipeline creation
+    auto loadShaderFromFile(
+            std::string const& path,
+            VkShaderStageFlagBits stage,
+            VkSpecializationInfo const* specialization = nullptr)
             -> VkPipelineShaderStageCreateInfo;
+
+    // Creates the pipeline cache shared by all pipelines, seeded from path when the file was
+    // written by the same device and driver. The cache is written back on destruction.
+    auto createPipelineCache(std::string const& path) -> void;
+    auto savePipelineCache() -> void;
     auto findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties) -> uint32_t;
 
 private:
@@ -162,6 +181,8 @@ private:
     [[maybe_unused]] GLFWwindow* _window;
     VmaAllocator _allocator = VK_NULL_HANDLE;
     VkDevice _logicalDevice = VK_NULL_HANDLE;
+    VkPipelineCache _pipelineCache = VK_NULL_HANDLE;
+    std::string _pipelineCachePath;
     VkPhysicalDevice _physicalDevice = VK_NULL_HANDLE;
 
     VkPhysicalDeviceProperties _physicalDeviceProperties = {};
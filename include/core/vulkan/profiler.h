@@ -0,0 +1,103 @@
+#pragma once
+
+#include "core/vulkan/device.h"
+#include "logs/log.h"
+#include "vulkan/vulkan.h"
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace app::vk
+{
+
+// Timestamp query profiler. Every command buffer that is profiled owns a scope, a fixed range of
+// queries which is reset and written when the buffer is recorded. Command buffers may be
+// resubmitted without re-recording, so each submission is announced with submitted() and
+// resolved with resolve() once it is known to be complete, which never blocks.
+class GpuProfiler final
+{
+public:
+    GpuProfiler(
+            Device* device,
+            uint32_t queueFamily,
+            uint32_t scopeCount,
+            uint32_t queriesPerScope = 8);
+    ~GpuProfiler();
+
+    GpuProfiler(GpuProfiler const&) = delete;
+    GpuProfiler(GpuProfiler&&) = delete;
+    auto operator=(GpuProfiler const&) -> GpuProfiler& = delete;
+    auto operator=(GpuProfiler&&) -> GpuProfiler& = delete;
+
+    // False when the queue family does not support timestamps
+    [[nodiscard]] auto isEnabled() const -> bool { return _pool != VK_NULL_HANDLE; }
+
+    // Resets the scope and writes its start timestamp
+    auto begin(VkCommandBuffer buf, uint32_t scope) -> void;
+    // Ends a pass that started at the previous timestamp of the scope. Cells is the number of
+    // lattice updates in the pass and bytesPerCell the modelled memory traffic of one update.
+    auto mark(
+            VkCommandBuffer buf,
+            uint32_t scope,
+            std::string name,
+            uint64_t cells,
+            uint64_t bytesPerCell) -> void;
+    // Same as mark, but measured from the start of the scope
+    auto span(
+            VkCommandBuffer buf,
+            uint32_t scope,
+            std::string name,
+            uint64_t cells,
+            uint64_t bytesPerCell) -> void;
+
+    auto submitted(uint32_t scope) -> void;
+    // Reads back the last submission of the scope if it is available
+    auto resolve(uint32_t scope) -> void;
+
+    // Logs the averages since the previous report, writes them as JSON to path and resets them
+    auto report(std::string const& path) -> void;
+
+private:
+    struct Interval
+    {
+        std::string name;
+        uint32_t from = 0;
+        uint32_t to = 0;
+        uint64_t cells = 0;
+        uint64_t bytesPerCell = 0;
+    };
+
+    struct Scope
+    {
+        std::vector<Interval> intervals;
+        uint32_t used = 0;
+        bool pending = false;
+    };
+
+    struct Stats
+    {
+        double nanoseconds = 0.0;
+        double cells = 0.0;
+        double bytes = 0.0;
+        uint64_t samples = 0;
+    };
+
+    auto timestamp(VkCommandBuffer buf, uint32_t scope, VkPipelineStageFlagBits stage)
+            -> uint32_t;
+
+    logs::Log _log;
+    Device* _device = nullptr;
+    VkQueryPool _pool = VK_NULL_HANDLE;
+    uint32_t _queriesPerScope = 0;
+    // Nanoseconds per timestamp tick
+    double _period = 1.0;
+    uint64_t _validMask = ~0ull;
+
+    std::vector<Scope> _scopes;
+    // Ordered by name so reports are stable
+    std::map<std::string, Stats> _stats;
+};
+
+} // namespace app::vk
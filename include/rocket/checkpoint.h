@@ -0,0 +1,98 @@
+#pragma once
+
+#include <array>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace params
+{
+enum class SolverKernel;
+}
+
+namespace app::simu
+{
+
+// Fixed size header in front of the lattice state. Bump the version whenever a field or the
+// payload order changes, older files are then rejected instead of misread.
+struct CheckpointHeader
+{
+    static constexpr std::array<char, 8> expectedMagic = {'R', 'D', 'L', 'B', 'M', 'C', 'K', 'P'};
+    static constexpr uint32_t currentVersion = 1;
+
+    std::array<char, 8> magic = expectedMagic;
+    uint32_t version = currentVersion;
+    int32_t width = 0;
+    int32_t height = 0;
+    // params::LatticeLayout and params::SolverKernel of the run that wrote the file
+    uint32_t layout = 0;
+    uint32_t kernel = 0;
+    // Even/odd step of the in-place AA kernel, odd states keep the populations swapped
+    uint32_t parity = 0;
+    uint64_t step = 0;
+    float tau = 0.0f;
+    uint32_t reserved = 0;
+    uint64_t payloadBytes = 0;
+};
+
+// Lattice state as the device stores it: the macroscopic planes followed by the population planes
+// of the current lattice for SoA, one record per cell for AoS
+struct Checkpoint
+{
+    CheckpointHeader header;
+    std::vector<std::byte> payload;
+};
+
+// Writes next to the target and renames over it, so a crash while writing keeps the previous file
+auto writeCheckpoint(std::string const& path, Checkpoint const& checkpoint) -> void;
+// Throws std::runtime_error for a missing file, a foreign or outdated header and short payloads
+[[nodiscard]] auto readCheckpoint(std::string const& path) -> Checkpoint;
+
+// Whether kernel picks up the lattice state the checkpoint holds. Fused and AA leave
+// post-collision populations and continue each other from an even AA step, multipass leaves
+// pre-collision populations and only continues itself.
+[[nodiscard]] auto continuesWith(CheckpointHeader const& header, params::SolverKernel kernel)
+        -> bool;
+
+// Writes checkpoints on a thread of its own so the solver keeps stepping while the previous
+// snapshot goes to disk. One snapshot is in flight at a time, a new one waits for it.
+class CheckpointWriter
+{
+public:
+    explicit CheckpointWriter(std::string path);
+    // Finishes the snapshot in flight
+    ~CheckpointWriter();
+
+    CheckpointWriter(CheckpointWriter const&) = delete;
+    CheckpointWriter(CheckpointWriter&&) = delete;
+    auto operator=(CheckpointWriter const&) -> CheckpointWriter& = delete;
+    auto operator=(CheckpointWriter&&) -> CheckpointWriter& = delete;
+
+    // Hands the snapshot over, rethrows the failure of the previous write
+    auto submit(Checkpoint checkpoint) -> void;
+    // Blocks until nothing is in flight, rethrows the failure of the last write
+    auto wait() -> void;
+
+    [[nodiscard]] auto path() const -> std::string const& { return _path; }
+
+private:
+    auto writerLoop() -> void;
+    // Called with the mutex held
+    auto rethrow() -> void;
+
+    std::string _path;
+    std::mutex _mutex;
+    std::condition_variable _changed;
+    std::optional<Checkpoint> _pending;
+    std::exception_ptr _error;
+    bool _stop = false;
+    std::thread _thread;
+};
+
+} // namespace app::simu
@@ -0,0 +1,46 @@
+#pragma once
+
+#include "common/appcontext.h"
+
+#include <cstdint>
+
+namespace app::simu::cpu
+{
+
+// Structure-of-arrays lattice as seen by the row kernels, planes of width * height values
+struct LatticeView
+{
+    int width = 0;
+    int height = 0;
+    // Nine population planes each, pulled from src and written to dst
+    float const* src = nullptr;
+    float* dst = nullptr;
+    // Macroscopic fields, read and updated in place
+    float* velocityX = nullptr;
+    float* velocityY = nullptr;
+    float* density = nullptr;
+    uint8_t const* solid = nullptr;
+    // Per row [solidBegin, solidEnd) column range holding every solid cell, empty when none
+    int const* solidBegin = nullptr;
+    int const* solidEnd = nullptr;
+    // Inverse of the BGK relaxation time
+    float omega = 1.0f;
+    // Smagorinsky constant of the eddy viscosity, 0 disables it
+    float smagorinsky = 0.0f;
+};
+
+// One fused pull-stream, boundary, macro and collide step over row y, same physics as
+// lbm_fused.comp
+using RowKernel = void (*)(LatticeView const& lattice, int y);
+
+auto streamCollideRowScalar(LatticeView const& lattice, int y) -> void;
+auto streamCollideRowAvx2(LatticeView const& lattice, int y) -> void;
+auto streamCollideRowAvx512(LatticeView const& lattice, int y) -> void;
+
+// Resolves Auto to the widest instruction set the processor runs, throws when an explicit one is
+// not available
+auto resolveIsa(params::CpuIsa isa) -> params::CpuIsa;
+auto rowKernel(params::CpuIsa isa) -> RowKernel;
+auto isaName(params::CpuIsa isa) -> char const*;
+
+} // namespace app::simu::cpu
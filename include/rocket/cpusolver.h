@@ -0,0 +1,74 @@
+#pragma once
+
+#include "common/appcontext.h"
+#include "logs/log.h"
+#include "rocket/cpukernel.h"
+#include "rocket/solver.h"
+#include "utils/numa.h"
+#include "utils/pagebuffer.h"
+#include "utils/threadpool.h"
+
+#include <array>
+#include <span>
+#include <vector>
+
+namespace app::simu
+{
+
+// Lattice Boltzmann solver on the host. Runs the same fused step as the GPU over
+// structure-of-arrays planes, rows split into one band per worker thread and vectorised with the
+// widest instruction set available. Workers are pinned across the NUMA nodes and each one first
+// touches the band it later updates, so its pages live on its own node.
+//
+// With a temporal depth above one, several steps run per sweep over the rows: inside a band the
+// steps trail each other by one row, so a row is updated again while it is still in cache. Band
+// edges shrink by one row per step and the triangles left between bands are filled in
+// afterwards. Two lattices are enough because a step never overwrites rows the previous one
+// still has to read.
+class CpuSolver final : public Solver
+{
+public:
+    explicit CpuSolver(params::Params::SimulationConfig const& config);
+
+    auto simulate(uint64_t steps) -> void override;
+    [[nodiscard]] auto getGridSize() const -> glm::ivec2 override { return _size; }
+
+    // Fields after the last step, to check the GPU kernels against
+    [[nodiscard]] auto getVelocityX() const -> std::span<float const> { return _velocityX; }
+    [[nodiscard]] auto getVelocityY() const -> std::span<float const> { return _velocityY; }
+    [[nodiscard]] auto getDensity() const -> std::span<float const> { return _density; }
+    [[nodiscard]] auto getDistribution(size_t i) const -> std::span<float const>;
+    [[nodiscard]] auto getIsa() const -> params::CpuIsa { return _isa; }
+
+private:
+    // Fills the planes from the initial lattice, every worker writing its own band of rows
+    auto firstTouch() -> void;
+    auto logTopology() const -> void;
+    // Runs depth steps in one pass over the lattice
+    auto sweep(uint32_t depth) -> void;
+    [[nodiscard]] auto latticeView(uint32_t readIndex) -> cpu::LatticeView;
+
+    logs::Log _log;
+    glm::ivec2 _size;
+    params::CpuIsa _isa;
+    cpu::RowKernel _kernel;
+    // Inverse relaxation time of the BGK collision and the Smagorinsky constant
+    float _omega = 1.0f;
+    float _smagorinsky = 0.0f;
+    uint32_t _depth = 1;
+
+    utils::NumaTopology _topology;
+    utils::ThreadPool _pool;
+
+    utils::PageBuffer<float> _velocityX;
+    utils::PageBuffer<float> _velocityY;
+    utils::PageBuffer<float> _density;
+    utils::PageBuffer<uint8_t> _solid;
+    std::vector<int> _solidBegin;
+    std::vector<int> _solidEnd;
+    // Nine planes per lattice, streamed from one into the other every step
+    std::array<utils::PageBuffer<float>, 2> _populations;
+    uint32_t _readIndex = 0;
+};
+
+} // namespace app::simu
@@ -0,0 +1,162 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <fstream>
+#include <optional>
+#include <span>
+#include <string>
+#include <vector>
+
+namespace app::simu
+{
+
+// Macroscopic fields of the lattice after a step, one row-major plane per field
+struct FieldSnapshot
+{
+    uint64_t step = 0;
+    int width = 0;
+    int height = 0;
+    std::vector<float> velocityX;
+    std::vector<float> velocityY;
+    std::vector<float> density;
+};
+
+// One line per cell in the columns visual.py reads, replacing the file as a whole
+auto writeFieldCsv(std::string const& path, FieldSnapshot const& snapshot) -> void;
+
+// z component of the curl of the velocity in lattice units, central differences inside the grid
+// and one sided ones on its edges
+[[nodiscard]] auto vorticity(FieldSnapshot const& snapshot) -> std::vector<float>;
+
+// IEEE 754 binary16, rounded to the nearest even value
+[[nodiscard]] auto toHalf(float value) -> uint16_t;
+[[nodiscard]] auto fromHalf(uint16_t half) -> float;
+
+// Frame of the velocity and density fields quantized on the device (compress_*.comp). Each
+// plane is cut into tiles of one workgroup. A tile keeps its minimum and a bit width, each of its
+// values v is stored as round((v - minimum) / (2 * errorBound)), packed least significant bit
+// first, so the decoded value is within the error bound up to float rounding. A tile whose range
+// does not fit in 31 bits keeps the bits of its floats instead (bits 32). The header is followed
+// by a QuantizedTile per tile of velocity x, velocity y and density, plane major and in row-major
+// tile order, then the packed tiles in the same order, each a whole number of 32 bit words.
+// Values of a tile are in row-major order within the tile, cells past the grid are stored as 0.
+struct QuantizedFrameHeader
+{
+    static constexpr uint32_t planes = 3;
+    static constexpr uint32_t rawBits = 32;
+
+    // Whole frame, this header included
+    uint32_t frameWords = 0;
+    uint32_t tileWidth = 0;
+    uint32_t tileHeight = 0;
+    uint32_t tilesX = 0;
+    uint32_t tilesY = 0;
+    float errorBound = 0.0f;
+    // Largest difference between a value and its decoded value in the frame, per plane
+    std::array<float, planes> maxError{};
+    std::array<uint32_t, 7> reserved{};
+};
+
+struct QuantizedTile
+{
+    float minimum = 0.0f;
+    uint32_t bits = 0;
+};
+
+// Reference of what the device writes, tiles of tileWidth x tileHeight cells
+[[nodiscard]] auto quantizeFields(
+        FieldSnapshot const& snapshot,
+        uint32_t tileWidth,
+        uint32_t tileHeight,
+        float errorBound) -> std::vector<uint32_t>;
+// Fields of a quantized frame of a width x height grid, throws on a frame that does not add up
+[[nodiscard]] auto dequantizeFields(
+        std::span<uint32_t const> frame,
+        int width,
+        int height,
+        uint64_t step) -> FieldSnapshot;
+
+// How a field series stores its values, the value is the valueBytes of the header
+enum class FieldEncoding : uint32_t
+{
+    Quantized = 0, // quantized frames of velocity and density as written by the device
+    Half = 2,      // float16
+    Float = 4,     // float32
+};
+
+// Binary time series of the fields, read by fieldseries.py. With float values the file header is
+// followed by frames of one fixed size, so frame i starts at headerBytes + i * frameBytes and the
+// file can be memory mapped and indexed without scanning it. Each frame is a FieldFrameHeader and
+// the planes velocity x, velocity y, density and vorticity of width * height values in row-major
+// order, padded to 16 bytes. Quantized frames vary in size (frameBytes 0): a FieldFrameHeader and
+// a QuantizedFrameHeader frame padded to 16 bytes, readers step from one frame header to the next
+// and derive the vorticity themselves. A frame cut short by a crash is ignored by readers and
+// overwritten by the next writer. All values are little endian.
+struct FieldSeriesHeader
+{
+    static constexpr std::array<char, 8> expectedMagic = {'R', 'D', 'F', 'I', 'E', 'L', 'D', 'S'};
+    static constexpr uint32_t currentVersion = 2;
+    static constexpr uint32_t planes = 4;
+
+    std::array<char, 8> magic = expectedMagic;
+    uint32_t version = currentVersion;
+    uint32_t headerBytes = 64;
+    int32_t width = 0;
+    int32_t height = 0;
+    // A FieldEncoding: 2 for float16, 4 for float32 and 0 for quantized values
+    uint32_t valueBytes = 4;
+    uint32_t planeCount = planes;
+    uint64_t frameBytes = 0;
+    std::array<uint8_t, 24> reserved{};
+};
+
+struct FieldFrameHeader
+{
+    static constexpr std::array<char, 4> expectedMagic = {'F', 'R', 'A', 'M'};
+
+    std::array<char, 4> magic = expectedMagic;
+    // Bytes up to the next frame header
+    uint32_t payloadBytes = 0;
+    uint64_t step = 0;
+};
+
+// Appends frames to a field series. A run restarted from a checkpoint at resumeStep continues a
+// file with the same grid and encoding after its last whole frame up to that step. Anything else,
+// and every file of a fresh run, is replaced.
+class FieldSeriesWriter
+{
+public:
+    FieldSeriesWriter(
+            std::string path,
+            int width,
+            int height,
+            FieldEncoding encoding,
+            std::optional<uint64_t> resumeStep = std::nullopt);
+
+    // Series of float values
+    auto append(FieldSnapshot const& snapshot) -> void;
+    // Quantized series, the frame is stored as it is
+    auto append(uint64_t step, std::span<uint32_t const> frame) -> void;
+
+    [[nodiscard]] auto header() const -> FieldSeriesHeader const& { return _header; }
+    [[nodiscard]] auto frames() const -> uint64_t { return _frames; }
+
+private:
+    [[nodiscard]] auto encoding() const -> FieldEncoding
+    {
+        return static_cast<FieldEncoding>(_header.valueBytes);
+    }
+    // Number of whole frames up to lastStep at the start of the file, and where they end
+    auto scanFrames(uint64_t lastStep) -> uint64_t;
+    auto write() -> void;
+
+    std::string _path;
+    FieldSeriesHeader _header;
+    std::ofstream _file;
+    uint64_t _frames = 0;
+    // Scratch space of one frame, reused between appends
+    std::vector<char> _frame;
+};
+
+} // namespace app::simu
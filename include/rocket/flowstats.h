@@ -0,0 +1,54 @@
+#pragma once
+
+#include <cstdint>
+#include <fstream>
+#include <optional>
+#include <string>
+
+namespace app::simu
+{
+
+// Flow statistics the reduction passes (flow_stats*.comp) leave in a readback slot, in lattice
+// units. Mass and kinetic energy are sums over the fluid cells. The force on the solids is the
+// momentum exchanged over every link between a fluid and a solid cell by the post-collision
+// populations of the last step.
+struct FlowStatistics
+{
+    float mass = 0.0f;
+    float kineticEnergy = 0.0f;
+    float forceX = 0.0f;
+    float forceY = 0.0f;
+    float maxSpeed = 0.0f;
+    float minDensity = 0.0f;
+    float maxDensity = 0.0f;
+    float pad = 0.0f;
+};
+
+// Coefficient 2 F / (rho U^2 D) of a force per unit length on a body of diameter D in a flow of
+// density rho and speed U
+[[nodiscard]] auto forceCoefficient(float force, float density, float velocity, float diameter)
+        -> float;
+
+// Time history of the flow statistics as CSV, one line per sample with the drag and lift
+// coefficients of the force for the given reference speed and length. A run restarted from a
+// checkpoint at resumeStep continues the history of the file, dropping the samples past that
+// step. Without a resume step the file is replaced.
+class FlowStatsWriter
+{
+public:
+    FlowStatsWriter(
+            std::string path,
+            float referenceVelocity,
+            float referenceLength,
+            std::optional<uint64_t> resumeStep = std::nullopt);
+
+    auto append(uint64_t step, FlowStatistics const& statistics) -> void;
+
+private:
+    std::string _path;
+    std::ofstream _file;
+    float _referenceVelocity = 1.0f;
+    float _referenceLength = 1.0f;
+};
+
+} // namespace app::simu
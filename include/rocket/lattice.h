@@ -0,0 +1,59 @@
+#pragma once
+
+#include "glm/vec2.hpp"
+
+#include <array>
+#include <cstddef>
+
+namespace app::simu
+{
+
+struct GridCell
+{
+    glm::vec2 velocity = glm::vec2(0.0f);
+    float density = 0.0f;
+    int isSolid = 0;
+    std::array<float, 9> distribution{};
+    int pad = 0;
+};
+
+// Lattice velocities for each direction in the 2DQ9 model
+constexpr std::array<glm::ivec2, 9> latticeVelocities = {
+        glm::ivec2(0, 0),   // rest
+        glm::ivec2(1, 0),   // right
+        glm::ivec2(0, 1),   // top
+        glm::ivec2(-1, 0),  // left
+        glm::ivec2(0, -1),  // bottom
+        glm::ivec2(1, 1),   // top-right
+        glm::ivec2(-1, 1),  // top-left
+        glm::ivec2(-1, -1), // bottom-left
+        glm::ivec2(1, -1)   // bottom-right
+};
+
+// Weights for each direction in the 2DQ9 model
+constexpr std::array<float, 9> latticeWeights = {
+        4.0f / 9.0f,  // rest
+        1.0f / 9.0f,  // right
+        1.0f / 9.0f,  // top
+        1.0f / 9.0f,  // left
+        1.0f / 9.0f,  // bottom
+        1.0f / 36.0f, // top-right
+        1.0f / 36.0f, // top-left
+        1.0f / 36.0f, // bottom-left
+        1.0f / 36.0f  // bottom-right
+};
+
+// Speed the inlet is driven at, INFLOW_VELOCITY of lbm.glsl. The CPU kernels ramp up to it and
+// it is the reference speed of the drag and lift coefficients.
+constexpr float inletVelocity = 8.0f;
+
+auto equilibriumDistribution(size_t i, float rho, glm::vec2 u) -> float;
+
+// Diameter of the cylinder obstacle of a lattice of the given size
+[[nodiscard]] auto cylinderDiameter(glm::ivec2 size) -> float;
+
+// Starting state of the cell at pos: fluid at rest around a cylinder obstacle, every population
+// in equilibrium. init.comp writes the same state on the GPU.
+auto initialCell(glm::ivec2 size, glm::ivec2 pos) -> GridCell;
+
+} // namespace app::simu
@@ -0,0 +1,97 @@
+#pragma once
+
+#include "common/appcontext.h"
+#include "core/vulkan/device.h"
+#include "core/vulkan/vktypes.h"
+#include "glm/vec2.hpp"
+#include "logs/log.h"
+#include "rocket/fieldoutput.h"
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <span>
+#include <thread>
+#include <vector>
+#include <vulkan/vulkan.h>
+
+namespace app::simu
+{
+
+// Ring of persistently mapped host memory the fields are read back into after selected steps,
+// one fixed size slot per readback. Every slot has its own fence. A background thread waits for
+// the slots in submission order and hands their bytes to the consumers, so neither the compute
+// queue nor the thread submitting to it ever waits for output. When every slot is still in
+// flight a readback is dropped instead.
+class FieldReadback final
+{
+public:
+    // Records the commands that fill the slot starting at offset bytes into the ring, either a
+    // transfer or compute passes writing the ring directly. They are ordered after everything
+    // submitted to the compute queue earlier.
+    using Fill = std::function<void(VkCommandBuffer buf, VkDeviceSize offset)>;
+    // Runs on the readback thread with the whole slot
+    using Consumer = std::function<void(uint64_t step, std::span<std::byte const> slot)>;
+
+    FieldReadback(FieldReadback const&) = delete;
+    FieldReadback(FieldReadback&&) = delete;
+    auto operator=(FieldReadback const&) -> FieldReadback& = delete;
+    auto operator=(FieldReadback&&) -> FieldReadback& = delete;
+
+    // The ring is also a storage buffer, for passes that write it
+    FieldReadback(vk::Device* device, VkDeviceSize slotBytes, uint32_t slots);
+    // Waits for the slots in flight and hands them to the consumers
+    ~FieldReadback();
+
+    [[nodiscard]] auto ring() const -> vk::Buffer const& { return _ring; }
+    // Consumers are added before the first readback
+    auto addConsumer(Consumer consumer) -> void;
+    // Fills the next slot after everything submitted to the compute queue so far. Must be called
+    // from the thread that submits the solver steps. Returns false when no slot was free.
+    auto submit(uint64_t step, Fill const& fill) -> bool;
+
+private:
+    struct Slot
+    {
+        VkDeviceSize offset = 0;
+        VkFence fence = VK_NULL_HANDLE;
+        VkCommandBuffer commands = VK_NULL_HANDLE;
+        uint64_t step = 0;
+        bool busy = false;
+    };
+
+    auto record(Slot& slot, Fill const& fill) -> void;
+    auto drainLoop() -> void;
+
+    logs::Log _log;
+    vk::Device* _device = nullptr;
+    VkDeviceSize _slotBytes = 0;
+    vk::Buffer _ring;
+    std::vector<Consumer> _consumers;
+
+    std::vector<Slot> _slots;
+    // Slot the next readback goes to, slots are used in ring order
+    uint32_t _next = 0;
+    uint64_t _dropped = 0;
+
+    std::mutex _mutex;
+    std::condition_variable _submitted;
+    // Slots waiting for their fence, oldest first
+    std::deque<uint32_t> _inFlight;
+    bool _stop = false;
+    std::thread _thread;
+};
+
+// Bytes of a slot holding a copy of the velocity and density fields of one lattice: the planes
+// for SoA, the cell records for AoS
+[[nodiscard]] auto fieldCopyBytes(params::LatticeLayout layout, glm::ivec2 size) -> VkDeviceSize;
+// Fields of a slot filled with such a copy
+[[nodiscard]] auto unpackFieldCopy(
+        std::span<std::byte const> slot,
+        params::LatticeLayout layout,
+        glm::ivec2 size,
+        uint64_t step) -> FieldSnapshot;
+
+} // namespace app::simu
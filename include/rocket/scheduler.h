@@ -0,0 +1,38 @@
+#pragma once
+
+#include "common/appcontext.h"
+
+#include <cstdint>
+
+namespace app::simu
+{
+
+// Decides how many solver steps run per displayed frame and on which frames the field is
+// rendered, so the solver rate is not tied to the presentation rate.
+class FrameScheduler
+{
+public:
+    struct Frame
+    {
+        uint32_t steps = 1;
+        bool render = true;
+    };
+
+    explicit FrameScheduler(params::Params::SimulationConfig const& config);
+
+    // frameTime is the duration of the previous frame in seconds
+    auto next(float frameTime) -> Frame;
+
+    [[nodiscard]] auto getStepsPerFrame() const -> uint32_t { return _steps; }
+
+private:
+    static constexpr uint32_t maxSteps = 4096;
+
+    uint32_t _steps;
+    // Frame time budget in seconds, 0 keeps the step count fixed
+    float _budget;
+    uint32_t _renderInterval;
+    uint64_t _frame = 0;
+};
+
+} // namespace app::simu
@@ -1,26 +1,27 @@
 #pragma once
 
+#include "common/appcontext.h"
 #include "core/vulkan/descriptorgen.h"
 #include "core/vulkan/device.h"
+#include "core/vulkan/profiler.h"
 #include "core/vulkan/vktypes.h"
 #include "glm/vec2.hpp"
 #include "glm/vec3.hpp"
 #include "glm/vec4.hpp"
+#include "logs/log.h"
+#include "rocket/checkpoint.h"
+#include "rocket/lattice.h"
+#include "rocket/readback.h"
+#include "rocket/solver.h"
+#include "rocket/stablefluids.h"
 
 #include <vulkan/vulkan.h>
 
+#include <optional>
+
 namespace app::simu
 {
 
-struct GridCell
-{
-    glm::vec2 velocity = glm::vec2(0.0f);
-    float density = 0.0f;
-    int isSolid = 0;
-    std::array<float, 9> distribution{};
-    int pad = 0;
-};
-
 struct ComputeUniformBuffer
 {
     glm::vec4 color = glm::vec4(0.5f, 0.5f, 0.5f, 1.0f);
@@ -29,85 +30,180 @@ struct ComputeUniformBuffer
     int enabled = 0;
 };
 
+// Specialization constants of the lattice Boltzmann shaders, one 32 bit value per constant_id of
+// common.glsl and compress.glsl in order
+struct LatticeSpecialization
+{
+    uint32_t workgroupWidth = 16;
+    uint32_t workgroupHeight = 16;
+    int32_t gridWidth = 1;
+    int32_t gridHeight = 1;
+    float tau = 0.85f;
+    int32_t collision = 0;
+    float trtMagic = 0.25f;
+    float mrtBulkRate = 1.4f;
+    float mrtFluxRate = 1.2f;
+    float smagorinsky = 0.0f;
+    float outputErrorBound = 0.001f;
+};
+
 struct ComputePushConstant
 {
     uint32_t readBufferOffset = 0;
     uint32_t writeBufferOffset = 0;
+    uint32_t parity = 0;
+    // Word of a readback ring the compression or statistics passes write their result at
+    uint32_t outputOffset = 0;
 };
 
-class Simu
-{ // Lattice velocities for each direction in the 2DQ9 model
-    const std::array<glm::vec2, 9> ei = {
-            glm::vec2(0, 0),   // rest
-            glm::vec2(1, 0),   // right
-            glm::vec2(0, 1),   // top
-            glm::vec2(-1, 0),  // left
-            glm::vec2(0, -1),  // bottom
-            glm::vec2(1, 1),   // top-right
-            glm::vec2(-1, 1),  // top-left
-            glm::vec2(-1, -1), // bottom-left
-            glm::vec2(1, -1)   // bottom-right
-    };
-
-    // Weights for each direction in the 2DQ9 model
-    const std::array<float, 9> wi = {
-            4.0f / 9.0f,  // rest
-            1.0f / 9.0f,  // right
-            1.0f / 9.0f,  // top
-            1.0f / 9.0f,  // left
-            1.0f / 9.0f,  // bottom
-            1.0f / 36.0f, // top-right
-            1.0f / 36.0f, // top-left
-            1.0f / 36.0f, // bottom-left
-            1.0f / 36.0f  // bottom-right
-    };
-
+class Simu final : public Solver
+{
 public:
     Simu(Simu const&) = delete;
     Simu(Simu&&) = delete;
     auto operator=(Simu const&) -> Simu& = delete;
     auto operator=(Simu&&) -> Simu& = delete;
 
-    Simu(vk::Device* device, uint32_t imageCount);
+    Simu(
+            vk::Device* device,
+            uint32_t imageCount,
+            params::Params::SimulationConfig const& config);
     ~Simu();
 
     auto clean() -> void;
     // auto getImageInfo() -> VkDescriptorImageInfo { return _imageInfo; }
-    auto recordCommandBuffer(uint32_t index) -> VkCommandBuffer;
+    // Compute queue command buffer running the given number of solver steps. Buffers are cached
+    // per image and lattice phase and only re-recorded when the step count changes.
+    auto recordCommandBuffer(uint32_t index, uint32_t steps) -> VkCommandBuffer;
+    // Compute queue command buffer that acquires the render image from graphics, renders the
+    // field when requested and releases the image back to graphics
+    auto renderCommandBuffer(bool render) -> VkCommandBuffer;
+    // Graphics queue side of the render image ownership transfer
+    auto acquireRenderImage(VkCommandBuffer buf) -> void;
+    auto releaseRenderImage(VkCommandBuffer buf) -> void;
+    // Logs and dumps the GPU pass timings gathered since the last report, if profiling
+    auto reportProfile() -> void;
+    // Forces the cached command buffers to be re-recorded for a new swapchain of imageCount
+    // images, reallocating them when the count changed. The device must be idle.
+    auto invalidateCommandBuffers(uint32_t imageCount) -> void;
+    // Runs the solver on the compute queue without rendering, blocks until done
+    auto simulate(uint64_t steps) -> void override;
+    // Queues a copy of the lattice once checkpointInterval steps passed since the last one. The
+    // copy is ordered after every step submitted so far and never waited for, the readback
+    // thread hands it to the checkpoint writer. Tried again at the next call while the previous
+    // copy is in flight.
+    auto checkpointIfDue() -> void;
+    // Queues a copy of the velocity and density fields once outputInterval steps passed since
+    // the last one. Never waits, the copy is dropped when every readback slot is in flight.
+    auto outputIfDue() -> void;
+    // Queues the reduction of the flow statistics once statsInterval steps passed since the last
+    // one, dropped like a field readback when its slots are all in flight
+    auto statisticsIfDue() -> void;
     auto update(float time, float elapsed, uint32_t index) -> void;
-    [[nodiscard]] auto getGridSize() const -> glm::ivec2 { return _grid.size; }
+    [[nodiscard]] auto getGridSize() const -> glm::ivec2 override { return _grid.size; }
+    // Bytes moved by one cell update of a full step, each float read or written counted once
+    [[nodiscard]] static auto modelledBytesPerCell(params::Params::SimulationConfig const& config)
+            -> uint64_t;
     // [[nodiscard]] auto getGridBufferInfo() const -> VkDescriptorBufferInfo;
     [[nodiscard]] auto getRenderImageInfo() -> VkDescriptorImageInfo;
 
 private:
-    auto generateGrid() -> void;
+    [[nodiscard]] auto isStableFluids() const -> bool
+    {
+        return _config.engine == params::SolverEngine::StableFluids;
+    }
+    // Allocates the lattice buffer in device memory
+    auto createGrid() -> void;
+    // Writes the starting state with init.comp
+    auto initializeGrid() -> void;
     auto createUniformBuffers() -> void;
     auto createRenderTarget() -> void;
     auto AllocateCommandBuffer(uint32_t count) -> void;
+    // Two step command buffers per swapchain image, one for each lattice phase
+    auto allocateStepBuffers(uint32_t count) -> void;
+    // Only when profiling, a scope per command buffer
+    auto createProfiler() -> void;
+    // Readback ring, and the compression scratch with quantized output. The series is continued
+    // up to resumeStep when restarting, replaced otherwise.
+    auto createFieldOutput(std::optional<uint64_t> resumeStep) -> void;
+    // Readback ring of the flow statistics and the partials of their reduction. The history is
+    // continued up to resumeStep when restarting, replaced otherwise.
+    auto createFlowStatistics(std::optional<uint64_t> resumeStep) -> void;
     auto setupDescriptors(uint32_t count) -> void;
+    // Set with every binding of the layout written, applied by the next updateSetContents
+    [[nodiscard]] auto generateDescriptorSet() -> VkDescriptorSet;
     auto createComputePipeline() -> void;
-    auto equilibriumDistribution(size_t i, float rho, glm::vec2 u) -> float;
+    // Records the lattice steps and the barriers between them, no render pass. Scope is the
+    // profiler scope owned by the command buffer.
+    auto recordSteps(VkCommandBuffer buf, uint32_t steps, uint32_t scope) -> void;
+    [[nodiscard]] auto groupCount() const -> glm::uvec2;
+    // Which of the two alternating lattice states the next step starts from
+    [[nodiscard]] auto phase() const -> uint32_t;
+    // Moves the lattice state forward as if the steps had been recorded
+    auto advance(uint32_t steps) -> void;
+    // Hands the render image over to the compute queue family
+    auto transferOwnership() -> void;
+    auto renderImageBarrier(
+            VkCommandBuffer buf,
+            uint32_t srcQueueFamily,
+            uint32_t dstQueueFamily,
+            VkPipelineStageFlags srcStage,
+            VkPipelineStageFlags dstStage,
+            VkAccessFlags srcAccess,
+            VkAccessFlags dstAccess) -> void;
+    // Number of copies of the populations kept on the device
+    [[nodiscard]] auto latticeCount() const -> uint32_t;
+    // SPIR-V path of a lattice shader compiled for the selected layout
+    [[nodiscard]] auto latticeShaderPath(std::string const& name) const -> std::string;
+    // Byte ranges of the current lattice state in the grid buffer (src) and in a checkpoint
+    // payload (dst)
+    [[nodiscard]] auto checkpointRegions() const -> std::vector<VkBufferCopy>;
+    // Checkpoint writer and the readback slot the lattice state is copied to
+    auto createCheckpointReadback() -> void;
+    // Fill of the checkpoint slot with the current lattice state, also sets its header
+    auto recordCheckpointCopy(VkCommandBuffer buf, VkDeviceSize offset) -> void;
+    // Throws when the checkpoint read from restartPath does not fit this lattice and kernel
+    auto checkRestart(Checkpoint const& checkpoint) const -> void;
+    // Replaces the starting state with the one of a checked checkpoint
+    auto restoreCheckpoint(Checkpoint const& checkpoint) -> void;
+    [[nodiscard]] auto compressesOutput() const -> bool
+    {
+        return _config.outputInterval > 0
+               && _config.outputPrecision == params::OutputPrecision::Quantized;
+    }
+    // Fill of a readback slot with the fields of the current lattice as they are
+    auto recordFieldCopy(VkCommandBuffer buf, VkDeviceSize offset) -> void;
+    // Fill of a readback slot with a quantized frame of the fields
+    auto recordFieldCompression(VkCommandBuffer buf, VkDeviceSize offset) -> void;
+    // Fill of a readback slot with the FlowStatistics of the current lattice
+    auto recordFlowStatistics(VkCommandBuffer buf, VkDeviceSize offset) -> void;
 
 private:
+    logs::Log _log;
     vk::Device* _device = nullptr;
+    params::Params::SimulationConfig _config;
     ComputeUniformBuffer _ubo;
     std::shared_ptr<app::vk::DescriptorSetGenerator> _descGen;
 
     vk::Buffer _uniformBuffer;
+    std::unique_ptr<vk::GpuProfiler> _profiler;
 
     // Texture for compute to draw on
     vk::Texture _texture;
 
     struct
     {
-        std::vector<GridCell> data;
-
         uint32_t readBufferIndex = 0;
-        uint32_t writeBufferIndex = 0;
-        // This buffer contains data for both read and write. alternating between every frame read
-        // and write indices are swapped.
+        uint32_t writeBufferIndex = 1;
+        // Even/odd step of the in-place AA kernel
+        uint32_t parity = 0;
+        // This buffer contains data for both read and write lattices. Read and write indices are
+        // swapped after every pass that streams from one lattice into the other. The in-place AA
+        // kernel keeps a single lattice and never swaps.
         vk::Buffer buffers;
-        glm::ivec2 size = {1024*2, 256*2};
+        glm::ivec2 size = {0, 0};
+        // Steps taken since the initial state, continued from a checkpoint on restart
+        uint64_t step = 0;
     } _grid;
 
     struct
@@ -119,20 +215,58 @@ private:
         VkPipeline streaming = VK_NULL_HANDLE;
         VkPipeline boundary = VK_NULL_HANDLE;
         VkPipeline macro = VK_NULL_HANDLE;
-
-        // velocity step
-        // VkPipeline v_forces = VK_NULL_HANDLE;
-        // VkPipeline v_diffuse = VK_NULL_HANDLE;
-        // VkPipeline v_advect = VK_NULL_HANDLE;
-        // VkPipeline v_project = VK_NULL_HANDLE;
-        // VkPipeline v_divergence = VK_NULL_HANDLE;
-        // VkPipeline v_update = VK_NULL_HANDLE;
+        // stream + boundary + macro + collision in a single pass
+        VkPipeline fused = VK_NULL_HANDLE;
+        // in-place AA-pattern step, even and odd selected by push constant
+        VkPipeline aa = VK_NULL_HANDLE;
+        // starting state, written at the push constant write offset
+        VkPipeline init = VK_NULL_HANDLE;
 
         // render
         VkPipeline render = VK_NULL_HANDLE;
+
+        // field compression ahead of the readback, only with quantized output
+        VkPipeline compressQuantize = VK_NULL_HANDLE;
+        VkPipeline compressScan = VK_NULL_HANDLE;
+        VkPipeline compressPack = VK_NULL_HANDLE;
+
+        // flow statistics, per workgroup and over the workgroups
+        VkPipeline flowStats = VK_NULL_HANDLE;
+        VkPipeline flowStatsReduce = VK_NULL_HANDLE;
+
+        // Two per swapchain image, one for each lattice phase
         std::vector<VkCommandBuffer> commandBuffers;
+        struct Recorded
+        {
+            uint32_t steps = 0;
+            bool valid = false;
+        };
+        std::vector<Recorded> recorded;
+        // Render for lattice phase 0 and 1, and ownership transfer only
+        std::array<VkCommandBuffer, 3> renderBuffers{};
+        std::array<bool, 3> renderRecorded{};
     } _compute;
 
+    // Pipelines of the Stable Fluids engine, the lattice pipelines are not created with it
+    std::unique_ptr<StableFluids> _fluids;
+
+    // Only with a checkpoint interval
+    std::unique_ptr<CheckpointWriter> _checkpointWriter;
+    std::unique_ptr<FieldReadback> _checkpointReadback;
+    uint64_t _checkpointStep = 0;
+    // Of the copy in flight, read by the readback thread
+    CheckpointHeader _checkpointHeader;
+    // Only with an output interval
+    std::unique_ptr<FieldReadback> _readback;
+    uint64_t _outputStep = 0;
+    // Packed tiles and their layout between the compression passes, see compress.glsl
+    vk::Buffer _outputScratch;
+    // Only with a statistics interval
+    std::unique_ptr<FieldReadback> _statistics;
+    uint64_t _statisticsStep = 0;
+    // Sums and maxima of every workgroup, see stats.glsl
+    vk::Buffer _statisticsPartials;
+
     struct
     {
         VkDescriptorPool pool = VK_NULL_HANDLE;
@@ -0,0 +1,24 @@
+#pragma once
+
+#include "glm/vec2.hpp"
+
+#include <cstdint>
+
+namespace app::simu
+{
+
+// Common interface of the lattice Boltzmann backends
+class Solver
+{
+public:
+    virtual ~Solver() = default;
+
+    // Advances the lattice by the given number of steps, blocks until done
+    virtual auto simulate(uint64_t steps) -> void = 0;
+    [[nodiscard]] virtual auto getGridSize() const -> glm::ivec2 = 0;
+};
+
+// Runs the steps, logs the achieved throughput and returns the wall time in seconds
+auto timedSimulate(Solver& solver, uint64_t steps) -> double;
+
+} // namespace app::simu
@@ -0,0 +1,133 @@
+#pragma once
+
+#include "common/appcontext.h"
+#include "core/vulkan/device.h"
+#include "glm/vec2.hpp"
+
+#include <functional>
+#include <vector>
+#include <vulkan/vulkan.h>
+
+namespace app::simu
+{
+
+// Field slots read and written by a Stable Fluids pass, mirrors stablefluids.glsl
+struct FluidPushConstant
+{
+    uint32_t velocityRead = 0;
+    uint32_t velocityWrite = 0;
+    // Right hand side of the viscous solve
+    uint32_t velocitySource = 0;
+    uint32_t pressureRead = 0;
+    uint32_t pressureWrite = 0;
+    // Multigrid level, red-black colour, number of levels and residual tolerance
+    uint32_t level = 0;
+    uint32_t color = 0;
+    uint32_t levels = 1;
+    float tolerance = 0.0f;
+};
+
+// Eulerian incompressible solver after Stam's Stable Fluids: semi-Lagrangian advection, implicit
+// viscosity and a pressure projection. The fields live in their own planes of the grid buffer
+// (see stablefluids.glsl and multigrid.glsl), the descriptor set, pipeline layout, command
+// buffers and profiler are Simu's.
+class StableFluids final
+{
+public:
+    // Ends a profiled stage made of the dispatches since the previous one
+    using Mark = std::function<void(char const* name, uint64_t bytesPerCell)>;
+
+    StableFluids(StableFluids const&) = delete;
+    StableFluids(StableFluids&&) = delete;
+    auto operator=(StableFluids const&) -> StableFluids& = delete;
+    auto operator=(StableFluids&&) -> StableFluids& = delete;
+
+    StableFluids(
+            vk::Device* device,
+            VkPipelineLayout layout,
+            VkBuffer fields,
+            params::Params::SimulationConfig const& config);
+    ~StableFluids();
+
+    // Size of the field planes, plus the multigrid hierarchy or the conjugate gradient vectors
+    [[nodiscard]] static auto bufferSize(params::Params::SimulationConfig const& config)
+            -> VkDeviceSize;
+    // Bytes moved by one cell update of a full step, each float read or written counted once.
+    // Multigrid and conjugate gradient are modelled with every cycle or iteration running.
+    [[nodiscard]] static auto modelledBytesPerCell(
+            params::Params::SimulationConfig const& config) -> uint64_t;
+
+    // Writes the starting state of every field
+    auto recordInit(VkCommandBuffer buf) -> void;
+    // One time step. Velocity and pressure start and end in slot 0, so a step can be recorded
+    // once and resubmitted.
+    auto recordStep(VkCommandBuffer buf, Mark const& mark) -> void;
+    // Velocity magnitude into the render image
+    auto recordRender(VkCommandBuffer buf) -> void;
+
+private:
+    auto createPipelines() -> void;
+    auto push(VkCommandBuffer buf, FluidPushConstant const& pc) -> void;
+    // Dispatches over a multigrid level, directly or with the arguments left on the device by
+    // mg_converged or cg_beta
+    auto dispatch(VkCommandBuffer buf, VkPipeline pipeline, uint32_t level, bool indirect = false)
+            -> void;
+    // Second pass of a reduction as a single workgroup. The indirect form reads the single
+    // workgroup arguments of the conjugate gradient solver.
+    auto reduce(VkCommandBuffer buf, VkPipeline pipeline, bool indirect) -> void;
+    // Makes the writes of the previous dispatch visible to shaders and indirect dispatches
+    auto barrier(VkCommandBuffer buf) -> void;
+    auto recordJacobi(VkCommandBuffer buf) -> void;
+    auto recordMultigrid(VkCommandBuffer buf) -> void;
+    auto recordConjugateGradient(VkCommandBuffer buf) -> void;
+    // Pressure iterations run in pairs so the solution ends in the slot it started from
+    [[nodiscard]] static auto pressureIterations(params::Params::SimulationConfig const& config)
+            -> uint32_t;
+
+private:
+    vk::Device* _device = nullptr;
+    VkPipelineLayout _layout = VK_NULL_HANDLE;
+    VkBuffer _fields = VK_NULL_HANDLE;
+    params::Params::SimulationConfig _config;
+    // Multigrid level sizes, the grid first
+    std::vector<glm::ivec2> _levels;
+    // Byte offset of the indirect dispatch arguments in the grid buffer, those of level 0 for
+    // multigrid and those of the full grid for conjugate gradient
+    VkDeviceSize _argumentsOffset = 0;
+
+    struct
+    {
+        VkPipeline init = VK_NULL_HANDLE;
+        VkPipeline advect = VK_NULL_HANDLE;
+        VkPipeline diffuse = VK_NULL_HANDLE;
+        VkPipeline divergence = VK_NULL_HANDLE;
+        VkPipeline project = VK_NULL_HANDLE;
+        VkPipeline update = VK_NULL_HANDLE;
+        VkPipeline render = VK_NULL_HANDLE;
+
+        // multigrid pressure solve
+        VkPipeline mask = VK_NULL_HANDLE;
+        VkPipeline smooth = VK_NULL_HANDLE;
+        VkPipeline residual = VK_NULL_HANDLE;
+        VkPipeline restriction = VK_NULL_HANDLE;
+        VkPipeline prolongation = VK_NULL_HANDLE;
+        VkPipeline norm = VK_NULL_HANDLE;
+        VkPipeline converged = VK_NULL_HANDLE;
+
+        // conjugate gradient pressure solve, one of the two preconditioners
+        struct
+        {
+            VkPipeline residual = VK_NULL_HANDLE;
+            VkPipeline jacobi = VK_NULL_HANDLE;
+            VkPipeline poissonUpper = VK_NULL_HANDLE;
+            VkPipeline poissonLower = VK_NULL_HANDLE;
+            VkPipeline apply = VK_NULL_HANDLE;
+            VkPipeline alpha = VK_NULL_HANDLE;
+            VkPipeline update = VK_NULL_HANDLE;
+            VkPipeline beta = VK_NULL_HANDLE;
+            VkPipeline direction = VK_NULL_HANDLE;
+        } cg;
+    } _pipelines;
+};
+
+} // namespace app::simu
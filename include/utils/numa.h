@@ -0,0 +1,36 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace utils
+{
+
+// NUMA nodes and the processors this process may run on, read from sysfs. Machines without the
+// node directory show up as a single node holding every allowed processor.
+struct NumaTopology
+{
+    struct Node
+    {
+        int id = 0;
+        std::vector<int> cpus;
+        // Total memory of the node, 0 when unknown
+        uint64_t memoryBytes = 0;
+    };
+    std::vector<Node> nodes;
+
+    static auto detect() -> NumaTopology;
+
+    [[nodiscard]] auto cpuCount() const -> uint32_t;
+    // Processor for each of the workers. Workers are spread over the nodes in proportion to their
+    // processors and kept contiguous, so neighbouring row bands share a node.
+    [[nodiscard]] auto placement(uint32_t workers) const -> std::vector<int>;
+    // Node owning the processor, -1 when unknown
+    [[nodiscard]] auto nodeOf(int cpu) const -> int;
+};
+
+// Parses a sysfs cpu list such as "0-3,8,10-11"
+auto parseCpuList(std::string const& list) -> std::vector<int>;
+
+} // namespace utils
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+#include <span>
+#include <type_traits>
+#include <utility>
+#include <unistd.h>
+
+namespace utils
+{
+
+// Page aligned array of trivial values that is left uninitialised, so the physical pages are only
+// placed once a thread first writes them. Lets every worker fault in its own slab on its own
+// NUMA node.
+template<typename T>
+class PageBuffer
+{
+    static_assert(std::is_trivial_v<T>);
+
+public:
+    PageBuffer() = default;
+    explicit PageBuffer(size_t count) : _count(count)
+    {
+        auto const page = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+        auto const bytes = (count * sizeof(T) + page - 1) / page * page;
+        _data = static_cast<T*>(std::aligned_alloc(page, bytes));
+        if(_data == nullptr && bytes > 0)
+        {
+            throw std::bad_alloc();
+        }
+    }
+    ~PageBuffer() { std::free(_data); }
+
+    PageBuffer(PageBuffer const&) = delete;
+    auto operator=(PageBuffer const&) -> PageBuffer& = delete;
+    PageBuffer(PageBuffer&& other) noexcept { swap(other); }
+    auto operator=(PageBuffer&& other) noexcept -> PageBuffer&
+    {
+        swap(other);
+        return *this;
+    }
+
+    [[nodiscard]] auto data() -> T* { return _data; }
+    [[nodiscard]] auto data() const -> T const* { return _data; }
+    [[nodiscard]] auto size() const -> size_t { return _count; }
+    auto operator[](size_t i) -> T& { return _data[i]; }
+    auto operator[](size_t i) const -> T const& { return _data[i]; }
+    operator std::span<T const>() const { return {_data, _count}; }
+
+private:
+    auto swap(PageBuffer& other) noexcept -> void
+    {
+        std::swap(_data, other._data);
+        std::swap(_count, other._count);
+    }
+
+    T* _data = nullptr;
+    size_t _count = 0;
+};
+
+} // namespace utils
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <pthread.h>
+#include <sched.h>
+
+namespace utils
+{
+
+// Fixed set of worker threads running one data parallel job at a time. The calling thread takes
+// part as worker 0, so a pool of one thread runs everything inline.
+class ThreadPool
+{
+public:
+    // Work on the items [begin, end), worker is the index of the thread running it
+    using Job = std::function<void(size_t begin, size_t end, uint32_t worker)>;
+
+    // 0 uses every hardware thread. When cpus is given, worker i is pinned to cpus[i] with the
+    // calling thread as worker 0, whose affinity is restored when the pool goes away.
+    explicit ThreadPool(uint32_t threads = 0, std::vector<int> const& cpus = {});
+    ~ThreadPool();
+
+    ThreadPool(ThreadPool const&) = delete;
+    ThreadPool(ThreadPool&&) = delete;
+    auto operator=(ThreadPool const&) -> ThreadPool& = delete;
+    auto operator=(ThreadPool&&) -> ThreadPool& = delete;
+
+    // Splits [0, count) into one contiguous range per worker and blocks until all are done.
+    // A worker always gets the same range for the same count.
+    auto parallelFor(size_t count, Job const& job) -> void;
+
+    [[nodiscard]] auto size() const -> uint32_t
+    {
+        return static_cast<uint32_t>(_workers.size()) + 1;
+    }
+
+    // Processor the worker is pinned to, -1 when it is free to migrate
+    [[nodiscard]] auto cpuOf(uint32_t worker) const -> int
+    {
+        return worker < _cpus.size() ? _cpus[worker] : -1;
+    }
+
+    // Range of items worker runs when count items are split over the pool
+    [[nodiscard]] static auto range(size_t count, uint32_t worker, uint32_t workers)
+            -> std::pair<size_t, size_t>;
+
+private:
+    auto workerLoop(uint32_t worker) -> void;
+
+    std::vector<std::thread> _workers;
+    std::vector<int> _cpus;
+    // Affinity of the thread that created the pool, before it was pinned as worker 0
+    pthread_t _caller{};
+    cpu_set_t _callerAffinity{};
+    bool _restoreCaller = false;
+    std::mutex _mutex;
+    std::condition_variable _start;
+    std::condition_variable _done;
+
+    Job const* _job = nullptr;
+    size_t _count = 0;
+    // Bumped for every job so sleeping workers can tell a new one from a spurious wakeup
+    uint64_t _generation = 0;
+    uint32_t _pending = 0;
+    bool _stop = false;
+};
+
+} // namespace utils
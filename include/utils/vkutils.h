@@ -11,6 +11,20 @@ namespace app::vk::utils
 auto errorString(VkResult result) -> std::string;
 auto deviceType(VkPhysicalDeviceType deviceType) -> std::string;
 
+// Dependency on the whole buffer within one queue family
+auto bufferBarrier(
+        VkCommandBuffer buf,
+        VkBuffer buffer,
+        VkPipelineStageFlags srcStage,
+        VkAccessFlags srcAccess,
+        VkPipelineStageFlags dstStage,
+        VkAccessFlags dstAccess) -> void;
+
+// Subgroup reductions are core since Vulkan 1.1 but their arithmetic operations are optional.
+// Throws naming the feature that needs them when compute shaders lack them.
+auto requireSubgroupArithmetic(VkPhysicalDevice physicalDevice, std::string const& feature)
+        -> void;
+
 inline constexpr void checkVkResult(VkResult res, char const* file, int line)
 {
     if(res != VK_SUCCESS)
@@ -1,4 +1,5 @@
 #include "core/app.h"
+#include "rocket/cpusolver.h"
 #include "utils/timer.h"
 
 #include <chrono>
@@ -9,7 +10,8 @@
 namespace app
 {
 
-Application::Application() : _log(logs::getLogger("Application"))
+Application::Application(LaunchOptions options)
+    : _log(logs::getLogger("Application")), _options(std::move(options))
 {
 }
 
@@ -20,19 +22,39 @@ auto Application::init() -> void
     params::Params parameters;
 
     {
-        auto configHandler = std::make_unique<ConfigHandler>("data/config.ini");
+        auto configHandler = std::make_unique<ConfigHandler>(_options.configPath);
         auto screenConfig = configHandler->loadScreenConfig();
         auto vulkanConfig = configHandler->loadVulkanConfig();
-        if(!screenConfig || !vulkanConfig)
+        auto simulationConfig = configHandler->loadSimulationConfig();
+        if(!screenConfig || !vulkanConfig || !simulationConfig)
         {
             throw std::runtime_error("Failed to load config");
         }
 
         parameters.screenConfig = *screenConfig;
         parameters.vulkanConfig = *vulkanConfig;
+        parameters.simulationConfig = *simulationConfig;
     }
 
     _appContext = std::make_shared<AppContext>(parameters);
+
+    if(parameters.simulationConfig.backend == params::SolverBackend::Cpu)
+    {
+        if(!_options.headless)
+        {
+            throw std::runtime_error("The CPU backend only runs headless");
+        }
+        _cpuSolver = std::make_unique<simu::CpuSolver>(parameters.simulationConfig);
+        return;
+    }
+
+    if(_options.headless)
+    {
+        _vkContext = std::make_unique<vk::Context>(_appContext);
+        _vkContext->initHeadless();
+        return;
+    }
+
     _windowManager = std::make_unique<WindowManager>(_appContext);
     _windowManager->setup();
 
@@ -43,6 +65,19 @@ auto Application::init() -> void
 
 auto Application::run() -> void
 {
+    if(_cpuSolver)
+    {
+        simu::timedSimulate(*_cpuSolver, _options.steps);
+        return;
+    }
+
+    if(_options.headless)
+    {
+        _vkContext->simulate(_options.steps);
+        _vkContext->deviceWaitIdle();
+        return;
+    }
+
     _log->info("Entering mainloop");
     while(!_windowManager->shouldClose())
     {
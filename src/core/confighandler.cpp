@@ -2,6 +2,8 @@
 
 #include "mini/ini.h"
 
+#include <cmath>
+
 namespace app
 {
 
@@ -25,6 +27,10 @@ auto ConfigHandler::loadVulkanConfig() -> std::optional<params::Params::VulkanCo
     vulkanConfig.vsync = ini["vulkan"]["vsync"] == "true";
     vulkanConfig.validationLayers = ini["vulkan"]["validationLayers"] == "true";
     vulkanConfig.debugUtils = ini["vulkan"]["debugUtils"] == "true";
+    if(ini["vulkan"].has("pipelineCache"))
+    {
+        vulkanConfig.pipelineCache = ini["vulkan"]["pipelineCache"];
+    }
 
     return vulkanConfig;
 }
@@ -50,4 +56,497 @@ auto ConfigHandler::loadScreenConfig() -> std::optional<params::Params::ScreenCo
 
     return screenConfig;
 }
+
+auto ConfigHandler::loadSimulationConfig() -> std::optional<params::Params::SimulationConfig>
+{
+    auto file = mINI::INIFile{_configFile};
+    auto ini = mINI::INIStructure{};
+
+    if(!file.read(ini))
+    {
+        _log->error("Failed to read config file: {}", _configFile);
+        return std::nullopt;
+    }
+
+    auto simulationConfig = params::Params::SimulationConfig{};
+
+    if(ini.has("simulation"))
+    {
+        auto& section = ini["simulation"];
+
+        if(section.has("engine"))
+        {
+            auto const& engine = section["engine"];
+            if(engine == "lbm")
+            {
+                simulationConfig.engine = params::SolverEngine::Lbm;
+            }
+            else if(engine == "stablefluids")
+            {
+                simulationConfig.engine = params::SolverEngine::StableFluids;
+            }
+            else
+            {
+                _log->error("Unknown solver engine: {}", engine);
+                return std::nullopt;
+            }
+        }
+        if(section.has("diffuseIterations"))
+        {
+            auto iterations = std::stoi(section["diffuseIterations"]);
+            if(iterations < 0)
+            {
+                _log->error("diffuseIterations can not be negative, got {}", iterations);
+                return std::nullopt;
+            }
+            simulationConfig.diffuseIterations = static_cast<uint32_t>(iterations);
+        }
+        if(section.has("pressureIterations"))
+        {
+            auto iterations = std::stoi(section["pressureIterations"]);
+            if(iterations < 1)
+            {
+                _log->error("pressureIterations must be at least 1, got {}", iterations);
+                return std::nullopt;
+            }
+            simulationConfig.pressureIterations = static_cast<uint32_t>(iterations);
+        }
+        if(section.has("pressureSolver"))
+        {
+            auto const& solver = section["pressureSolver"];
+            if(solver == "jacobi")
+            {
+                simulationConfig.pressureSolver = params::PressureSolver::Jacobi;
+            }
+            else if(solver == "multigrid")
+            {
+                simulationConfig.pressureSolver = params::PressureSolver::Multigrid;
+            }
+            else if(solver == "pcg")
+            {
+                simulationConfig.pressureSolver = params::PressureSolver::ConjugateGradient;
+            }
+            else
+            {
+                _log->error("Unknown pressure solver: {}", solver);
+                return std::nullopt;
+            }
+        }
+        if(section.has("pressurePreconditioner"))
+        {
+            auto const& preconditioner = section["pressurePreconditioner"];
+            if(preconditioner == "jacobi")
+            {
+                simulationConfig.pressurePreconditioner = params::PressurePreconditioner::Jacobi;
+            }
+            else if(preconditioner == "incompletepoisson")
+            {
+                simulationConfig.pressurePreconditioner =
+                        params::PressurePreconditioner::IncompletePoisson;
+            }
+            else
+            {
+                _log->error("Unknown pressure preconditioner: {}", preconditioner);
+                return std::nullopt;
+            }
+        }
+        if(section.has("pressureCycles"))
+        {
+            auto cycles = std::stoi(section["pressureCycles"]);
+            if(cycles < 1)
+            {
+                _log->error("pressureCycles must be at least 1, got {}", cycles);
+                return std::nullopt;
+            }
+            simulationConfig.pressureCycles = static_cast<uint32_t>(cycles);
+        }
+        if(section.has("pressureTolerance"))
+        {
+            simulationConfig.pressureTolerance = std::stof(section["pressureTolerance"]);
+            if(simulationConfig.pressureTolerance < 0.0f)
+            {
+                _log->error("pressureTolerance can not be negative");
+                return std::nullopt;
+            }
+        }
+
+        if(section.has("backend"))
+        {
+            auto const& backend = section["backend"];
+            if(backend == "gpu")
+            {
+                simulationConfig.backend = params::SolverBackend::Gpu;
+            }
+            else if(backend == "cpu")
+            {
+                simulationConfig.backend = params::SolverBackend::Cpu;
+            }
+            else
+            {
+                _log->error("Unknown solver backend: {}", backend);
+                return std::nullopt;
+            }
+        }
+
+        if(section.has("cpuIsa"))
+        {
+            auto const& isa = section["cpuIsa"];
+            if(isa == "auto")
+            {
+                simulationConfig.cpuIsa = params::CpuIsa::Auto;
+            }
+            else if(isa == "scalar")
+            {
+                simulationConfig.cpuIsa = params::CpuIsa::Scalar;
+            }
+            else if(isa == "avx2")
+            {
+                simulationConfig.cpuIsa = params::CpuIsa::Avx2;
+            }
+            else if(isa == "avx512")
+            {
+                simulationConfig.cpuIsa = params::CpuIsa::Avx512;
+            }
+            else
+            {
+                _log->error("Unknown CPU instruction set: {}", isa);
+                return std::nullopt;
+            }
+        }
+
+        if(section.has("cpuThreads"))
+        {
+            auto threads = std::stoi(section["cpuThreads"]);
+            if(threads < 0)
+            {
+                _log->error("cpuThreads can not be negative, got {}", threads);
+                return std::nullopt;
+            }
+            simulationConfig.cpuThreads = static_cast<uint32_t>(threads);
+        }
+        if(section.has("cpuPinning"))
+        {
+            simulationConfig.cpuPinning = section["cpuPinning"] == "true";
+        }
+        if(section.has("cpuTemporalDepth"))
+        {
+            auto depth = std::stoi(section["cpuTemporalDepth"]);
+            if(depth < 1)
+            {
+                _log->error("cpuTemporalDepth must be at least 1, got {}", depth);
+                return std::nullopt;
+            }
+            simulationConfig.cpuTemporalDepth = static_cast<uint32_t>(depth);
+        }
+        if(simulationConfig.engine == params::SolverEngine::StableFluids
+           && simulationConfig.backend == params::SolverBackend::Cpu)
+        {
+            _log->error("The stablefluids engine only runs on the gpu backend");
+            return std::nullopt;
+        }
+
+        if(section.has("layout"))
+        {
+            auto const& layout = section["layout"];
+            if(layout == "aos")
+            {
+                simulationConfig.layout = params::LatticeLayout::AoS;
+            }
+            else if(layout == "soa")
+            {
+                simulationConfig.layout = params::LatticeLayout::SoA;
+            }
+            else
+            {
+                _log->error("Unknown lattice layout: {}", layout);
+                return std::nullopt;
+            }
+        }
+
+        if(section.has("kernel"))
+        {
+            auto const& kernel = section["kernel"];
+            if(kernel == "multipass")
+            {
+                simulationConfig.kernel = params::SolverKernel::MultiPass;
+            }
+            else if(kernel == "fused")
+            {
+                simulationConfig.kernel = params::SolverKernel::Fused;
+            }
+            else if(kernel == "aa")
+            {
+                simulationConfig.kernel = params::SolverKernel::InPlaceAA;
+            }
+            else
+            {
+                _log->error("Unknown solver kernel: {}", kernel);
+                return std::nullopt;
+            }
+        }
+
+        if(section.has("collision"))
+        {
+            auto const& collision = section["collision"];
+            if(collision == "bgk")
+            {
+                simulationConfig.collision = params::CollisionOperator::Bgk;
+            }
+            else if(collision == "trt")
+            {
+                simulationConfig.collision = params::CollisionOperator::Trt;
+            }
+            else if(collision == "mrt")
+            {
+                simulationConfig.collision = params::CollisionOperator::Mrt;
+            }
+            else
+            {
+                _log->error("Unknown collision operator: {}", collision);
+                return std::nullopt;
+            }
+        }
+        if(simulationConfig.collision != params::CollisionOperator::Bgk
+           && simulationConfig.backend == params::SolverBackend::Cpu)
+        {
+            _log->error("The trt and mrt collisions only run on the gpu backend");
+            return std::nullopt;
+        }
+        if(section.has("tau"))
+        {
+            simulationConfig.tau = std::stof(section["tau"]);
+            if(simulationConfig.tau <= 0.5f)
+            {
+                _log->error("tau must be above 0.5, got {}", simulationConfig.tau);
+                return std::nullopt;
+            }
+        }
+        if(section.has("trtMagic"))
+        {
+            simulationConfig.trtMagic = std::stof(section["trtMagic"]);
+            if(simulationConfig.trtMagic <= 0.0f)
+            {
+                _log->error("trtMagic must be positive, got {}", simulationConfig.trtMagic);
+                return std::nullopt;
+            }
+        }
+        if(section.has("mrtBulkRate"))
+        {
+            simulationConfig.mrtBulkRate = std::stof(section["mrtBulkRate"]);
+            if(simulationConfig.mrtBulkRate <= 0.0f || simulationConfig.mrtBulkRate >= 2.0f)
+            {
+                _log->error("mrtBulkRate must be between 0 and 2");
+                return std::nullopt;
+            }
+        }
+        if(section.has("mrtFluxRate"))
+        {
+            simulationConfig.mrtFluxRate = std::stof(section["mrtFluxRate"]);
+            if(simulationConfig.mrtFluxRate <= 0.0f || simulationConfig.mrtFluxRate >= 2.0f)
+            {
+                _log->error("mrtFluxRate must be between 0 and 2");
+                return std::nullopt;
+            }
+        }
+        if(section.has("smagorinsky"))
+        {
+            simulationConfig.smagorinsky = std::stof(section["smagorinsky"]);
+            if(simulationConfig.smagorinsky < 0.0f)
+            {
+                _log->error("smagorinsky can not be negative");
+                return std::nullopt;
+            }
+        }
+
+        if(section.has("gridWidth"))
+        {
+            simulationConfig.gridWidth = std::stoi(section["gridWidth"]);
+        }
+        if(section.has("gridHeight"))
+        {
+            simulationConfig.gridHeight = std::stoi(section["gridHeight"]);
+        }
+        if(simulationConfig.gridWidth < 1 || simulationConfig.gridHeight < 1)
+        {
+            _log->error(
+                    "Invalid grid size {}x{}",
+                    simulationConfig.gridWidth,
+                    simulationConfig.gridHeight);
+            return std::nullopt;
+        }
+
+        auto workgroupWidth = static_cast<int>(simulationConfig.workgroupWidth);
+        auto workgroupHeight = static_cast<int>(simulationConfig.workgroupHeight);
+        if(section.has("workgroupWidth"))
+        {
+            workgroupWidth = std::stoi(section["workgroupWidth"]);
+        }
+        if(section.has("workgroupHeight"))
+        {
+            workgroupHeight = std::stoi(section["workgroupHeight"]);
+        }
+        if(workgroupWidth < 1 || workgroupHeight < 1)
+        {
+            _log->error("Invalid workgroup size {}x{}", workgroupWidth, workgroupHeight);
+            return std::nullopt;
+        }
+        simulationConfig.workgroupWidth = static_cast<uint32_t>(workgroupWidth);
+        simulationConfig.workgroupHeight = static_cast<uint32_t>(workgroupHeight);
+
+        if(section.has("stepsPerFrame"))
+        {
+            auto steps = std::stoi(section["stepsPerFrame"]);
+            if(steps < 1)
+            {
+                _log->error("stepsPerFrame must be at least 1, got {}", steps);
+                return std::nullopt;
+            }
+            simulationConfig.stepsPerFrame = static_cast<uint32_t>(steps);
+        }
+
+        if(section.has("frameBudgetMs"))
+        {
+            simulationConfig.frameBudgetMs = std::stof(section["frameBudgetMs"]);
+            if(simulationConfig.frameBudgetMs < 0.0f)
+            {
+                _log->error("frameBudgetMs can not be negative");
+                return std::nullopt;
+            }
+        }
+
+        if(section.has("renderInterval"))
+        {
+            auto interval = std::stoi(section["renderInterval"]);
+            if(interval < 1)
+            {
+                _log->error("renderInterval must be at least 1, got {}", interval);
+                return std::nullopt;
+            }
+            simulationConfig.renderInterval = static_cast<uint32_t>(interval);
+        }
+
+        if(section.has("checkpointInterval"))
+        {
+            auto interval = std::stoi(section["checkpointInterval"]);
+            if(interval < 0)
+            {
+                _log->error("checkpointInterval can not be negative, got {}", interval);
+                return std::nullopt;
+            }
+            simulationConfig.checkpointInterval = static_cast<uint32_t>(interval);
+        }
+        if(section.has("checkpointPath"))
+        {
+            simulationConfig.checkpointPath = section["checkpointPath"];
+        }
+        if(section.has("restartPath"))
+        {
+            simulationConfig.restartPath = section["restartPath"];
+        }
+        if((simulationConfig.checkpointInterval > 0 || !simulationConfig.restartPath.empty())
+           && (simulationConfig.engine != params::SolverEngine::Lbm
+               || simulationConfig.backend != params::SolverBackend::Gpu))
+        {
+            _log->error("Checkpoints are only written and read by the lbm engine on the gpu");
+            return std::nullopt;
+        }
+
+        if(section.has("outputInterval"))
+        {
+            auto interval = std::stoi(section["outputInterval"]);
+            if(interval < 0)
+            {
+                _log->error("outputInterval can not be negative, got {}", interval);
+                return std::nullopt;
+            }
+            simulationConfig.outputInterval = static_cast<uint32_t>(interval);
+        }
+        if(section.has("outputSlots"))
+        {
+            auto slots = std::stoi(section["outputSlots"]);
+            if(slots < 1)
+            {
+                _log->error("outputSlots must be at least 1, got {}", slots);
+                return std::nullopt;
+            }
+            simulationConfig.outputSlots = static_cast<uint32_t>(slots);
+        }
+        if(section.has("outputSeries"))
+        {
+            simulationConfig.outputSeries = section["outputSeries"];
+        }
+        if(section.has("outputPrecision"))
+        {
+            auto const& precision = section["outputPrecision"];
+            if(precision == "half")
+            {
+                simulationConfig.outputPrecision = params::OutputPrecision::Half;
+            }
+            else if(precision == "float")
+            {
+                simulationConfig.outputPrecision = params::OutputPrecision::Float;
+            }
+            else if(precision == "quantized")
+            {
+                simulationConfig.outputPrecision = params::OutputPrecision::Quantized;
+            }
+            else
+            {
+                _log->error("Unknown output precision: {}", precision);
+                return std::nullopt;
+            }
+        }
+        if(section.has("outputErrorBound"))
+        {
+            auto bound = std::stof(section["outputErrorBound"]);
+            if(!(bound > 0.0f) || !std::isfinite(bound))
+            {
+                _log->error("outputErrorBound must be positive, got {}", bound);
+                return std::nullopt;
+            }
+            simulationConfig.outputErrorBound = bound;
+        }
+        if(section.has("outputCsv"))
+        {
+            simulationConfig.outputCsv = section["outputCsv"];
+        }
+        if(simulationConfig.outputInterval > 0
+           && (simulationConfig.engine != params::SolverEngine::Lbm
+               || simulationConfig.backend != params::SolverBackend::Gpu))
+        {
+            _log->error("Field output reads the lattice of the lbm engine on the gpu only");
+            return std::nullopt;
+        }
+
+        if(section.has("statsInterval"))
+        {
+            auto interval = std::stoi(section["statsInterval"]);
+            if(interval < 0)
+            {
+                _log->error("statsInterval can not be negative, got {}", interval);
+                return std::nullopt;
+            }
+            simulationConfig.statsInterval = static_cast<uint32_t>(interval);
+        }
+        if(section.has("statsPath"))
+        {
+            simulationConfig.statsPath = section["statsPath"];
+        }
+        if(simulationConfig.statsInterval > 0
+           && (simulationConfig.engine != params::SolverEngine::Lbm
+               || simulationConfig.backend != params::SolverBackend::Gpu))
+        {
+            _log->error("Flow statistics reduce the lattice of the lbm engine on the gpu only");
+            return std::nullopt;
+        }
+
+        simulationConfig.profile = section["profile"] == "true";
+        if(section.has("profileOutput"))
+        {
+            simulationConfig.profileOutput = section["profileOutput"];
+        }
+    }
+
+    return simulationConfig;
+}
 } // namespace app
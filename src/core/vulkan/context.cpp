@@ -18,6 +18,7 @@ Context::Context(AppContextPtr const& appContext, GLFWwindow* window)
     , _appContext(appContext)
     , _config(appContext->getParamsStruct()->vulkanConfig)
     , _log(logs::getLogger("VkContext"))
+    , _scheduler(appContext->getParamsStruct()->simulationConfig)
     , _window(window)
 {
     _conn.attach<event::FrameBufferResizeEvent>();
@@ -130,24 +131,6 @@ void Context::renderFrame(float dt, float elapsed)
         assert(false);
     }
 
-    _simu->update(dt, elapsed, imageIndex);
-
-    // TODO test if I can use _frameindex to work with commandbuffers
-    //
-    auto* computeCmdBuf = _simu->recordCommandBuffer(imageIndex);
-    VkPipelineStageFlags computeWaitStages[] = {VK_PIPELINE_STAGE_ALL_GRAPHICS_BIT};
-
-    auto submitInfos = std::array<VkSubmitInfo, 2>{};
-    submitInfos[0].sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-    submitInfos[0].waitSemaphoreCount = 1;
-    submitInfos[0].pWaitSemaphores = &_presentCompleteSemaphores[_frameIndex];
-    submitInfos[0].pWaitDstStageMask = computeWaitStages;
-    submitInfos[0].commandBufferCount = 1;
-    submitInfos[0].pCommandBuffers = &computeCmdBuf;
-    submitInfos[0].signalSemaphoreCount = 1;
-    submitInfos[0].pSignalSemaphores = &_sync.compute;
-
-    // Now the rendering and presentation operations
     if(_imagesInFlight[imageIndex] != VK_NULL_HANDLE)
     {
         vkWaitForFences(
@@ -156,36 +139,99 @@ void Context::renderFrame(float dt, float elapsed)
 
     _imagesInFlight[imageIndex] = _fences[_frameIndex];
 
+    // Compute command buffers of this image are no longer pending and may be re-recorded
+    _simu->update(dt, elapsed, imageIndex);
+    auto const frame = _scheduler.next(dt);
+
+    { // Solver on the compute queue. The steps do not wait for anything, so they overlap with
+      // the graphics work of the previous frame. Only the render pass, which writes the image
+      // graphics samples, waits for the previous frame's graphics submission.
+        auto* stepsCmdBuf = _simu->recordCommandBuffer(imageIndex, frame.steps);
+        auto* renderCmdBuf = _simu->renderCommandBuffer(frame.render);
+
+        uint64_t const waitValue = _sync.graphicsValue;
+        uint64_t const signalValue = ++_sync.computeValue;
+        VkPipelineStageFlags const waitStage = VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+
+        auto timelineInfo = VkTimelineSemaphoreSubmitInfo{};
+        timelineInfo.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+        timelineInfo.waitSemaphoreValueCount = 1;
+        timelineInfo.pWaitSemaphoreValues = &waitValue;
+        timelineInfo.signalSemaphoreValueCount = 1;
+        timelineInfo.pSignalSemaphoreValues = &signalValue;
+
+        auto submitInfos = std::array<VkSubmitInfo, 2>{};
+        submitInfos[0].sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+        submitInfos[0].commandBufferCount = 1;
+        submitInfos[0].pCommandBuffers = &stepsCmdBuf;
+
+        submitInfos[1].sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+        submitInfos[1].pNext = &timelineInfo;
+        submitInfos[1].waitSemaphoreCount = 1;
+        submitInfos[1].pWaitSemaphores = &_sync.graphics;
+        submitInfos[1].pWaitDstStageMask = &waitStage;
+        submitInfos[1].commandBufferCount = 1;
+        submitInfos[1].pCommandBuffers = &renderCmdBuf;
+        submitInfos[1].signalSemaphoreCount = 1;
+        submitInfos[1].pSignalSemaphores = &_sync.compute;
+
+        result = vkQueueSubmit(
+                _device->getComputeQueue(),
+                static_cast<uint32_t>(submitInfos.size()),
+                submitInfos.data(),
+                VK_NULL_HANDLE);
+
+        if(result != VK_SUCCESS)
+        {
+            _log->warn("renderFrame::vkQueueSubmit(compute) {}", utils::errorString(result));
+            assert(false);
+        }
+
+        _simu->checkpointIfDue();
+        _simu->outputIfDue();
+        _simu->statisticsIfDue();
+    }
+
+    // Now the rendering and presentation operations
     update(dt, imageIndex);
     recordCommandBuffers(imageIndex);
 
     const std::vector<VkCommandBuffer> cmdBuffers = {_renderingCommandBuffers[imageIndex]};
 
     const std::vector<VkPipelineStageFlags> graphicsWaitStages = {
-            VK_PIPELINE_STAGE_VERTEX_INPUT_BIT, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT};
+            VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT};
 
-    const std::vector<VkSemaphore> graphicsWaitSemaphores = {_sync.compute};
+    const std::vector<VkSemaphore> graphicsWaitSemaphores = {
+            _sync.compute, _presentCompleteSemaphores[_frameIndex]};
 
     const std::vector<VkSemaphore> graphicsSignalSemaphores = {
-            _renderingCompleteSemaphores[_frameIndex]};
-
-    submitInfos[1].sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-    submitInfos[1].pNext = nullptr;
-    submitInfos[1].waitSemaphoreCount = static_cast<uint32_t>(graphicsWaitSemaphores.size());
-    submitInfos[1].pWaitSemaphores = graphicsWaitSemaphores.data();
-    submitInfos[1].pWaitDstStageMask = graphicsWaitStages.data();
-    submitInfos[1].commandBufferCount = static_cast<uint32_t>(cmdBuffers.size());
-    submitInfos[1].pCommandBuffers = cmdBuffers.data();
-    submitInfos[1].signalSemaphoreCount = static_cast<uint32_t>(graphicsSignalSemaphores.size());
-    submitInfos[1].pSignalSemaphores = graphicsSignalSemaphores.data();
+            _sync.graphics, _renderingCompleteSemaphores[_frameIndex]};
+
+    // Values of the binary semaphores are ignored
+    const std::vector<uint64_t> graphicsWaitValues = {_sync.computeValue, 0};
+    const std::vector<uint64_t> graphicsSignalValues = {++_sync.graphicsValue, 0};
+
+    auto timelineInfo = VkTimelineSemaphoreSubmitInfo{};
+    timelineInfo.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+    timelineInfo.waitSemaphoreValueCount = static_cast<uint32_t>(graphicsWaitValues.size());
+    timelineInfo.pWaitSemaphoreValues = graphicsWaitValues.data();
+    timelineInfo.signalSemaphoreValueCount = static_cast<uint32_t>(graphicsSignalValues.size());
+    timelineInfo.pSignalSemaphoreValues = graphicsSignalValues.data();
+
+    auto submitInfo = VkSubmitInfo{};
+    submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    submitInfo.pNext = &timelineInfo;
+    submitInfo.waitSemaphoreCount = static_cast<uint32_t>(graphicsWaitSemaphores.size());
+    submitInfo.pWaitSemaphores = graphicsWaitSemaphores.data();
+    submitInfo.pWaitDstStageMask = graphicsWaitStages.data();
+    submitInfo.commandBufferCount = static_cast<uint32_t>(cmdBuffers.size());
+    submitInfo.pCommandBuffers = cmdBuffers.data();
+    submitInfo.signalSemaphoreCount = static_cast<uint32_t>(graphicsSignalSemaphores.size());
+    submitInfo.pSignalSemaphores = graphicsSignalSemaphores.data();
 
     vkResetFences(_device->getLogicalDevice(), 1, &_fences[_frameIndex]);
 
-    result = vkQueueSubmit(
-            _device->getGraphicsQueue(),
-            static_cast<uint32_t>(submitInfos.size()),
-            submitInfos.data(),
-            _fences[_frameIndex]);
+    result = vkQueueSubmit(_device->getGraphicsQueue(), 1, &submitInfo, _fences[_frameIndex]);
 
     if(result != VK_SUCCESS)
     {
@@ -207,6 +253,12 @@ void Context::renderFrame(float dt, float elapsed)
     }
 
     _frameIndex = (_frameIndex + 1) % _swapchain->getImageCount();
+
+    if(elapsed - _lastProfileReport > 2.0f)
+    {
+        _simu->reportProfile();
+        _lastProfileReport = elapsed;
+    }
 }
 
 auto Context::deviceWaitIdle() -> void
@@ -223,37 +275,9 @@ auto Context::init(VkExtent2D swapchainExtent) -> void
 
     _swapchainExtent = swapchainExtent;
 
-    createInstance();
-
-    if(_config.debugUtils)
-    {
-        VkDebugUtilsMessageSeverityFlagsEXT messageSeverity =
-                VK_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT
-                | VK_DEBUG_UTILS_MESSAGE_SEVERITY_WARNING_BIT_EXT;
-        // | VK_DEBUG_UTILS_MESSAGE_SEVERITY_VERBOSE_BIT_EXT;
-
-        VkDebugUtilsMessageTypeFlagsEXT messageType =
-                VK_DEBUG_UTILS_MESSAGE_TYPE_GENERAL_BIT_EXT
-                | VK_DEBUG_UTILS_MESSAGE_TYPE_PERFORMANCE_BIT_EXT;
-
-        if(_config.validationLayers)
-            messageType |= VK_DEBUG_UTILS_MESSAGE_TYPE_VALIDATION_BIT_EXT;
-
-        _debugUtils = std::make_shared<DebugUtils const>(_instance, messageSeverity, messageType);
-    }
-
-    // Look for GPU's
-    VkPhysicalDevice gpu = selectPhysicalDevice();
-    _device = std::make_unique<Device>(gpu, _window);
-
-    {
-        std::vector<char const*> requestedExtensions = {};
-
-        VkQueueFlags queueFlags =
-                VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT | VK_QUEUE_TRANSFER_BIT;
-
-        _device->createLogicalDevice(_instance, requestedExtensions, queueFlags);
-    }
+    createDevice(
+            VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT | VK_QUEUE_TRANSFER_BIT,
+            {VK_KHR_SWAPCHAIN_EXTENSION_NAME});
 
     // Create surface
     _swapchain = std::make_shared<Swapchain>(_instance, _device.get());
@@ -276,7 +300,10 @@ auto Context::init(VkExtent2D swapchainExtent) -> void
     // m_Scene->loadModels(m_Device.get());
     _swapchain->create(_config.vsync);
 
-    _simu = std::make_unique<simu::Simu>(_device.get(), _swapchain->getImageCount());
+    _simu = std::make_unique<simu::Simu>(
+            _device.get(),
+            _swapchain->getImageCount(),
+            _appContext->getParamsStruct()->simulationConfig);
 
     createUniformBuffers();
     createSynchronizationPrimitives();
@@ -288,6 +315,50 @@ auto Context::init(VkExtent2D swapchainExtent) -> void
     generatePipelines();
 }
 
+auto Context::initHeadless() -> void
+{
+    assert(_window == nullptr);
+
+    createDevice(VK_QUEUE_COMPUTE_BIT | VK_QUEUE_TRANSFER_BIT, {});
+
+    // Nothing is presented, a single set of descriptors is enough
+    _simu = std::make_unique<simu::Simu>(
+            _device.get(), 1, _appContext->getParamsStruct()->simulationConfig);
+}
+
+auto Context::simulate(uint64_t steps) -> double
+{
+    return simu::timedSimulate(*_simu, steps);
+}
+
+auto Context::createDevice(VkQueueFlags queueFlags, std::vector<char const*> extensions) -> void
+{
+    createInstance();
+
+    if(_config.debugUtils)
+    {
+        VkDebugUtilsMessageSeverityFlagsEXT messageSeverity =
+                VK_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT
+                | VK_DEBUG_UTILS_MESSAGE_SEVERITY_WARNING_BIT_EXT;
+        // | VK_DEBUG_UTILS_MESSAGE_SEVERITY_VERBOSE_BIT_EXT;
+
+        VkDebugUtilsMessageTypeFlagsEXT messageType =
+                VK_DEBUG_UTILS_MESSAGE_TYPE_GENERAL_BIT_EXT
+                | VK_DEBUG_UTILS_MESSAGE_TYPE_PERFORMANCE_BIT_EXT;
+
+        if(_config.validationLayers)
+            messageType |= VK_DEBUG_UTILS_MESSAGE_TYPE_VALIDATION_BIT_EXT;
+
+        _debugUtils = std::make_shared<DebugUtils const>(_instance, messageSeverity, messageType);
+    }
+
+    // Look for GPU's
+    VkPhysicalDevice gpu = selectPhysicalDevice();
+    _device = std::make_unique<Device>(gpu, _window);
+    _device->createLogicalDevice(_instance, std::move(extensions), queueFlags);
+    _device->createPipelineCache(_config.pipelineCache);
+}
+
 void Context::generatePipelines()
 {
     createGraphicsPipeline();
@@ -301,6 +372,7 @@ auto Context::createInstance() -> void
     std::vector<char const*> instanceExtensions = {};
     std::vector<char const*> instanceLayers = {};
 
+    if(_window)
     { // GLFW should ask for VK_KHR_SURFACE and platform depended surface
         uint32_t count = 0;
         char const** glfwExtensions = nullptr;
@@ -485,10 +557,21 @@ auto Context::createSynchronizationPrimitives() -> void
         VK_CHECK(vkCreateFence(_device->getLogicalDevice(), &fenceInfo, nullptr, &_fences[i]));
     }
 
+    // Compute and graphics submissions signal one value per frame
+    VkSemaphoreTypeCreateInfo timelineInfo = {};
+    timelineInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO;
+    timelineInfo.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE;
+    timelineInfo.initialValue = 0;
+
+    VkSemaphoreCreateInfo timelineSemaphoreInfo = {};
+    timelineSemaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+    timelineSemaphoreInfo.pNext = &timelineInfo;
+    timelineSemaphoreInfo.flags = 0;
+
     VK_CHECK(vkCreateSemaphore(
-            _device->getLogicalDevice(), &semaphoreInfo, nullptr, &_sync.graphics));
+            _device->getLogicalDevice(), &timelineSemaphoreInfo, nullptr, &_sync.graphics));
     VK_CHECK(vkCreateSemaphore(
-            _device->getLogicalDevice(), &semaphoreInfo, nullptr, &_sync.compute));
+            _device->getLogicalDevice(), &timelineSemaphoreInfo, nullptr, &_sync.compute));
 
     VkFenceCreateInfo compfenceInfo = {};
     compfenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
@@ -752,7 +835,12 @@ auto Context::createGraphicsPipeline() -> void
     }
 
     VK_CHECK(vkCreateGraphicsPipelines(
-            _device->getLogicalDevice(), nullptr, 1, &pipelineInfo, nullptr, &_pipeline));
+            _device->getLogicalDevice(),
+            _device->getPipelineCache(),
+            1,
+            &pipelineInfo,
+            nullptr,
+            &_pipeline));
 
     for(auto& shader : shaderStages)
     {
@@ -817,6 +905,8 @@ auto Context::recordCommandBuffers(uint32_t nextImageIndex) -> void
         vkResetCommandBuffer(cmdBuf, 0);
         vkBeginCommandBuffer(cmdBuf, &beginInfo);
 
+        _simu->acquireRenderImage(cmdBuf);
+
         vkCmdBeginRenderPass(cmdBuf, &renderPassBeginInfo, VK_SUBPASS_CONTENTS_INLINE);
         vkCmdBindPipeline(cmdBuf, VK_PIPELINE_BIND_POINT_GRAPHICS, _pipeline);
 
@@ -844,6 +934,8 @@ auto Context::recordCommandBuffers(uint32_t nextImageIndex) -> void
 
         vkCmdEndRenderPass(cmdBuf);
 
+        _simu->releaseRenderImage(cmdBuf);
+
         VK_CHECK(vkEndCommandBuffer(cmdBuf));
     }
 }
@@ -925,6 +1017,7 @@ auto Context::recreateSwapchain() -> void
     createRenderPass();
     _swapchain->createFrameBuffers(_renderpass);
     allocateCommandBuffers();
+    _simu->invalidateCommandBuffers(_swapchain->getImageCount());
 }
 
 void Context::createVertexIndexBuffers()
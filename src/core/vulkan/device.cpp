@@ -1,9 +1,13 @@
 #include "core/vulkan/device.h"
 
 #include <cassert>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
 #include <fstream>
 #include <set>
 #include <sstream>
+#include <system_error>
 
 #include "logs/log.h"
 #include "utils/vkutils.h"
@@ -14,8 +18,8 @@ namespace app::vk
 Device::Device(VkPhysicalDevice gpu, GLFWwindow* window)
     : _log(logs::getLogger("VkDevice")), _window(window), _physicalDevice(gpu)
 {
+    // window is null when running headless
     assert(gpu);
-    assert(window);
 
     vkGetPhysicalDeviceProperties(gpu, &_physicalDeviceProperties);
     vkGetPhysicalDeviceFeatures(gpu, &_physicalDeviceFeatures);
@@ -31,6 +35,12 @@ Device::Device(VkPhysicalDevice gpu, GLFWwindow* window)
 
 Device::~Device()
 {
+    if(_pipelineCache)
+    {
+        savePipelineCache();
+        vkDestroyPipelineCache(_logicalDevice, _pipelineCache, nullptr);
+    }
+
     if(_commandPools.graphics)
     {
         vkDestroyCommandPool(_logicalDevice, _commandPools.graphics, nullptr);
@@ -77,6 +87,13 @@ void Device::createLogicalDevice(
         _queueFamilyIndices.compute = _queueFamilyIndices.graphics;
     }
 
+    // Headless, the "graphics" queue and pool alias the compute family
+    if((requestedQueueTypes & VK_QUEUE_GRAPHICS_BIT) == 0)
+    {
+        assert(requestedQueueTypes & VK_QUEUE_COMPUTE_BIT);
+        _queueFamilyIndices.graphics = _queueFamilyIndices.compute;
+    }
+
     if(requestedQueueTypes & VK_QUEUE_TRANSFER_BIT)
     {
         _queueFamilyIndices.transfer = getQueueFamilyIndex(VK_QUEUE_TRANSFER_BIT);
@@ -101,9 +118,15 @@ void Device::createLogicalDevice(
         queueCreateInfos.push_back(queueInfo);
     }
 
+    // Pipelines compute and graphics submissions
+    VkPhysicalDeviceTimelineSemaphoreFeatures timelineFeatures = {};
+    timelineFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_TIMELINE_SEMAPHORE_FEATURES;
+    timelineFeatures.pNext = nullptr;
+    timelineFeatures.timelineSemaphore = VK_TRUE;
+
     VkPhysicalDeviceDescriptorIndexingFeaturesEXT indexingFeatures = {};
     indexingFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_FEATURES_EXT;
-    indexingFeatures.pNext = nullptr;
+    indexingFeatures.pNext = &timelineFeatures;
     indexingFeatures.runtimeDescriptorArray = VK_TRUE;
 
     VkPhysicalDeviceFeatures2KHR requestedFeatures = {};
@@ -111,8 +134,6 @@ void Device::createLogicalDevice(
     requestedFeatures.features.samplerAnisotropy = VK_TRUE;
     requestedFeatures.pNext = &indexingFeatures;
 
-    requestedExtensions.push_back(VK_KHR_SWAPCHAIN_EXTENSION_NAME);
-
     VkDeviceCreateInfo createInfo = {};
     createInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
     createInfo.pNext = &indexingFeatures;
@@ -137,7 +158,7 @@ void Device::createLogicalDevice(
 
     VK_CHECK(vmaCreateAllocator(&allocatorInfo, &_allocator));
 
-    // Create commandpools and queues, assuming graphics is always required
+    // Create commandpools and queues, graphics pool always exists (aliases compute if headless)
     _commandPools.graphics = createCommandPool(
             _queueFamilyIndices.graphics, VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT);
 
@@ -493,10 +514,11 @@ void Device::createImageOnGPU(
         imageBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
         imageBarrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
         imageBarrier.newLayout = layout;
+        // Sampled by fragment shaders or only used from compute when headless
         vkCmdPipelineBarrier(
                 cmdBuf,
                 VK_PIPELINE_STAGE_TRANSFER_BIT,
-                VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+                VK_PIPELINE_STAGE_ALL_COMMANDS_BIT,
                 0,
                 0,
                 nullptr,
@@ -654,8 +676,10 @@ auto Device::createSampler() -> VkSampler
     return sampler;
 }
 
-auto Device::loadShaderFromFile(std::string const& path, VkShaderStageFlagBits stage)
-        -> VkPipelineShaderStageCreateInfo
+auto Device::loadShaderFromFile(
+        std::string const& path,
+        VkShaderStageFlagBits stage,
+        VkSpecializationInfo const* specialization) -> VkPipelineShaderStageCreateInfo
 {
     std::ifstream file(path.c_str(), std::ios::in | std::ios::binary);
     if(!file)
@@ -674,7 +698,7 @@ auto Device::loadShaderFromFile(std::string const& path, VkShaderStageFlagBits s
     shaderStageInfo.pNext = nullptr;
     shaderStageInfo.stage = stage;
     shaderStageInfo.pName = "main";
-    shaderStageInfo.pSpecializationInfo = nullptr;
+    shaderStageInfo.pSpecializationInfo = specialization;
 
     VkShaderModuleCreateInfo createInfo = {};
     createInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
@@ -688,6 +712,127 @@ auto Device::loadShaderFromFile(std::string const& path, VkShaderStageFlagBits s
     return shaderStageInfo;
 }
 
+namespace
+{
+// Prepended to the driver's cache data. The driver validates its own header as well, this one
+// lets us drop stale files without handing them to the driver at all.
+struct PipelineCacheFileHeader
+{
+    uint32_t magic = 0x43504652; // "RFPC"
+    uint32_t version = 1;
+    uint32_t vendorID = 0;
+    uint32_t deviceID = 0;
+    uint32_t driverVersion = 0;
+    uint8_t uuid[VK_UUID_SIZE] = {};
+    uint64_t dataSize = 0;
+};
+
+auto makeHeader(VkPhysicalDeviceProperties const& properties) -> PipelineCacheFileHeader
+{
+    auto header = PipelineCacheFileHeader{};
+    header.vendorID = properties.vendorID;
+    header.deviceID = properties.deviceID;
+    header.driverVersion = properties.driverVersion;
+    std::memcpy(header.uuid, properties.pipelineCacheUUID, VK_UUID_SIZE);
+    return header;
+}
+} // namespace
+
+auto Device::createPipelineCache(std::string const& path) -> void
+{
+    _pipelineCachePath = path;
+    auto data = std::vector<char>{};
+
+    if(auto file = std::ifstream(path, std::ios::binary))
+    {
+        auto const expected = makeHeader(_physicalDeviceProperties);
+        auto header = PipelineCacheFileHeader{};
+        file.read(reinterpret_cast<char*>(&header), sizeof(header));
+
+        if(file && header.magic == expected.magic && header.version == expected.version
+           && header.vendorID == expected.vendorID && header.deviceID == expected.deviceID
+           && header.driverVersion == expected.driverVersion
+           && std::memcmp(header.uuid, expected.uuid, VK_UUID_SIZE) == 0)
+        {
+            // The size is checked against the file before it is trusted with an allocation
+            auto error = std::error_code{};
+            auto const fileSize = std::filesystem::file_size(path, error);
+            auto const whole = !error && fileSize >= sizeof(header)
+                               && header.dataSize == fileSize - sizeof(header);
+            if(whole)
+            {
+                data.resize(header.dataSize);
+                file.read(data.data(), static_cast<std::streamsize>(data.size()));
+            }
+            if(!whole || !file)
+            {
+                _log->warn("Pipeline cache {} is truncated or corrupt, ignoring it", path);
+                data.clear();
+            }
+        }
+        else
+        {
+            _log->info("Pipeline cache {} is from another device or driver, ignoring it", path);
+        }
+    }
+
+    VkPipelineCacheCreateInfo cacheInfo = {};
+    cacheInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+    cacheInfo.pNext = nullptr;
+    cacheInfo.flags = 0;
+    cacheInfo.initialDataSize = data.size();
+    cacheInfo.pInitialData = data.empty() ? nullptr : data.data();
+
+    VK_CHECK(vkCreatePipelineCache(_logicalDevice, &cacheInfo, nullptr, &_pipelineCache));
+    _log->info("Pipeline cache created, {} bytes loaded", data.size());
+}
+
+auto Device::savePipelineCache() -> void
+{
+    if(!_pipelineCache || _pipelineCachePath.empty())
+    {
+        return;
+    }
+
+    // Runs from the destructor, a failure only costs the next start its warm cache
+    size_t size = 0;
+    auto result = vkGetPipelineCacheData(_logicalDevice, _pipelineCache, &size, nullptr);
+    auto data = std::vector<char>(result == VK_SUCCESS ? size : 0);
+    if(result == VK_SUCCESS)
+    {
+        result = vkGetPipelineCacheData(_logicalDevice, _pipelineCache, &size, data.data());
+    }
+    if(result != VK_SUCCESS)
+    {
+        _log->warn(
+                "Failed to read pipeline cache data: {}, not saving {}",
+                utils::errorString(result),
+                _pipelineCachePath);
+        return;
+    }
+
+    auto header = makeHeader(_physicalDeviceProperties);
+    header.dataSize = size;
+
+    // Write next to the target and rename, an interrupted run never leaves a torn file
+    auto const tmpPath = _pipelineCachePath + ".tmp";
+    {
+        auto file = std::ofstream(tmpPath, std::ios::binary | std::ios::trunc);
+        file.write(reinterpret_cast<char const*>(&header), sizeof(header));
+        file.write(data.data(), static_cast<std::streamsize>(size));
+        if(!file)
+        {
+            _log->warn("Failed to write pipeline cache {}", tmpPath);
+            return;
+        }
+    }
+
+    if(std::rename(tmpPath.c_str(), _pipelineCachePath.c_str()) != 0)
+    {
+        _log->warn("Failed to replace pipeline cache {}", _pipelineCachePath);
+    }
+}
+
 auto Device::findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties) -> uint32_t
 {
     VkPhysicalDeviceMemoryProperties memProperties;
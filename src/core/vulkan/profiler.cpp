@@ -0,0 +1,221 @@
+#include "core/vulkan/profiler.h"
+
+#include "utils/vkutils.h"
+
+#include "fmt/format.h"
+
+#include <fstream>
+
+namespace app::vk
+{
+
+GpuProfiler::GpuProfiler(
+        Device* device,
+        uint32_t queueFamily,
+        uint32_t scopeCount,
+        uint32_t queriesPerScope)
+    : _log(logs::getLogger("GpuProfiler"))
+    , _device(device)
+    , _queriesPerScope(queriesPerScope)
+    , _scopes(scopeCount)
+{
+    auto const validBits = _device->getQueueFamilyProperties(queueFamily).timestampValidBits;
+    if(validBits == 0)
+    {
+        _log->warn("Queue family {} does not support timestamps, profiling disabled", queueFamily);
+        return;
+    }
+
+    _validMask = validBits >= 64 ? ~0ull : (1ull << validBits) - 1;
+    _period = static_cast<double>(_device->getProperties().limits.timestampPeriod);
+
+    VkQueryPoolCreateInfo poolInfo = {};
+    poolInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+    poolInfo.pNext = nullptr;
+    poolInfo.flags = 0;
+    poolInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+    poolInfo.queryCount = scopeCount * queriesPerScope;
+
+    VK_CHECK(vkCreateQueryPool(_device->getLogicalDevice(), &poolInfo, nullptr, &_pool));
+}
+
+GpuProfiler::~GpuProfiler()
+{
+    if(_pool)
+    {
+        vkDestroyQueryPool(_device->getLogicalDevice(), _pool, nullptr);
+    }
+}
+
+auto GpuProfiler::timestamp(VkCommandBuffer buf, uint32_t scope, VkPipelineStageFlagBits stage)
+        -> uint32_t
+{
+    auto& s = _scopes.at(scope);
+    if(s.used == _queriesPerScope)
+    {
+        _log->warn("Scope {} is out of queries", scope);
+        return s.used - 1;
+    }
+
+    vkCmdWriteTimestamp(buf, stage, _pool, scope * _queriesPerScope + s.used);
+    return s.used++;
+}
+
+auto GpuProfiler::begin(VkCommandBuffer buf, uint32_t scope) -> void
+{
+    if(!isEnabled())
+    {
+        return;
+    }
+
+    auto& s = _scopes.at(scope);
+    s.intervals.clear();
+    s.used = 0;
+    s.pending = false;
+
+    vkCmdResetQueryPool(buf, _pool, scope * _queriesPerScope, _queriesPerScope);
+    timestamp(buf, scope, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT);
+}
+
+auto GpuProfiler::mark(
+        VkCommandBuffer buf,
+        uint32_t scope,
+        std::string name,
+        uint64_t cells,
+        uint64_t bytesPerCell) -> void
+{
+    if(!isEnabled())
+    {
+        return;
+    }
+
+    auto const to = timestamp(buf, scope, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT);
+    auto const from = to > 0 ? to - 1 : 0;
+    _scopes.at(scope).intervals.push_back({std::move(name), from, to, cells, bytesPerCell});
+}
+
+auto GpuProfiler::span(
+        VkCommandBuffer buf,
+        uint32_t scope,
+        std::string name,
+        uint64_t cells,
+        uint64_t bytesPerCell) -> void
+{
+    if(!isEnabled())
+    {
+        return;
+    }
+
+    auto const to = timestamp(buf, scope, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT);
+    _scopes.at(scope).intervals.push_back({std::move(name), 0, to, cells, bytesPerCell});
+}
+
+auto GpuProfiler::submitted(uint32_t scope) -> void
+{
+    if(!isEnabled())
+    {
+        return;
+    }
+
+    _scopes.at(scope).pending = true;
+}
+
+auto GpuProfiler::resolve(uint32_t scope) -> void
+{
+    auto& s = _scopes.at(scope);
+    if(!isEnabled() || !s.pending || s.used == 0)
+    {
+        return;
+    }
+
+    // Value and availability pairs
+    auto results = std::vector<uint64_t>(2 * s.used);
+    auto const result = vkGetQueryPoolResults(
+            _device->getLogicalDevice(),
+            _pool,
+            scope * _queriesPerScope,
+            s.used,
+            results.size() * sizeof(uint64_t),
+            results.data(),
+            2 * sizeof(uint64_t),
+            VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WITH_AVAILABILITY_BIT);
+
+    if(result != VK_SUCCESS)
+    { // Not ready yet, try again before the next submission
+        return;
+    }
+
+    for(auto const& interval : s.intervals)
+    {
+        if(results[2 * interval.from + 1] == 0 || results[2 * interval.to + 1] == 0)
+        {
+            return;
+        }
+    }
+
+    for(auto const& interval : s.intervals)
+    {
+        auto const ticks =
+                (results[2 * interval.to] - results[2 * interval.from]) & _validMask;
+        auto& stats = _stats[interval.name];
+        stats.nanoseconds += static_cast<double>(ticks) * _period;
+        stats.cells += static_cast<double>(interval.cells);
+        stats.bytes += static_cast<double>(interval.cells * interval.bytesPerCell);
+        stats.samples += 1;
+    }
+
+    s.pending = false;
+}
+
+auto GpuProfiler::report(std::string const& path) -> void
+{
+    if(!isEnabled() || _stats.empty())
+    {
+        return;
+    }
+
+    auto json = std::string{"{\n  \"passes\": ["};
+    auto first = true;
+
+    for(auto const& [name, stats] : _stats)
+    {
+        auto const seconds = stats.nanoseconds * 1e-9;
+        auto const ms = stats.nanoseconds * 1e-6 / static_cast<double>(stats.samples);
+        auto const gbps = seconds > 0.0 ? stats.bytes / seconds * 1e-9 : 0.0;
+        auto const mlups = seconds > 0.0 ? stats.cells / seconds * 1e-6 : 0.0;
+
+        _log->info(
+                "{:>10}: {:8.3f} ms, {:7.1f} GB/s, {:8.1f} MLUPS ({} samples)",
+                name,
+                ms,
+                gbps,
+                mlups,
+                stats.samples);
+
+        json += fmt::format(
+                "{}\n    {{\"name\": \"{}\", \"samples\": {}, \"ms\": {:.6f}, \"gbps\": {:.3f}, "
+                "\"mlups\": {:.3f}}}",
+                first ? "" : ",",
+                name,
+                stats.samples,
+                ms,
+                gbps,
+                mlups);
+        first = false;
+    }
+    json += "\n  ]\n}\n";
+
+    auto file = std::ofstream(path, std::ios::trunc);
+    if(!file)
+    {
+        _log->error("Failed to write profile: {}", path);
+    }
+    else
+    {
+        file << json;
+    }
+
+    _stats.clear();
+}
+
+} // namespace app::vk
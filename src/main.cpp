@@ -1,16 +1,51 @@
 #include "core/app.h"
 #include <cstdlib>
 #include <exception>
+#include <iostream>
 
+#include "boost/program_options.hpp"
 #include "logs/log.h"
 
-auto main() -> int
+namespace po = boost::program_options;
+
+auto main(int argc, char** argv) -> int
 {
+    auto options = app::LaunchOptions{};
+
+    auto description = po::options_description("Options");
+    description.add_options()("help,h", "Show this help")(
+            "config",
+            po::value<std::string>(&options.configPath)->default_value(options.configPath),
+            "Path to the config file")(
+            "headless",
+            po::bool_switch(&options.headless),
+            "Run the solver without a window and exit")(
+            "steps",
+            po::value<uint64_t>(&options.steps)->default_value(options.steps),
+            "Lattice steps to run in headless mode");
+
+    auto vm = po::variables_map{};
+    try
+    {
+        po::store(po::parse_command_line(argc, argv, description), vm);
+        po::notify(vm);
+    }
+    catch(po::error const& e)
+    {
+        std::cerr << e.what() << "\n" << description << "\n";
+        return EXIT_FAILURE;
+    }
+
+    if(vm.count("help"))
+    {
+        std::cout << description << "\n";
+        return EXIT_SUCCESS;
+    }
 
     auto log = logs::getLogger("main");
     log->info("Starting application");
 
-    auto app = app::Application{};
+    auto app = app::Application{options};
         app.init();
         app.run();
     // try
@@ -0,0 +1,169 @@
+#include "rocket/checkpoint.h"
+
+#include "common/appcontext.h"
+
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+#include <system_error>
+#include <utility>
+
+namespace app::simu
+{
+
+auto writeCheckpoint(std::string const& path, Checkpoint const& checkpoint) -> void
+{
+    auto header = checkpoint.header;
+    header.payloadBytes = checkpoint.payload.size();
+
+    auto const tmpPath = path + ".tmp";
+    {
+        auto file = std::ofstream(tmpPath, std::ios::binary | std::ios::trunc);
+        file.write(reinterpret_cast<char const*>(&header), sizeof(header));
+        file.write(
+                reinterpret_cast<char const*>(checkpoint.payload.data()),
+                static_cast<std::streamsize>(checkpoint.payload.size()));
+        if(!file)
+        {
+            throw std::runtime_error("Failed to write checkpoint " + tmpPath);
+        }
+    }
+
+    if(std::rename(tmpPath.c_str(), path.c_str()) != 0)
+    {
+        throw std::runtime_error("Failed to replace checkpoint " + path);
+    }
+}
+
+auto readCheckpoint(std::string const& path) -> Checkpoint
+{
+    auto file = std::ifstream(path, std::ios::binary);
+    if(!file)
+    {
+        throw std::runtime_error("Failed to open checkpoint " + path);
+    }
+
+    auto checkpoint = Checkpoint{};
+    auto& header = checkpoint.header;
+    file.read(reinterpret_cast<char*>(&header), sizeof(header));
+    if(!file || header.magic != CheckpointHeader::expectedMagic)
+    {
+        throw std::runtime_error(path + " is not a checkpoint");
+    }
+    if(header.version != CheckpointHeader::currentVersion)
+    {
+        throw std::runtime_error(
+                path + " is a version " + std::to_string(header.version)
+                + " checkpoint, expected version "
+                + std::to_string(CheckpointHeader::currentVersion));
+    }
+
+    // Checked before allocating, a foreign header could ask for any size
+    auto error = std::error_code{};
+    auto const fileSize = std::filesystem::file_size(path, error);
+    if(error || header.payloadBytes != fileSize - sizeof(header))
+    {
+        throw std::runtime_error(
+                "Checkpoint " + path + " is truncated or does not match its header");
+    }
+
+    checkpoint.payload.resize(header.payloadBytes);
+    file.read(
+            reinterpret_cast<char*>(checkpoint.payload.data()),
+            static_cast<std::streamsize>(checkpoint.payload.size()));
+    if(!file)
+    {
+        throw std::runtime_error("Checkpoint " + path + " is truncated");
+    }
+    return checkpoint;
+}
+
+auto continuesWith(CheckpointHeader const& header, params::SolverKernel kernel) -> bool
+{
+    auto const written = static_cast<params::SolverKernel>(header.kernel);
+    if(written == kernel)
+    {
+        return true;
+    }
+    auto const postCollision = [](params::SolverKernel k) {
+        return k == params::SolverKernel::Fused || k == params::SolverKernel::InPlaceAA;
+    };
+    return postCollision(written) && postCollision(kernel) && header.parity == 0;
+}
+
+CheckpointWriter::CheckpointWriter(std::string path) : _path(std::move(path))
+{
+    _thread = std::thread([this] { writerLoop(); });
+}
+
+CheckpointWriter::~CheckpointWriter()
+{
+    {
+        auto lock = std::lock_guard(_mutex);
+        _stop = true;
+    }
+    _changed.notify_all();
+    _thread.join();
+}
+
+auto CheckpointWriter::submit(Checkpoint checkpoint) -> void
+{
+    {
+        auto lock = std::unique_lock(_mutex);
+        _changed.wait(lock, [this] { return !_pending; });
+        rethrow();
+        _pending = std::move(checkpoint);
+    }
+    _changed.notify_all();
+}
+
+auto CheckpointWriter::wait() -> void
+{
+    auto lock = std::unique_lock(_mutex);
+    _changed.wait(lock, [this] { return !_pending; });
+    rethrow();
+}
+
+auto CheckpointWriter::rethrow() -> void
+{
+    if(_error)
+    {
+        auto error = std::exchange(_error, nullptr);
+        std::rethrow_exception(error);
+    }
+}
+
+auto CheckpointWriter::writerLoop() -> void
+{
+    auto lock = std::unique_lock(_mutex);
+    while(true)
+    {
+        // Drains the snapshot in flight before stopping
+        _changed.wait(lock, [this] { return _stop || _pending; });
+        if(!_pending)
+        {
+            return;
+        }
+
+        // The snapshot stays pending while it is written, the solver only waits when it has the
+        // next one ready
+        lock.unlock();
+        auto error = std::exception_ptr{};
+        try
+        {
+            writeCheckpoint(_path, *_pending);
+        }
+        catch(...)
+        {
+            error = std::current_exception();
+        }
+        lock.lock();
+
+        _error = error;
+        _pending.reset();
+        _changed.notify_all();
+    }
+}
+
+} // namespace app::simu
@@ -0,0 +1,84 @@
+#include "rocket/cpukernel.h"
+
+#include "streamcollide.h"
+
+#include <stdexcept>
+#include <string>
+
+namespace app::simu::cpu
+{
+
+namespace
+{
+// The vector variants are only built for x86, see src/rocket/meson.build
+auto supports(params::CpuIsa isa) -> bool
+{
+    switch(isa)
+    {
+    case params::CpuIsa::Auto:
+    case params::CpuIsa::Scalar: return true;
+#if defined(__x86_64__) || defined(__i386__)
+    case params::CpuIsa::Avx2:
+        return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+    case params::CpuIsa::Avx512: return __builtin_cpu_supports("avx512f");
+#else
+    case params::CpuIsa::Avx2:
+    case params::CpuIsa::Avx512: return false;
+#endif
+    }
+    return false;
+}
+} // namespace
+
+auto streamCollideRowScalar(LatticeView const& lattice, int y) -> void
+{
+    streamCollideRow<ScalarLanes>(lattice, y);
+}
+
+auto resolveIsa(params::CpuIsa isa) -> params::CpuIsa
+{
+    if(isa == params::CpuIsa::Auto)
+    {
+        if(supports(params::CpuIsa::Avx512))
+        {
+            return params::CpuIsa::Avx512;
+        }
+        if(supports(params::CpuIsa::Avx2))
+        {
+            return params::CpuIsa::Avx2;
+        }
+        return params::CpuIsa::Scalar;
+    }
+
+    if(!supports(isa))
+    {
+        throw std::runtime_error(std::string("CPU does not support ") + isaName(isa));
+    }
+    return isa;
+}
+
+auto rowKernel(params::CpuIsa isa) -> RowKernel
+{
+    switch(resolveIsa(isa))
+    {
+#if defined(__x86_64__) || defined(__i386__)
+    case params::CpuIsa::Avx2: return streamCollideRowAvx2;
+    case params::CpuIsa::Avx512: return streamCollideRowAvx512;
+#endif
+    default: return streamCollideRowScalar;
+    }
+}
+
+auto isaName(params::CpuIsa isa) -> char const*
+{
+    switch(isa)
+    {
+    case params::CpuIsa::Auto: return "auto";
+    case params::CpuIsa::Scalar: return "scalar";
+    case params::CpuIsa::Avx2: return "avx2";
+    case params::CpuIsa::Avx512: return "avx512";
+    }
+    return "unknown";
+}
+
+} // namespace app::simu::cpu
@@ -0,0 +1,12 @@
+// Built with -mavx2 -mfma, only called after a runtime check
+#include "streamcollide.h"
+
+namespace app::simu::cpu
+{
+
+auto streamCollideRowAvx2(LatticeView const& lattice, int y) -> void
+{
+    streamCollideRow<Avx2Lanes>(lattice, y);
+}
+
+} // namespace app::simu::cpu
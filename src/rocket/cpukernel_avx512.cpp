@@ -0,0 +1,12 @@
+// Built with -mavx512f, only called after a runtime check
+#include "streamcollide.h"
+
+namespace app::simu::cpu
+{
+
+auto streamCollideRowAvx512(LatticeView const& lattice, int y) -> void
+{
+    streamCollideRow<Avx512Lanes>(lattice, y);
+}
+
+} // namespace app::simu::cpu
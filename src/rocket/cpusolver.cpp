@@ -0,0 +1,239 @@
+#include "rocket/cpusolver.h"
+
+#include "rocket/lattice.h"
+
+#include <algorithm>
+
+namespace app::simu
+{
+
+namespace
+{
+using Config = params::Params::SimulationConfig;
+
+auto workerCount(Config const& config, utils::NumaTopology const& topology) -> uint32_t
+{
+    return config.cpuThreads > 0 ? config.cpuThreads : std::max(topology.cpuCount(), 1u);
+}
+
+auto workerCpus(Config const& config, utils::NumaTopology const& topology) -> std::vector<int>
+{
+    if(!config.cpuPinning)
+    {
+        return {};
+    }
+    return topology.placement(workerCount(config, topology));
+}
+} // namespace
+
+CpuSolver::CpuSolver(params::Params::SimulationConfig const& config)
+    : _log(logs::getLogger("CpuSolver"))
+    , _size(config.gridWidth, config.gridHeight)
+    , _isa(cpu::resolveIsa(config.cpuIsa))
+    , _kernel(cpu::rowKernel(_isa))
+    , _omega(1.0f / config.tau)
+    , _smagorinsky(config.smagorinsky)
+    , _topology(utils::NumaTopology::detect())
+    , _pool(workerCount(config, _topology), workerCpus(config, _topology))
+{
+    auto const plane = static_cast<size_t>(_size.x) * static_cast<size_t>(_size.y);
+
+    // Pages are only reserved here, firstTouch places them
+    _velocityX = utils::PageBuffer<float>(plane);
+    _velocityY = utils::PageBuffer<float>(plane);
+    _density = utils::PageBuffer<float>(plane);
+    _solid = utils::PageBuffer<uint8_t>(plane);
+    for(auto& populations : _populations)
+    {
+        populations = utils::PageBuffer<float>(9 * plane);
+    }
+
+    firstTouch();
+    logTopology();
+
+    // Neighbouring bands must not overlap once their edges have shrunk
+    auto const band = static_cast<uint32_t>(_size.y) / _pool.size();
+    auto const maxDepth = _pool.size() == 1 ? config.cpuTemporalDepth : band / 2 + 1;
+    _depth = std::min(config.cpuTemporalDepth, maxDepth);
+    if(_depth != config.cpuTemporalDepth)
+    {
+        _log->warn(
+                "Temporal depth {} needs bands of {} rows, using {}",
+                config.cpuTemporalDepth,
+                2 * (config.cpuTemporalDepth - 1),
+                _depth);
+    }
+    if(_depth > 1)
+    {
+        _log->info("Temporal blocking over {} steps per sweep", _depth);
+    }
+}
+
+auto CpuSolver::firstTouch() -> void
+{
+    auto const width = static_cast<size_t>(_size.x);
+    auto const plane = width * static_cast<size_t>(_size.y);
+
+    _solidBegin.assign(_size.y, _size.x);
+    _solidEnd.assign(_size.y, 0);
+
+    // Same split of rows as sweep(), so each band is touched first by the worker updating it
+    _pool.parallelFor(static_cast<size_t>(_size.y), [&](size_t begin, size_t end, uint32_t) {
+        for(auto y = begin; y < end; ++y)
+        {
+            for(size_t x = 0; x < width; ++x)
+            {
+                auto const i = y * width + x;
+                auto const cell =
+                        initialCell(_size, glm::ivec2(static_cast<int>(x), static_cast<int>(y)));
+                _velocityX[i] = cell.velocity.x;
+                _velocityY[i] = cell.velocity.y;
+                _density[i] = cell.density;
+                _solid[i] = static_cast<uint8_t>(cell.isSolid);
+                for(size_t k = 0; k < 9; ++k)
+                {
+                    _populations[0][k * plane + i] = cell.distribution[k];
+                    _populations[1][k * plane + i] = cell.distribution[k];
+                }
+
+                if(cell.isSolid)
+                {
+                    _solidBegin[y] = std::min(_solidBegin[y], static_cast<int>(x));
+                    _solidEnd[y] = std::max(_solidEnd[y], static_cast<int>(x) + 1);
+                }
+            }
+        }
+    });
+}
+
+auto CpuSolver::logTopology() const -> void
+{
+    _log->info(
+            "{}x{} lattice on {} threads using {}, {} NUMA node(s) with {} processors",
+            _size.x,
+            _size.y,
+            _pool.size(),
+            cpu::isaName(_isa),
+            _topology.nodes.size(),
+            _topology.cpuCount());
+
+    for(auto const& node : _topology.nodes)
+    {
+        uint32_t workers = 0;
+        auto rows = std::pair<size_t, size_t>{static_cast<size_t>(_size.y), 0};
+        for(uint32_t w = 0; w < _pool.size(); ++w)
+        {
+            if(_topology.nodeOf(_pool.cpuOf(w)) == node.id)
+            {
+                auto const [begin, end] =
+                        utils::ThreadPool::range(static_cast<size_t>(_size.y), w, _pool.size());
+                rows = {std::min(rows.first, begin), std::max(rows.second, end)};
+                ++workers;
+            }
+        }
+
+        _log->info(
+                "  node {}: {} processors, {:.1f} GiB, {} pinned workers{}",
+                node.id,
+                node.cpus.size(),
+                static_cast<double>(node.memoryBytes) / (1024.0 * 1024.0 * 1024.0),
+                workers,
+                workers > 0 ? fmt::format(" owning rows {}-{}", rows.first, rows.second - 1)
+                            : std::string{});
+    }
+
+    uint32_t unpinned = 0;
+    for(uint32_t w = 0; w < _pool.size(); ++w)
+    {
+        unpinned += _pool.cpuOf(w) < 0 ? 1 : 0;
+    }
+    if(unpinned > 0)
+    {
+        _log->warn("{} of {} workers are not pinned", unpinned, _pool.size());
+    }
+}
+
+auto CpuSolver::getDistribution(size_t i) const -> std::span<float const>
+{
+    auto const plane = _velocityX.size();
+    return std::span<float const>(_populations[_readIndex]).subspan(i * plane, plane);
+}
+
+auto CpuSolver::simulate(uint64_t steps) -> void
+{
+    while(steps > 0)
+    {
+        auto const depth = static_cast<uint32_t>(std::min<uint64_t>(steps, _depth));
+        sweep(depth);
+        steps -= depth;
+    }
+}
+
+auto CpuSolver::latticeView(uint32_t readIndex) -> cpu::LatticeView
+{
+    auto view = cpu::LatticeView{};
+    view.width = _size.x;
+    view.height = _size.y;
+    view.src = _populations[readIndex].data();
+    view.dst = _populations[1 - readIndex].data();
+    view.velocityX = _velocityX.data();
+    view.velocityY = _velocityY.data();
+    view.density = _density.data();
+    view.solid = _solid.data();
+    view.solidBegin = _solidBegin.data();
+    view.solidEnd = _solidEnd.data();
+    view.omega = _omega;
+    view.smagorinsky = _smagorinsky;
+    return view;
+}
+
+auto CpuSolver::sweep(uint32_t depth) -> void
+{
+    // Step k of the sweep streams from lattice views[k % 2]
+    auto const views = std::array{latticeView(_readIndex), latticeView(1 - _readIndex)};
+    auto const height = static_cast<size_t>(_size.y);
+
+    // Each worker owns a band of whole rows, the macro fields are only touched at their own cell.
+    // Step k runs one row behind step k - 1 and stays k rows clear of edges shared with another
+    // band; the domain walls need no margin.
+    _pool.parallelFor(height, [&](size_t begin, size_t end, uint32_t) {
+        auto const top = begin == 0 ? 0 : 1;
+        auto const bottom = end == height ? 0 : 1;
+        for(auto row = begin; row < end + depth; ++row)
+        {
+            for(uint32_t k = 0; k < depth && k <= row; ++k)
+            {
+                auto const y = row - k;
+                if(y >= begin + k * top && y + k * bottom < end)
+                {
+                    _kernel(views[k % 2], static_cast<int>(y));
+                }
+            }
+        }
+    });
+
+    // Fill the triangle of rows [edge - k, edge + k) each step left out around every shared edge
+    if(depth > 1 && _pool.size() > 1)
+    {
+        auto const edges = _pool.size() - 1;
+        _pool.parallelFor(edges, [&](size_t first, size_t last, uint32_t) {
+            for(auto e = first; e < last; ++e)
+            {
+                auto const edge =
+                        utils::ThreadPool::range(height, static_cast<uint32_t>(e) + 1, _pool.size())
+                                .first;
+                for(uint32_t k = 1; k < depth; ++k)
+                {
+                    for(auto y = edge - k; y < edge + k; ++y)
+                    {
+                        _kernel(views[k % 2], static_cast<int>(y));
+                    }
+                }
+            }
+        });
+    }
+
+    _readIndex = (_readIndex + depth) % 2;
+}
+
+} // namespace app::simu
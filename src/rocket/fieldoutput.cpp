@@ -0,0 +1,519 @@
+#include "rocket/fieldoutput.h"
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fmt/format.h>
+#include <iterator>
+#include <limits>
+#include <stdexcept>
+#include <utility>
+
+namespace app::simu
+{
+
+static_assert(sizeof(FieldSeriesHeader) == 64);
+static_assert(sizeof(FieldFrameHeader) == 16);
+static_assert(sizeof(QuantizedFrameHeader) == 64);
+static_assert(sizeof(QuantizedTile) == 8);
+static_assert(std::endian::native == std::endian::little, "Field series are little endian");
+
+namespace
+{
+constexpr auto headerWords = sizeof(QuantizedFrameHeader) / sizeof(uint32_t);
+constexpr auto tileWords = sizeof(QuantizedTile) / sizeof(uint32_t);
+
+// Width of the largest quantized value of a tile, as compress_quantize.comp computes it
+auto tileBits(float minimum, float maximum, float scale) -> uint32_t
+{
+    auto const levels = std::floor((maximum - minimum) * scale + 0.5f);
+    if(!(levels < 2147483648.0f))
+    { // NaN included
+        return QuantizedFrameHeader::rawBits;
+    }
+    return static_cast<uint32_t>(std::bit_width(static_cast<uint32_t>(levels)));
+}
+
+auto packedWords(uint32_t cells, uint32_t bits) -> size_t
+{
+    return (static_cast<size_t>(cells) * bits + 31) / 32;
+}
+} // namespace
+
+auto writeFieldCsv(std::string const& path, FieldSnapshot const& snapshot) -> void
+{
+    auto text = fmt::memory_buffer{};
+    fmt::format_to(
+            std::back_inserter(text), "Element,data.velocity.x,data.velocity.y,data.density\n");
+    for(size_t i = 0; i < snapshot.density.size(); ++i)
+    {
+        fmt::format_to(
+                std::back_inserter(text),
+                "{},{},{},{}\n",
+                i,
+                snapshot.velocityX[i],
+                snapshot.velocityY[i],
+                snapshot.density[i]);
+    }
+
+    // Plotting scripts may read the file while the next snapshot is written
+    auto const tmpPath = path + ".tmp";
+    {
+        auto file = std::ofstream(tmpPath, std::ios::binary | std::ios::trunc);
+        file.write(text.data(), static_cast<std::streamsize>(text.size()));
+        if(!file)
+        {
+            throw std::runtime_error("Failed to write field output " + tmpPath);
+        }
+    }
+
+    if(std::rename(tmpPath.c_str(), path.c_str()) != 0)
+    {
+        throw std::runtime_error("Failed to replace field output " + path);
+    }
+}
+
+auto vorticity(FieldSnapshot const& snapshot) -> std::vector<float>
+{
+    auto const width = snapshot.width;
+    auto const height = snapshot.height;
+    auto at = [width](std::vector<float> const& plane, int x, int y) {
+        return plane[static_cast<size_t>(y) * static_cast<size_t>(width) + static_cast<size_t>(x)];
+    };
+
+    auto curl = std::vector<float>(static_cast<size_t>(width) * static_cast<size_t>(height));
+    for(int y = 0; y < height; ++y)
+    {
+        auto const down = std::max(y - 1, 0);
+        auto const up = std::min(y + 1, height - 1);
+        for(int x = 0; x < width; ++x)
+        {
+            auto const left = std::max(x - 1, 0);
+            auto const right = std::min(x + 1, width - 1);
+
+            auto const dvdx = right > left ? (at(snapshot.velocityY, right, y)
+                                              - at(snapshot.velocityY, left, y))
+                                                     / static_cast<float>(right - left)
+                                           : 0.0f;
+            auto const dudy = up > down ? (at(snapshot.velocityX, x, up)
+                                           - at(snapshot.velocityX, x, down))
+                                                  / static_cast<float>(up - down)
+                                        : 0.0f;
+            curl[static_cast<size_t>(y) * static_cast<size_t>(width) + static_cast<size_t>(x)] =
+                    dvdx - dudy;
+        }
+    }
+    return curl;
+}
+
+auto toHalf(float value) -> uint16_t
+{
+    auto bits = std::bit_cast<uint32_t>(value);
+    auto const sign = static_cast<uint16_t>((bits >> 16) & 0x8000u);
+    bits &= 0x7fffffffu;
+
+    if(bits >= 0x7f800000u)
+    { // Infinity, or a quiet NaN
+        return static_cast<uint16_t>(sign | (bits > 0x7f800000u ? 0x7e00u : 0x7c00u));
+    }
+    if(bits >= 0x477ff000u)
+    { // 65520 and above round past the largest half
+        return static_cast<uint16_t>(sign | 0x7c00u);
+    }
+
+    auto round = [](uint32_t kept, uint32_t dropped, uint32_t halfway) {
+        return dropped > halfway || (dropped == halfway && (kept & 1u) != 0) ? kept + 1 : kept;
+    };
+
+    if(bits < 0x38800000u)
+    { // Subnormal half, values up to 2^-25 round to zero
+        if(bits < 0x33000000u)
+        {
+            return sign;
+        }
+        auto const shift = 126u - (bits >> 23);
+        auto const mantissa = (bits & 0x7fffffu) | 0x800000u;
+        auto const half = round(
+                mantissa >> shift, mantissa & ((1u << shift) - 1u), 1u << (shift - 1u));
+        return static_cast<uint16_t>(sign | half);
+    }
+
+    // Rebias the exponent from 127 to 15, a carry out of the mantissa moves into the exponent
+    bits -= 0x38000000u;
+    return static_cast<uint16_t>(sign | round(bits >> 13, bits & 0x1fffu, 0x1000u));
+}
+
+auto fromHalf(uint16_t half) -> float
+{
+    auto const sign = static_cast<uint32_t>(half & 0x8000u) << 16;
+    auto const exponent = static_cast<uint32_t>(half >> 10) & 0x1fu;
+    auto const mantissa = static_cast<uint32_t>(half) & 0x3ffu;
+
+    if(exponent == 0x1fu)
+    {
+        return std::bit_cast<float>(sign | 0x7f800000u | (mantissa << 13));
+    }
+    if(exponent == 0)
+    {
+        auto const magnitude = std::ldexp(static_cast<float>(mantissa), -24);
+        return sign != 0 ? -magnitude : magnitude;
+    }
+    return std::bit_cast<float>(sign | ((exponent + 112u) << 23) | (mantissa << 13));
+}
+
+auto quantizeFields(
+        FieldSnapshot const& snapshot,
+        uint32_t tileWidth,
+        uint32_t tileHeight,
+        float errorBound) -> std::vector<uint32_t>
+{
+    auto const width = static_cast<uint32_t>(snapshot.width);
+    auto const height = static_cast<uint32_t>(snapshot.height);
+    auto const tileCells = tileWidth * tileHeight;
+    auto const step = 2.0f * errorBound;
+    auto const scale = 1.0f / step;
+
+    auto header = QuantizedFrameHeader{};
+    header.tileWidth = tileWidth;
+    header.tileHeight = tileHeight;
+    header.tilesX = (width + tileWidth - 1) / tileWidth;
+    header.tilesY = (height + tileHeight - 1) / tileHeight;
+    header.errorBound = errorBound;
+
+    auto const tiles = size_t{header.tilesX} * header.tilesY;
+    auto table = std::vector<QuantizedTile>(QuantizedFrameHeader::planes * tiles);
+    auto payload = std::vector<uint32_t>{};
+    auto values = std::vector<float>(tileCells);
+    auto inside = std::vector<bool>(tileCells);
+
+    auto const planes = std::array{&snapshot.velocityX, &snapshot.velocityY, &snapshot.density};
+    for(uint32_t p = 0; p < QuantizedFrameHeader::planes; ++p)
+    {
+        for(uint32_t t = 0; t < tiles; ++t)
+        {
+            auto const originX = t % header.tilesX * tileWidth;
+            auto const originY = t / header.tilesX * tileHeight;
+            auto minimum = std::numeric_limits<float>::infinity();
+            auto maximum = -std::numeric_limits<float>::infinity();
+            for(uint32_t i = 0; i < tileCells; ++i)
+            {
+                auto const x = originX + i % tileWidth;
+                auto const y = originY + i / tileWidth;
+                inside[i] = x < width && y < height;
+                if(inside[i])
+                {
+                    values[i] = (*planes[p])[size_t{y} * width + x];
+                    minimum = std::min(minimum, values[i]);
+                    maximum = std::max(maximum, values[i]);
+                }
+            }
+
+            auto& tile = table[p * tiles + t];
+            tile.minimum = minimum;
+            tile.bits = tileBits(minimum, maximum, scale);
+
+            auto const base = payload.size();
+            payload.resize(base + packedWords(tileCells, tile.bits));
+            for(uint32_t i = 0; i < tileCells; ++i)
+            {
+                if(!inside[i])
+                {
+                    continue;
+                }
+
+                auto quantized = uint32_t{0};
+                auto error = 0.0f;
+                if(tile.bits == QuantizedFrameHeader::rawBits)
+                {
+                    quantized = std::bit_cast<uint32_t>(values[i]);
+                }
+                else
+                {
+                    quantized = static_cast<uint32_t>(
+                            std::floor((values[i] - minimum) * scale + 0.5f));
+                    error = std::abs(minimum + static_cast<float>(quantized) * step - values[i]);
+                }
+                header.maxError[p] = std::max(header.maxError[p], error);
+                if(tile.bits == 0)
+                { // Every value of the tile decodes to its minimum
+                    continue;
+                }
+
+                auto const bit = size_t{i} * tile.bits;
+                auto const shift = static_cast<uint32_t>(bit % 32);
+                payload[base + bit / 32] |= quantized << shift;
+                if(shift + tile.bits > 32)
+                {
+                    payload[base + bit / 32 + 1] |= quantized >> (32 - shift);
+                }
+            }
+        }
+    }
+
+    auto frame = std::vector<uint32_t>(headerWords + tileWords * table.size() + payload.size());
+    header.frameWords = static_cast<uint32_t>(frame.size());
+    std::memcpy(frame.data(), &header, sizeof(header));
+    std::memcpy(frame.data() + headerWords, table.data(), table.size() * sizeof(QuantizedTile));
+    std::copy(payload.begin(), payload.end(), frame.end() - static_cast<ptrdiff_t>(payload.size()));
+    return frame;
+}
+
+auto dequantizeFields(std::span<uint32_t const> frame, int width, int height, uint64_t step)
+        -> FieldSnapshot
+{
+    auto header = QuantizedFrameHeader{};
+    if(frame.size() < headerWords)
+    {
+        throw std::runtime_error("Quantized frame is shorter than its header");
+    }
+    std::memcpy(reinterpret_cast<char*>(&header), frame.data(), sizeof(header));
+
+    // The tiles cover the grid with less than a tile to spare
+    auto covers = [](uint32_t tiles, uint32_t tileSize, int cells) {
+        auto const covered = static_cast<int64_t>(tiles) * tileSize;
+        return covered >= cells && covered - cells < tileSize;
+    };
+    if(header.frameWords != frame.size() || !covers(header.tilesX, header.tileWidth, width)
+       || !covers(header.tilesY, header.tileHeight, height))
+    {
+        throw std::runtime_error(fmt::format(
+                "Quantized frame of {} words does not hold a {}x{} grid",
+                frame.size(),
+                width,
+                height));
+    }
+
+    auto const tileCells = header.tileWidth * header.tileHeight;
+    auto const tiles = size_t{header.tilesX} * header.tilesY;
+    auto const stepSize = 2.0f * header.errorBound;
+    auto const table = frame.subspan(headerWords, tileWords * QuantizedFrameHeader::planes * tiles);
+    auto offset = headerWords + table.size();
+
+    auto snapshot = FieldSnapshot{};
+    snapshot.step = step;
+    snapshot.width = width;
+    snapshot.height = height;
+    auto const cells = static_cast<size_t>(width) * static_cast<size_t>(height);
+    snapshot.velocityX.resize(cells);
+    snapshot.velocityY.resize(cells);
+    snapshot.density.resize(cells);
+
+    auto const planes = std::array{&snapshot.velocityX, &snapshot.velocityY, &snapshot.density};
+    for(uint32_t p = 0; p < QuantizedFrameHeader::planes; ++p)
+    {
+        for(uint32_t t = 0; t < tiles; ++t)
+        {
+            auto tile = QuantizedTile{};
+            std::memcpy(
+                    reinterpret_cast<char*>(&tile),
+                    &table[tileWords * (p * tiles + t)],
+                    sizeof(tile));
+            auto const words = packedWords(tileCells, tile.bits);
+            if(tile.bits > QuantizedFrameHeader::rawBits || offset + words > frame.size())
+            {
+                throw std::runtime_error("Quantized frame is cut short");
+            }
+
+            auto const packed = frame.subspan(offset, words);
+            auto const mask = tile.bits == 32 ? ~0u : (1u << tile.bits) - 1u;
+            auto const originX = t % header.tilesX * header.tileWidth;
+            auto const originY = t / header.tilesX * header.tileHeight;
+            for(uint32_t i = 0; i < tileCells; ++i)
+            {
+                auto const x = originX + i % header.tileWidth;
+                auto const y = originY + i / header.tileWidth;
+                if(x >= static_cast<uint32_t>(width) || y >= static_cast<uint32_t>(height))
+                {
+                    continue;
+                }
+
+                auto quantized = uint32_t{0};
+                if(tile.bits > 0)
+                {
+                    auto const bit = size_t{i} * tile.bits;
+                    auto const shift = static_cast<uint32_t>(bit % 32);
+                    quantized = packed[bit / 32] >> shift;
+                    if(shift + tile.bits > 32)
+                    {
+                        quantized |= packed[bit / 32 + 1] << (32 - shift);
+                    }
+                    quantized &= mask;
+                }
+
+                auto& value = (*planes[p])[size_t{y} * static_cast<size_t>(width) + x];
+                value = tile.bits == QuantizedFrameHeader::rawBits
+                                ? std::bit_cast<float>(quantized)
+                                : tile.minimum + static_cast<float>(quantized) * stepSize;
+            }
+            offset += words;
+        }
+    }
+    return snapshot;
+}
+
+FieldSeriesWriter::FieldSeriesWriter(
+        std::string path,
+        int width,
+        int height,
+        FieldEncoding encoding,
+        std::optional<uint64_t> resumeStep)
+    : _path(std::move(path))
+{
+    _header.width = width;
+    _header.height = height;
+    _header.valueBytes = static_cast<uint32_t>(encoding);
+    if(encoding == FieldEncoding::Quantized)
+    { // Frames vary in size, vorticity is left to the readers
+        _header.planeCount = QuantizedFrameHeader::planes;
+        _header.frameBytes = 0;
+    }
+    else
+    {
+        auto const planeBytes = uint64_t{FieldSeriesHeader::planes}
+                                * static_cast<uint64_t>(width) * static_cast<uint64_t>(height)
+                                * _header.valueBytes;
+        _header.frameBytes = sizeof(FieldFrameHeader) + (planeBytes + 15) / 16 * 16;
+    }
+
+    // A restarted run continues a series of the same shape, dropping a frame cut short
+    auto compatible = false;
+    auto file = resumeStep ? std::ifstream(_path, std::ios::binary) : std::ifstream{};
+    if(file)
+    {
+        auto existing = FieldSeriesHeader{};
+        file.read(reinterpret_cast<char*>(&existing), sizeof(existing));
+        compatible = file && existing.magic == _header.magic
+                     && existing.version == _header.version
+                     && existing.headerBytes == _header.headerBytes
+                     && existing.width == _header.width && existing.height == _header.height
+                     && existing.valueBytes == _header.valueBytes
+                     && existing.planeCount == _header.planeCount
+                     && existing.frameBytes == _header.frameBytes;
+    }
+
+    file.close();
+
+    if(compatible)
+    {
+        std::filesystem::resize_file(_path, scanFrames(*resumeStep));
+        _file.open(_path, std::ios::binary | std::ios::app);
+    }
+    else
+    {
+        _file.open(_path, std::ios::binary | std::ios::trunc);
+        _file.write(reinterpret_cast<char const*>(&_header), sizeof(_header));
+        _file.flush();
+    }
+
+    if(!_file)
+    {
+        throw std::runtime_error("Failed to open field series " + _path);
+    }
+}
+
+auto FieldSeriesWriter::scanFrames(uint64_t lastStep) -> uint64_t
+{
+    auto file = std::ifstream(_path, std::ios::binary);
+    auto const size = std::filesystem::file_size(_path);
+    auto end = uint64_t{_header.headerBytes};
+    auto frame = FieldFrameHeader{};
+
+    _frames = 0;
+    while(end + sizeof(frame) <= size)
+    {
+        file.seekg(static_cast<std::streamoff>(end));
+        file.read(reinterpret_cast<char*>(&frame), sizeof(frame));
+        if(!file || frame.magic != FieldFrameHeader::expectedMagic
+           || end + sizeof(frame) + frame.payloadBytes > size || frame.step > lastStep
+           || (_header.frameBytes > 0 && sizeof(frame) + frame.payloadBytes != _header.frameBytes))
+        {
+            break;
+        }
+        end += sizeof(frame) + frame.payloadBytes;
+        ++_frames;
+    }
+    return end;
+}
+
+auto FieldSeriesWriter::append(FieldSnapshot const& snapshot) -> void
+{
+    if(encoding() == FieldEncoding::Quantized)
+    {
+        throw std::invalid_argument("Field series " + _path + " takes quantized frames only");
+    }
+    if(snapshot.width != _header.width || snapshot.height != _header.height)
+    {
+        throw std::invalid_argument(fmt::format(
+                "A {}x{} snapshot does not fit the {}x{} field series {}",
+                snapshot.width,
+                snapshot.height,
+                _header.width,
+                _header.height,
+                _path));
+    }
+
+    // Zeroes the padding as well
+    _frame.assign(_header.frameBytes, 0);
+
+    auto frameHeader = FieldFrameHeader{};
+    frameHeader.payloadBytes = static_cast<uint32_t>(_header.frameBytes - sizeof(frameHeader));
+    frameHeader.step = snapshot.step;
+    std::memcpy(_frame.data(), &frameHeader, sizeof(frameHeader));
+
+    auto const curl = vorticity(snapshot);
+    auto* out = _frame.data() + sizeof(frameHeader);
+    for(auto const* plane : {&snapshot.velocityX, &snapshot.velocityY, &snapshot.density, &curl})
+    {
+        if(_header.valueBytes == 2)
+        {
+            for(auto const value : *plane)
+            {
+                auto const half = toHalf(value);
+                std::memcpy(out, &half, sizeof(half));
+                out += sizeof(half);
+            }
+        }
+        else
+        {
+            std::memcpy(out, plane->data(), plane->size() * sizeof(float));
+            out += plane->size() * sizeof(float);
+        }
+    }
+
+    write();
+}
+
+auto FieldSeriesWriter::append(uint64_t step, std::span<uint32_t const> frame) -> void
+{
+    if(encoding() != FieldEncoding::Quantized)
+    {
+        throw std::invalid_argument("Field series " + _path + " takes float frames only");
+    }
+
+    auto const bytes = frame.size_bytes();
+    auto frameHeader = FieldFrameHeader{};
+    frameHeader.payloadBytes = static_cast<uint32_t>((bytes + 15) / 16 * 16);
+    frameHeader.step = step;
+
+    _frame.assign(sizeof(frameHeader) + frameHeader.payloadBytes, 0);
+    std::memcpy(_frame.data(), &frameHeader, sizeof(frameHeader));
+    std::memcpy(_frame.data() + sizeof(frameHeader), frame.data(), bytes);
+    write();
+}
+
+auto FieldSeriesWriter::write() -> void
+{
+    // Readers count whole frames only, one still being written is not part of the series
+    _file.write(_frame.data(), static_cast<std::streamsize>(_frame.size()));
+    _file.flush();
+    if(!_file)
+    {
+        throw std::runtime_error("Failed to append to field series " + _path);
+    }
+    ++_frames;
+}
+
+} // namespace app::simu
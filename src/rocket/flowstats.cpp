@@ -0,0 +1,98 @@
+#include "rocket/flowstats.h"
+
+#include <algorithm>
+#include <charconv>
+#include <cstddef>
+#include <fmt/format.h>
+#include <iterator>
+#include <stdexcept>
+#include <utility>
+
+namespace app::simu
+{
+
+static_assert(sizeof(FlowStatistics) == 8 * sizeof(float), "Matches flow_stats_reduce.comp");
+
+namespace
+{
+// Of a line of the history, step to max_density
+constexpr std::ptrdiff_t columns = 10;
+} // namespace
+
+auto forceCoefficient(float force, float density, float velocity, float diameter) -> float
+{
+    return 2.0f * force / (density * velocity * velocity * diameter);
+}
+
+FlowStatsWriter::FlowStatsWriter(
+        std::string path,
+        float referenceVelocity,
+        float referenceLength,
+        std::optional<uint64_t> resumeStep)
+    : _path(std::move(path))
+    , _referenceVelocity(referenceVelocity)
+    , _referenceLength(referenceLength)
+{
+    // Whole samples of the run being continued, up to the step it restarts from
+    auto kept = std::string{};
+    if(resumeStep)
+    {
+        auto previous = std::ifstream(_path);
+        for(auto line = std::string{}; std::getline(previous, line);)
+        {
+            auto step = uint64_t{0};
+            auto const* end = line.data() + line.size();
+            auto const [next, error] = std::from_chars(line.data(), end, step);
+            auto const whole = std::count(line.begin(), line.end(), ',') == columns - 1;
+            if(error == std::errc{} && next != end && *next == ',' && whole && step <= *resumeStep)
+            {
+                kept += line + '\n';
+            }
+        }
+    }
+
+    _file.open(_path, std::ios::trunc);
+    _file << "step,mass,kinetic_energy,force_x,force_y,drag_coefficient,lift_coefficient,"
+             "max_speed,min_density,max_density\n"
+          << kept;
+    _file.flush();
+
+    if(!_file)
+    {
+        throw std::runtime_error("Failed to open flow statistics " + _path);
+    }
+}
+
+auto FlowStatsWriter::append(uint64_t step, FlowStatistics const& statistics) -> void
+{
+    // The fluid around the body is at rest density
+    auto const drag =
+            forceCoefficient(statistics.forceX, 1.0f, _referenceVelocity, _referenceLength);
+    auto const lift =
+            forceCoefficient(statistics.forceY, 1.0f, _referenceVelocity, _referenceLength);
+
+    auto line = fmt::memory_buffer{};
+    fmt::format_to(
+            std::back_inserter(line),
+            "{},{},{},{},{},{},{},{},{},{}\n",
+            step,
+            statistics.mass,
+            statistics.kineticEnergy,
+            statistics.forceX,
+            statistics.forceY,
+            drag,
+            lift,
+            statistics.maxSpeed,
+            statistics.minDensity,
+            statistics.maxDensity);
+
+    // Whole lines only, plots may follow the file while the run goes on
+    _file.write(line.data(), static_cast<std::streamsize>(line.size()));
+    _file.flush();
+    if(!_file)
+    {
+        throw std::runtime_error("Failed to append to flow statistics " + _path);
+    }
+}
+
+} // namespace app::simu
@@ -0,0 +1,38 @@
+#include "rocket/lattice.h"
+
+#include "glm/glm.hpp"
+
+namespace app::simu
+{
+
+auto equilibriumDistribution(size_t i, float rho, glm::vec2 u) -> float
+{
+    float eu = glm::dot(glm::vec2(latticeVelocities[i]), u);
+    float u2 = glm::dot(u, u);
+
+    return latticeWeights[i] * rho * (1.0f + 3.0f * eu + 4.5f * eu * eu - 1.5f * u2);
+}
+
+auto cylinderDiameter(glm::ivec2 size) -> float
+{
+    return 2.0f * static_cast<float>(size.y) / 15.f;
+}
+
+auto initialCell(glm::ivec2 size, glm::ivec2 pos) -> GridCell
+{
+    glm::ivec2 cylinderCenter(size.x / 5, size.y / 2);
+    float cylinderRadius = 0.5f * cylinderDiameter(size);
+
+    auto cell = GridCell{};
+    cell.velocity = glm::vec2(-0.001f, 0.0f);
+    cell.density = 1.f;
+    cell.isSolid = glm::length(glm::vec2(pos - cylinderCenter)) <= cylinderRadius ? 1 : 0;
+
+    for(size_t k = 0; k < 9; ++k)
+    {
+        cell.distribution[k] = equilibriumDistribution(k, cell.density, cell.velocity);
+    }
+    return cell;
+}
+
+} // namespace app::simu
@@ -0,0 +1,233 @@
+#include "rocket/readback.h"
+
+#include "rocket/lattice.h"
+
+#include <cstring>
+#include <utility>
+
+namespace app::simu
+{
+
+FieldReadback::FieldReadback(vk::Device* device, VkDeviceSize slotBytes, uint32_t slots)
+    : _log(logs::getLogger("FieldReadback"))
+    , _device(device)
+    // Slots start on a 16 byte boundary
+    , _slotBytes((slotBytes + 15) / 16 * 16)
+    , _slots(slots)
+{
+    _ring = _device->createBuffer(
+            VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+            VMA_MEMORY_USAGE_GPU_TO_CPU,
+            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_CACHED_BIT,
+            _slotBytes * slots);
+    VK_CHECK(_ring.map());
+
+    VkFenceCreateInfo fenceInfo = {};
+    fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+    fenceInfo.flags = 0;
+
+    for(uint32_t i = 0; i < slots; ++i)
+    {
+        auto& slot = _slots[i];
+        slot.offset = i * _slotBytes;
+        VK_CHECK(vkCreateFence(_device->getLogicalDevice(), &fenceInfo, nullptr, &slot.fence));
+        slot.commands = _device->createCommandBuffer(
+                VK_COMMAND_BUFFER_LEVEL_PRIMARY, VK_QUEUE_COMPUTE_BIT, false);
+    }
+
+    _thread = std::thread([this] { drainLoop(); });
+}
+
+FieldReadback::~FieldReadback()
+{
+    {
+        auto lock = std::lock_guard(_mutex);
+        _stop = true;
+    }
+    _submitted.notify_all();
+    _thread.join();
+
+    if(_dropped > 0)
+    {
+        _log->warn("{} readbacks were dropped, every slot was still in flight", _dropped);
+    }
+
+    for(auto& slot : _slots)
+    {
+        vkDestroyFence(_device->getLogicalDevice(), slot.fence, nullptr);
+        vkFreeCommandBuffers(
+                _device->getLogicalDevice(), _device->getComputeCommandPool(), 1, &slot.commands);
+    }
+}
+
+auto FieldReadback::addConsumer(Consumer consumer) -> void
+{
+    _consumers.push_back(std::move(consumer));
+}
+
+auto FieldReadback::submit(uint64_t step, Fill const& fill) -> bool
+{
+    auto const index = _next;
+    auto& slot = _slots[index];
+    {
+        auto lock = std::lock_guard(_mutex);
+        if(slot.busy)
+        {
+            ++_dropped;
+            return false;
+        }
+    }
+
+    // The slot is idle, nothing waits on its fence
+    VK_CHECK(vkResetFences(_device->getLogicalDevice(), 1, &slot.fence));
+    record(slot, fill);
+    slot.step = step;
+
+    VkSubmitInfo submitInfo = {};
+    submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    submitInfo.commandBufferCount = 1;
+    submitInfo.pCommandBuffers = &slot.commands;
+    VK_CHECK(vkQueueSubmit(_device->getComputeQueue(), 1, &submitInfo, slot.fence));
+
+    {
+        auto lock = std::lock_guard(_mutex);
+        slot.busy = true;
+        _inFlight.push_back(index);
+    }
+    _submitted.notify_one();
+
+    _next = (_next + 1) % static_cast<uint32_t>(_slots.size());
+    return true;
+}
+
+auto FieldReadback::record(Slot& slot, Fill const& fill) -> void
+{
+    VK_CHECK(vkResetCommandBuffer(slot.commands, 0));
+    _device->beginCommandBuffer(slot.commands, VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT);
+
+    fill(slot.commands, slot.offset);
+
+    auto const fillStages = VK_PIPELINE_STAGE_TRANSFER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+    auto barrierInfo = VkBufferMemoryBarrier{};
+    barrierInfo.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+    barrierInfo.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+    barrierInfo.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+    barrierInfo.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrierInfo.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrierInfo.buffer = _ring.buffer;
+    barrierInfo.offset = slot.offset;
+    barrierInfo.size = _slotBytes;
+    vkCmdPipelineBarrier(
+            slot.commands,
+            fillStages,
+            VK_PIPELINE_STAGE_HOST_BIT,
+            0,
+            0,
+            nullptr,
+            1,
+            &barrierInfo,
+            0,
+            nullptr);
+    // Steps submitted later overwrite the fields only once the fill has read them
+    vkCmdPipelineBarrier(
+            slot.commands,
+            fillStages,
+            VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+            0,
+            0,
+            nullptr,
+            0,
+            nullptr,
+            0,
+            nullptr);
+
+    VK_CHECK(vkEndCommandBuffer(slot.commands));
+}
+
+auto FieldReadback::drainLoop() -> void
+{
+    while(true)
+    {
+        auto index = uint32_t{0};
+        {
+            auto lock = std::unique_lock(_mutex);
+            // Drains the slots in flight before stopping
+            _submitted.wait(lock, [this] { return _stop || !_inFlight.empty(); });
+            if(_inFlight.empty())
+            {
+                return;
+            }
+            index = _inFlight.front();
+        }
+
+        // The slot is left alone by the submitting thread until it is marked idle again
+        auto& slot = _slots[index];
+        try
+        {
+            VK_CHECK(vkWaitForFences(
+                    _device->getLogicalDevice(), 1, &slot.fence, VK_TRUE, UINT64_MAX));
+            VK_CHECK(vmaInvalidateAllocation(
+                    _ring.allocator, _ring.memory, slot.offset, _slotBytes));
+
+            auto const bytes = std::span(static_cast<std::byte const*>(_ring.mapped), _ring.size)
+                                       .subspan(slot.offset, _slotBytes);
+            for(auto const& consumer : _consumers)
+            {
+                consumer(slot.step, bytes);
+            }
+        }
+        catch(std::exception const& e)
+        {
+            _log->error("Readback of step {} failed: {}", slot.step, e.what());
+        }
+
+        auto lock = std::lock_guard(_mutex);
+        _inFlight.pop_front();
+        slot.busy = false;
+    }
+}
+
+auto fieldCopyBytes(params::LatticeLayout layout, glm::ivec2 size) -> VkDeviceSize
+{
+    auto const cells = static_cast<VkDeviceSize>(size.x) * static_cast<VkDeviceSize>(size.y);
+    return layout == params::LatticeLayout::AoS ? cells * sizeof(GridCell)
+                                                : 3 * cells * sizeof(float);
+}
+
+auto unpackFieldCopy(
+        std::span<std::byte const> slot,
+        params::LatticeLayout layout,
+        glm::ivec2 size,
+        uint64_t step) -> FieldSnapshot
+{
+    auto const cells = static_cast<size_t>(size.x) * static_cast<size_t>(size.y);
+
+    auto snapshot = FieldSnapshot{};
+    snapshot.step = step;
+    snapshot.width = size.x;
+    snapshot.height = size.y;
+    snapshot.velocityX.resize(cells);
+    snapshot.velocityY.resize(cells);
+    snapshot.density.resize(cells);
+
+    if(layout == params::LatticeLayout::AoS)
+    {
+        auto const* records = reinterpret_cast<GridCell const*>(slot.data());
+        for(size_t i = 0; i < cells; ++i)
+        {
+            snapshot.velocityX[i] = records[i].velocity.x;
+            snapshot.velocityY[i] = records[i].velocity.y;
+            snapshot.density[i] = records[i].density;
+        }
+    }
+    else
+    { // Planes in the order of common.glsl
+        auto const* planes = reinterpret_cast<float const*>(slot.data());
+        std::memcpy(snapshot.velocityX.data(), planes, cells * sizeof(float));
+        std::memcpy(snapshot.velocityY.data(), planes + cells, cells * sizeof(float));
+        std::memcpy(snapshot.density.data(), planes + 2 * cells, cells * sizeof(float));
+    }
+    return snapshot;
+}
+
+} // namespace app::simu
@@ -0,0 +1,44 @@
+#include "rocket/scheduler.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace app::simu
+{
+
+FrameScheduler::FrameScheduler(params::Params::SimulationConfig const& config)
+    : _steps(std::clamp(config.stepsPerFrame, 1u, maxSteps))
+    , _budget(config.frameBudgetMs * 1e-3f)
+    , _renderInterval(std::max(config.renderInterval, 1u))
+{
+}
+
+auto FrameScheduler::next(float frameTime) -> Frame
+{
+    if(_budget > 0.0f && frameTime > 0.0f)
+    {
+        // Proportional controller, the step is limited so a single slow frame (resize, hitch)
+        // does not collapse the step count
+        float const ratio = std::clamp(_budget / frameTime, 0.5f, 1.25f);
+        auto const steps = static_cast<uint32_t>(std::lround(static_cast<float>(_steps) * ratio));
+        // Always move by at least one step when off budget so small counts can grow
+        if(steps == _steps && ratio > 1.05f)
+        {
+            _steps += 1;
+        }
+        else
+        {
+            _steps = steps;
+        }
+        _steps = std::clamp(_steps, 1u, maxSteps);
+    }
+
+    auto frame = Frame{};
+    frame.steps = _steps;
+    frame.render = _frame % _renderInterval == 0;
+    _frame += 1;
+
+    return frame;
+}
+
+} // namespace app::simu
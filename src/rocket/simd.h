@@ -0,0 +1,75 @@
+#pragma once
+
+// Minimal vector wrappers for the CPU row kernels. Every variant exposes the same static
+// functions so the kernel is written once; each instruction set is compiled in its own
+// translation unit with matching compiler flags, so everything here has internal linkage: an
+// inline function merged across those units could hand AVX-512 code to the scalar path.
+
+#include <cmath>
+
+#if defined(__AVX2__) || defined(__AVX512F__)
+#include <immintrin.h>
+#endif
+
+namespace app::simu::cpu
+{
+namespace
+{
+
+struct ScalarLanes
+{
+    using Reg = float;
+    static constexpr int width = 1;
+
+    static auto load(float const* p) -> Reg { return *p; }
+    static auto store(float* p, Reg v) -> void { *p = v; }
+    static auto set(float v) -> Reg { return v; }
+    static auto add(Reg a, Reg b) -> Reg { return a + b; }
+    static auto sub(Reg a, Reg b) -> Reg { return a - b; }
+    static auto mul(Reg a, Reg b) -> Reg { return a * b; }
+    static auto div(Reg a, Reg b) -> Reg { return a / b; }
+    static auto sqrt(Reg a) -> Reg { return std::sqrt(a); }
+    static auto min(Reg a, Reg b) -> Reg { return b < a ? b : a; }
+    static auto max(Reg a, Reg b) -> Reg { return a < b ? b : a; }
+};
+
+#if defined(__AVX2__)
+struct Avx2Lanes
+{
+    using Reg = __m256;
+    static constexpr int width = 8;
+
+    static auto load(float const* p) -> Reg { return _mm256_loadu_ps(p); }
+    static auto store(float* p, Reg v) -> void { _mm256_storeu_ps(p, v); }
+    static auto set(float v) -> Reg { return _mm256_set1_ps(v); }
+    static auto add(Reg a, Reg b) -> Reg { return _mm256_add_ps(a, b); }
+    static auto sub(Reg a, Reg b) -> Reg { return _mm256_sub_ps(a, b); }
+    static auto mul(Reg a, Reg b) -> Reg { return _mm256_mul_ps(a, b); }
+    static auto div(Reg a, Reg b) -> Reg { return _mm256_div_ps(a, b); }
+    static auto sqrt(Reg a) -> Reg { return _mm256_sqrt_ps(a); }
+    static auto min(Reg a, Reg b) -> Reg { return _mm256_min_ps(a, b); }
+    static auto max(Reg a, Reg b) -> Reg { return _mm256_max_ps(a, b); }
+};
+#endif
+
+#if defined(__AVX512F__)
+struct Avx512Lanes
+{
+    using Reg = __m512;
+    static constexpr int width = 16;
+
+    static auto load(float const* p) -> Reg { return _mm512_loadu_ps(p); }
+    static auto store(float* p, Reg v) -> void { _mm512_storeu_ps(p, v); }
+    static auto set(float v) -> Reg { return _mm512_set1_ps(v); }
+    static auto add(Reg a, Reg b) -> Reg { return _mm512_add_ps(a, b); }
+    static auto sub(Reg a, Reg b) -> Reg { return _mm512_sub_ps(a, b); }
+    static auto mul(Reg a, Reg b) -> Reg { return _mm512_mul_ps(a, b); }
+    static auto div(Reg a, Reg b) -> Reg { return _mm512_div_ps(a, b); }
+    static auto sqrt(Reg a) -> Reg { return _mm512_sqrt_ps(a); }
+    static auto min(Reg a, Reg b) -> Reg { return _mm512_min_ps(a, b); }
+    static auto max(Reg a, Reg b) -> Reg { return _mm512_max_ps(a, b); }
+};
+#endif
+
+} // namespace
+} // namespace app::simu::cpu
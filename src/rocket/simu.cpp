@@ -1,26 +1,142 @@
 #include "rocket/simu.h"
 
+#include "rocket/flowstats.h"
 #include "utils/vkutils.h"
 
 #include "glm/glm.hpp"
 
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <fmt/core.h>
+#include <span>
+#include <stdexcept>
+
 namespace app::simu
 {
 
-Simu::Simu(vk::Device* device, uint32_t imageCount) : _device(device)
+namespace
+{
+// Modelled memory traffic of one cell update in bytes, counting each float read or written once:
+// 9 populations, velocity, density and the solid flag
+constexpr uint64_t collisionBytes = (13 + 9) * 4;
+constexpr uint64_t streamingBytes = (9 + 9) * 4;
+constexpr uint64_t boundaryBytes = 1 * 4;
+constexpr uint64_t macroBytes = (9 + 3) * 4;
+constexpr uint64_t fusedBytes = (13 + 12) * 4;
+constexpr uint64_t renderBytes = 4 * 4 + 4;
+
+// Headless batches in flight, the next one is recorded while the device runs the previous one
+constexpr uint32_t headlessBatches = 2;
+
+auto latticeSpecialization(params::Params::SimulationConfig const& config)
+        -> LatticeSpecialization
+{
+    auto constants = LatticeSpecialization{};
+    constants.workgroupWidth = config.workgroupWidth;
+    constants.workgroupHeight = config.workgroupHeight;
+    constants.gridWidth = config.gridWidth;
+    constants.gridHeight = config.gridHeight;
+    constants.tau = config.tau;
+    constants.collision = static_cast<int32_t>(config.collision);
+    constants.trtMagic = config.trtMagic;
+    constants.mrtBulkRate = config.mrtBulkRate;
+    constants.mrtFluxRate = config.mrtFluxRate;
+    constants.smagorinsky = config.smagorinsky;
+    constants.outputErrorBound = config.outputErrorBound;
+    return constants;
+}
+
+// Frame the compression passes wrote at the start of a readback slot
+auto quantizedFrame(std::span<std::byte const> slot) -> std::span<uint32_t const>
 {
+    auto header = QuantizedFrameHeader{};
+    std::memcpy(reinterpret_cast<char*>(&header), slot.data(), sizeof(header));
+    if(header.frameWords * sizeof(uint32_t) > slot.size())
+    {
+        throw std::runtime_error(fmt::format(
+                "Quantized frame of {} words overruns its readback slot", header.frameWords));
+    }
+    return {reinterpret_cast<uint32_t const*>(slot.data()), header.frameWords};
+}
+} // namespace
+
+Simu::Simu(
+        vk::Device* device,
+        uint32_t imageCount,
+        params::Params::SimulationConfig const& config)
+    : _log(logs::getLogger("Simu")), _device(device), _config(config)
+{
+    _grid.size = glm::ivec2(_config.gridWidth, _config.gridHeight);
     _descGen = std::make_shared<app::vk::DescriptorSetGenerator>(_device->getLogicalDevice());
+
+    // Read ahead of the outputs, which continue their files from its step
+    auto restart = std::optional<Checkpoint>{};
+    auto resumeStep = std::optional<uint64_t>{};
+    if(!_config.restartPath.empty())
+    {
+        restart = simu::readCheckpoint(_config.restartPath);
+        checkRestart(*restart);
+        resumeStep = restart->header.step;
+    }
+
     createUniformBuffers();
     createRenderTarget();
-    generateGrid();
+    createGrid();
+    createFieldOutput(resumeStep);
+    createFlowStatistics(resumeStep);
     AllocateCommandBuffer(imageCount);
     setupDescriptors(imageCount);
     createComputePipeline();
+    // The Stable Fluids init pass reads the grid size from the uniform buffer
     update(0.0f, 0.0f, 0);
+    initializeGrid();
+    if(restart)
+    {
+        restoreCheckpoint(*restart);
+    }
+    transferOwnership();
+
+    if(_config.checkpointInterval > 0)
+    {
+        createCheckpointReadback();
+        _checkpointStep = _grid.step;
+    }
+
+    if(_readback)
+    {
+        _outputStep = _grid.step;
+    }
+    if(_statistics)
+    {
+        _statisticsStep = _grid.step;
+    }
+
+    createProfiler();
 }
 
 Simu::~Simu()
 {
+    // Readbacks in flight read the grid buffer, the compression scratch and the partials, the
+    // checkpoint one hands its snapshot to the writer
+    _checkpointReadback.reset();
+    _readback.reset();
+    _outputScratch.clean();
+    _statistics.reset();
+    _statisticsPartials.clean();
+
+    if(_checkpointWriter)
+    { // The writer finishes the snapshot in flight, only its failure is reported here
+        try
+        {
+            _checkpointWriter->wait();
+        }
+        catch(std::runtime_error const& e)
+        {
+            _log->error("{}", e.what());
+        }
+    }
+
     _uniformBuffer.clean();
     _grid.buffers.clean();
 
@@ -34,10 +150,27 @@ Simu::~Simu()
         vkDestroyPipeline(_device->getLogicalDevice(), _compute.boundary, nullptr);
     if(_compute.macro)
         vkDestroyPipeline(_device->getLogicalDevice(), _compute.macro, nullptr);
+    if(_compute.fused)
+        vkDestroyPipeline(_device->getLogicalDevice(), _compute.fused, nullptr);
+    if(_compute.aa)
+        vkDestroyPipeline(_device->getLogicalDevice(), _compute.aa, nullptr);
+    if(_compute.init)
+        vkDestroyPipeline(_device->getLogicalDevice(), _compute.init, nullptr);
 
     if(_compute.render)
         vkDestroyPipeline(_device->getLogicalDevice(), _compute.render, nullptr);
 
+    if(_compute.compressQuantize)
+        vkDestroyPipeline(_device->getLogicalDevice(), _compute.compressQuantize, nullptr);
+    if(_compute.compressScan)
+        vkDestroyPipeline(_device->getLogicalDevice(), _compute.compressScan, nullptr);
+    if(_compute.compressPack)
+        vkDestroyPipeline(_device->getLogicalDevice(), _compute.compressPack, nullptr);
+    if(_compute.flowStats)
+        vkDestroyPipeline(_device->getLogicalDevice(), _compute.flowStats, nullptr);
+    if(_compute.flowStatsReduce)
+        vkDestroyPipeline(_device->getLogicalDevice(), _compute.flowStatsReduce, nullptr);
+
     if(_descriptors.layout)
         vkDestroyDescriptorSetLayout(_device->getLogicalDevice(), _descriptors.layout, nullptr);
 
@@ -45,87 +178,129 @@ Simu::~Simu()
         vkDestroyDescriptorPool(_device->getLogicalDevice(), _descriptors.pool, nullptr);
 }
 
-auto Simu::equilibriumDistribution(size_t i, float rho, glm::vec2 u) -> float
+auto Simu::modelledBytesPerCell(params::Params::SimulationConfig const& config) -> uint64_t
 {
-    float eu = glm::dot(ei.at(i), u);
-    float u2 = glm::dot(u, u);
+    if(config.engine == params::SolverEngine::StableFluids)
+    {
+        return StableFluids::modelledBytesPerCell(config);
+    }
 
-    return wi.at(i) * rho * (1.0f + 3.0f * eu + 4.5f * eu * eu - 1.5f * u2);
+    switch(config.kernel)
+    {
+    case params::SolverKernel::MultiPass:
+        return collisionBytes + streamingBytes + boundaryBytes + macroBytes;
+    case params::SolverKernel::Fused:
+    case params::SolverKernel::InPlaceAA: return fusedBytes;
+    }
+    return 0;
 }
 
-auto Simu::generateGrid() -> void
+auto Simu::latticeCount() const -> uint32_t
 {
-    // allocating size for TWO buffers (current and next) and one additional
-    // buffer for temporary memory space
-    auto count = _grid.size.x * _grid.size.y * 1;
-    auto sizeInBytes = count * sizeof(GridCell);
-    _grid.data.resize(count);
+    return _config.kernel == params::SolverKernel::InPlaceAA ? 1 : 2;
+}
 
-    glm::ivec2 cylinderCenter(_grid.size.x / 5 * 1, _grid.size.y / 2 * 1);
-    // glm::ivec2 cylinderCenter2(_grid.size.x / 5 * 1, _grid.size.y / 5 * 2);
-    // glm::ivec2 cylinderCenter3(_grid.size.x / 5 * 1, _grid.size.y / 5 * 3);
-    // glm::ivec2 cylinderCenter4(_grid.size.x / 5 * 1, _grid.size.y / 5 * 4);
-    float cylinderRadius = (float)_grid.size.y / 15.f;
+auto Simu::createGrid() -> void
+{
+    // Read and write lattices, or a single one for the in-place AA kernel
+    auto const lattices = latticeCount();
+    if(lattices == 1)
+    {
+        _grid.writeBufferIndex = _grid.readBufferIndex;
+    }
+
+    // Structure-of-arrays mirrors the plane order in common.glsl: velocity.x, velocity.y,
+    // density and solid flag followed by the nine population planes of each lattice
+    auto const cells = static_cast<VkDeviceSize>(_grid.size.x) * _grid.size.y;
+    auto sizeInBytes = _config.layout == params::LatticeLayout::AoS
+                               ? lattices * cells * sizeof(GridCell)
+                               : (4 + lattices * 9) * cells * sizeof(float);
+    // Checkpoints are copied out of and back into the lattice
+    auto usage = VkBufferUsageFlags{
+            VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT
+            | VK_BUFFER_USAGE_TRANSFER_DST_BIT};
+    if(isStableFluids())
+    { // The multigrid solver keeps its dispatch arguments next to the fields
+        sizeInBytes = StableFluids::bufferSize(_config);
+        usage |= VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT;
+    }
 
-    // Populate grid
-    for(int i = 0; i < _grid.size.y; ++i)
+    // Filled in place by init.comp, nothing is staged from the host
+    _grid.buffers = _device->createBuffer(
+            usage,
+            VMA_MEMORY_USAGE_GPU_ONLY,
+            VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+            sizeInBytes);
+}
+
+auto Simu::initializeGrid() -> void
+{
+    auto* buf = _device->createCommandBuffer(
+            VK_COMMAND_BUFFER_LEVEL_PRIMARY, VK_QUEUE_COMPUTE_BIT, true);
+
+    vkCmdBindDescriptorSets(
+            buf,
+            VK_PIPELINE_BIND_POINT_COMPUTE,
+            _compute.layout,
+            0,
+            1,
+            &_descriptors.sets.at(0),
+            0,
+            nullptr);
+
+    if(isStableFluids())
     {
-        for(int j = 0; j < _grid.size.x; ++j)
+        _fluids->recordInit(buf);
+    }
+    else
+    { // Both the read and the write lattice start from the same state
+        auto const groups = groupCount();
+        vkCmdBindPipeline(buf, VK_PIPELINE_BIND_POINT_COMPUTE, _compute.init);
+        uint32_t const N = _grid.size.x * _grid.size.y;
+        for(uint32_t i = 0; i < latticeCount(); ++i)
         {
-            auto& cell = _grid.data.at(i * _grid.size.x + j);
-            cell.velocity = glm::vec2(-0.001f, 0.0f);
-
-            {
-                glm::ivec2 cellPos(j, i);
-                glm::vec2 tmp = cellPos - cylinderCenter;
-                float distance = glm::length(tmp);
-                if(distance <= cylinderRadius)
-                {
-                    cell.isSolid = 1;
-                    // Use a smooth gradient for the density
-                    // cell.density = 2.0f * (1.0f - distance / cylinderRadius);
-                }
-            }
-
-            // {
-            //     glm::ivec2 cellPos(j, i);
-            //     glm::vec2 tmp = cellPos - cylinderCenter2;
-            //     float distance = glm::length(tmp);
-            //     if(distance <= cylinderRadius)
-            //     {
-            //         cell.isSolid = 1;
-            //     }
-            // }
-            // {
-            //     glm::ivec2 cellPos(j, i);
-            //     glm::vec2 tmp = cellPos - cylinderCenter3;
-            //     float distance = glm::length(tmp);
-            //     if(distance <= cylinderRadius)
-            //     {
-            //         cell.isSolid = 1;
-            //     }
-            // }
-            // {
-            //     glm::ivec2 cellPos(j, i);
-            //     glm::vec2 tmp = cellPos - cylinderCenter4;
-            //     float distance = glm::length(tmp);
-            //     if(distance <= cylinderRadius)
-            //     {
-            //         cell.isSolid = 1;
-            //     }
-            // }
-
-            cell.density = 1.f;
-
-            for(int k = 0; k < 9; ++k)
-            {
-                cell.distribution.at(k) = equilibriumDistribution(k, cell.density, cell.velocity);
-            }
+            auto pc = ComputePushConstant{};
+            pc.writeBufferOffset = i * N;
+            vkCmdPushConstants(
+                    buf,
+                    _compute.layout,
+                    VK_SHADER_STAGE_COMPUTE_BIT,
+                    0,
+                    sizeof(ComputePushConstant),
+                    &pc);
+            vkCmdDispatch(buf, groups.x, groups.y, 1);
         }
     }
 
-    _grid.buffers = _device->createBufferOnGPU(
-            VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, sizeInBytes, _grid.data.data());
+    auto barrierInfo = VkBufferMemoryBarrier{};
+    barrierInfo.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+    barrierInfo.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+    barrierInfo.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+    barrierInfo.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrierInfo.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrierInfo.buffer = _grid.buffers.buffer;
+    barrierInfo.offset = 0;
+    barrierInfo.size = VK_WHOLE_SIZE;
+    vkCmdPipelineBarrier(
+            buf,
+            VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+            VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+            0,
+            0,
+            nullptr,
+            1,
+            &barrierInfo,
+            0,
+            nullptr);
+
+    _device->flushCommandBuffer(buf, _device->getComputeQueue(), false);
+    vkFreeCommandBuffers(_device->getLogicalDevice(), _device->getComputeCommandPool(), 1, &buf);
+}
+
+auto Simu::latticeShaderPath(std::string const& name) const -> std::string
+{
+    auto const* suffix = _config.layout == params::LatticeLayout::SoA ? ".soa" : "";
+    return "data/shaders/" + name + suffix + ".comp.spv";
 }
 
 auto Simu::createUniformBuffers() -> void
@@ -160,11 +335,34 @@ auto Simu::createRenderTarget() -> void
 
 auto Simu::AllocateCommandBuffer(uint32_t count) -> void
 {
-    _compute.commandBuffers.resize(count);
-    for(uint32_t i = 0; i < count; ++i)
+    allocateStepBuffers(count);
+    for(auto& buf : _compute.renderBuffers)
+    {
+        buf = _device->createCommandBuffer(
+                VK_COMMAND_BUFFER_LEVEL_PRIMARY, VK_QUEUE_COMPUTE_BIT, false);
+    }
+}
+
+auto Simu::allocateStepBuffers(uint32_t count) -> void
+{
+    _compute.commandBuffers.resize(2 * count);
+    _compute.recorded.assign(2 * count, {});
+    for(uint32_t i = 0; i < 2 * count; ++i)
     {
         _compute.commandBuffers[i] = _device->createCommandBuffer(
-                VK_COMMAND_BUFFER_LEVEL_PRIMARY, VK_QUEUE_GRAPHICS_BIT, false);
+                VK_COMMAND_BUFFER_LEVEL_PRIMARY, VK_QUEUE_COMPUTE_BIT, false);
+    }
+}
+
+auto Simu::createProfiler() -> void
+{
+    if(_config.profile)
+    { // A scope per cached command buffer plus one per headless batch in flight
+        auto const cached = _compute.commandBuffers.size() + _compute.renderBuffers.size();
+        _profiler = std::make_unique<vk::GpuProfiler>(
+                _device,
+                _device->getComputeQueueFamily(),
+                static_cast<uint32_t>(cached + headlessBatches));
     }
 }
 
@@ -188,28 +386,76 @@ auto Simu::setupDescriptors(uint32_t count) -> void
             VK_DESCRIPTOR_TYPE_STORAGE_IMAGE,
             VK_SHADER_STAGE_COMPUTE_BIT);
 
+    if(compressesOutput())
+    {
+        _descGen->addBinding(
+                3, // binding
+                1,
+                VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+                VK_SHADER_STAGE_COMPUTE_BIT);
+
+        _descGen->addBinding(
+                4, // binding
+                1,
+                VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+                VK_SHADER_STAGE_COMPUTE_BIT);
+    }
+
+    if(_statistics)
+    {
+        _descGen->addBinding(
+                5, // binding
+                1,
+                VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+                VK_SHADER_STAGE_COMPUTE_BIT);
+
+        _descGen->addBinding(
+                6, // binding
+                1,
+                VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+                VK_SHADER_STAGE_COMPUTE_BIT);
+    }
+
     _descriptors.pool = _descGen->generatePool(100);
     _descriptors.layout = _descGen->generateLayout();
     _descriptors.sets.resize(count);
 
     for(auto& set : _descriptors.sets)
     {
-        set = _descGen->generateSet(_descriptors.pool, _descriptors.layout);
-        _descGen->bind(set, 0, {_uniformBuffer.info});
-        _descGen->bind(set, 1, {_grid.buffers.info});
-        _descGen->bind(set, 2, {_texture.getImageInfo()});
+        set = generateDescriptorSet();
     }
 
     _descGen->updateSetContents();
 }
 
+auto Simu::generateDescriptorSet() -> VkDescriptorSet
+{
+    auto set = _descGen->generateSet(_descriptors.pool, _descriptors.layout);
+    _descGen->bind(set, 0, {_uniformBuffer.info});
+    _descGen->bind(set, 1, {_grid.buffers.info});
+    _descGen->bind(set, 2, {_texture.getImageInfo()});
+    if(compressesOutput())
+    {
+        _descGen->bind(set, 3, {_outputScratch.info});
+        _descGen->bind(set, 4, {_readback->ring().info});
+    }
+    if(_statistics)
+    {
+        _descGen->bind(set, 5, {_statisticsPartials.info});
+        _descGen->bind(set, 6, {_statistics->ring().info});
+    }
+    return set;
+}
+
 auto Simu::createComputePipeline() -> void
 {
 
     VkPushConstantRange pushConstantRange = {};
     pushConstantRange.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
     pushConstantRange.offset = 0;
-    pushConstantRange.size = sizeof(ComputePushConstant);
+    // Shared by both engines, each pushes its own block
+    pushConstantRange.size = static_cast<uint32_t>(
+            std::max(sizeof(ComputePushConstant), sizeof(FluidPushConstant)));
 
     VkPipelineLayoutCreateInfo layoutInfo = {};
     layoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
@@ -223,6 +469,40 @@ auto Simu::createComputePipeline() -> void
     VK_CHECK(vkCreatePipelineLayout(
             _device->getLogicalDevice(), &layoutInfo, nullptr, &_compute.layout));
 
+    if(isStableFluids())
+    {
+        _fluids = std::make_unique<StableFluids>(
+                _device, _compute.layout, _grid.buffers.buffer, _config);
+        return;
+    }
+
+    auto const& limits = _device->getProperties().limits;
+    if(_config.workgroupWidth > limits.maxComputeWorkGroupSize[0]
+       || _config.workgroupHeight > limits.maxComputeWorkGroupSize[1]
+       || _config.workgroupWidth * _config.workgroupHeight
+                  > limits.maxComputeWorkGroupInvocations)
+    {
+        throw std::runtime_error(fmt::format(
+                "Workgroup {}x{} exceeds the device limits",
+                _config.workgroupWidth,
+                _config.workgroupHeight));
+    }
+
+    // Every lattice shader takes the same constants, a shader ignores those it does not declare
+    auto const constants = latticeSpecialization(_config);
+    auto entries = std::array<VkSpecializationMapEntry, sizeof(constants) / sizeof(uint32_t)>{};
+    for(uint32_t id = 0; id < entries.size(); ++id)
+    {
+        entries[id].constantID = id;
+        entries[id].offset = id * sizeof(uint32_t);
+        entries[id].size = sizeof(uint32_t);
+    }
+    auto specialization = VkSpecializationInfo{};
+    specialization.mapEntryCount = static_cast<uint32_t>(entries.size());
+    specialization.pMapEntries = entries.data();
+    specialization.dataSize = sizeof(constants);
+    specialization.pData = &constants;
+
     VkComputePipelineCreateInfo pipelineInfo = {};
     pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
     pipelineInfo.pNext = nullptr;
@@ -232,21 +512,44 @@ auto Simu::createComputePipeline() -> void
     pipelineInfo.basePipelineIndex = 0;
 
     auto addPipeline = [&](std::string const& shaderName, VkPipeline& pipeline) {
-        auto shaderInfo = _device->loadShaderFromFile(shaderName, VK_SHADER_STAGE_COMPUTE_BIT);
+        auto shaderInfo = _device->loadShaderFromFile(
+                shaderName, VK_SHADER_STAGE_COMPUTE_BIT, &specialization);
 
         pipelineInfo.stage = shaderInfo;
         VK_CHECK(vkCreateComputePipelines(
-                _device->getLogicalDevice(), VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &pipeline));
+                _device->getLogicalDevice(),
+                _device->getPipelineCache(),
+                1,
+                &pipelineInfo,
+                nullptr,
+                &pipeline));
 
         vkDestroyShaderModule(_device->getLogicalDevice(), shaderInfo.module, nullptr);
     };
 
-    addPipeline("data/shaders/collision.comp.spv", _compute.collision);
-    addPipeline("data/shaders/streaming.comp.spv", _compute.streaming);
-    addPipeline("data/shaders/boundary.comp.spv", _compute.boundary);
-    addPipeline("data/shaders/macro.comp.spv", _compute.macro);
+    addPipeline(latticeShaderPath("collision"), _compute.collision);
+    addPipeline(latticeShaderPath("streaming"), _compute.streaming);
+    addPipeline(latticeShaderPath("boundary"), _compute.boundary);
+    addPipeline(latticeShaderPath("macro"), _compute.macro);
+    addPipeline(latticeShaderPath("lbm_fused"), _compute.fused);
+    addPipeline(latticeShaderPath("lbm_aa"), _compute.aa);
+    addPipeline(latticeShaderPath("init"), _compute.init);
+
+    addPipeline(latticeShaderPath("cfd_render"), _compute.render);
 
-    addPipeline("data/shaders/cfd_render.comp.spv", _compute.render);
+    if(compressesOutput())
+    {
+        addPipeline(latticeShaderPath("compress_quantize"), _compute.compressQuantize);
+        addPipeline(latticeShaderPath("compress_scan"), _compute.compressScan);
+        addPipeline(latticeShaderPath("compress_pack"), _compute.compressPack);
+    }
+
+    if(_statistics)
+    {
+        vk::utils::requireSubgroupArithmetic(_device->getPhysicalDevice(), "Flow statistics");
+        addPipeline(latticeShaderPath("flow_stats"), _compute.flowStats);
+        addPipeline(latticeShaderPath("flow_stats_reduce"), _compute.flowStatsReduce);
+    }
 }
 
 auto Simu::update(float time, float elapsed, uint32_t index) -> void
@@ -264,35 +567,42 @@ auto Simu::getRenderImageInfo() -> VkDescriptorImageInfo
     return _texture.getImageInfo();
 }
 
-auto Simu::recordCommandBuffer(uint32_t index) -> VkCommandBuffer
+auto Simu::groupCount() const -> glm::uvec2
 {
-    VkCommandBufferBeginInfo beginInfo = {};
-    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
-    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_SIMULTANEOUS_USE_BIT;
+    auto const width = _config.workgroupWidth;
+    auto const height = _config.workgroupHeight;
+    return glm::uvec2((_grid.size.x + width - 1) / width, (_grid.size.y + height - 1) / height);
+}
 
+auto Simu::recordSteps(VkCommandBuffer buf, uint32_t steps, uint32_t scope) -> void
+{
     auto barrierInfo = VkBufferMemoryBarrier{};
     barrierInfo.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
     barrierInfo.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
-    barrierInfo.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+    // In-place passes write what the previous dispatch wrote as well
+    barrierInfo.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
     barrierInfo.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
     barrierInfo.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
     barrierInfo.buffer = _grid.buffers.buffer;
     barrierInfo.offset = 0;
     barrierInfo.size = VK_WHOLE_SIZE;
 
-    uint32_t N = _grid.size.x * _grid.size.y;
-    static auto pc = ComputePushConstant{.readBufferOffset = 0, .writeBufferOffset = 0};
-    static bool toggle = true;
+    uint32_t const N = _grid.size.x * _grid.size.y;
+    auto pc = ComputePushConstant{};
 
-    auto swap = [&]() {
-        // pc.readBufferOffset = toggle ? 0 : N;
-        // pc.writeBufferOffset = toggle ? N : 0;
-        pc.readBufferOffset = 0;
-        pc.writeBufferOffset = 0;
-        toggle = !toggle;
+    // Offsets of the lattices, in cells. A pass may read and write the same lattice when it
+    // only touches its own cell.
+    auto inPlace = [&]() {
+        pc.readBufferOffset = _grid.readBufferIndex * N;
+        pc.writeBufferOffset = _grid.readBufferIndex * N;
     };
+    auto pingPong = [&]() {
+        pc.readBufferOffset = _grid.readBufferIndex * N;
+        pc.writeBufferOffset = _grid.writeBufferIndex * N;
+    };
+    auto swap = [&]() { std::swap(_grid.readBufferIndex, _grid.writeBufferIndex); };
 
-    auto barrier = [&](VkCommandBuffer buf) {
+    auto barrier = [&]() {
         vkCmdPipelineBarrier(
                 buf,
                 VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
@@ -306,7 +616,21 @@ auto Simu::recordCommandBuffer(uint32_t index) -> VkCommandBuffer
                 nullptr);
     };
 
-    auto pushConstants = [&](VkCommandBuffer buf) {
+    // Only the passes of the first step are timed individually, the whole batch is one span
+    bool profilePasses = true;
+    uint64_t stepBytes = 0;
+
+    auto mark = [&](char const* name, uint64_t bytesPerCell) {
+        if(_profiler && profilePasses)
+        {
+            _profiler->mark(buf, scope, name, N, bytesPerCell);
+            stepBytes += bytesPerCell;
+        }
+    };
+
+    auto const groups = groupCount();
+    auto dispatch = [&](VkPipeline pipeline, char const* name, uint64_t bytesPerCell) {
+        vkCmdBindPipeline(buf, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline);
         vkCmdPushConstants(
                 buf,
                 _compute.layout,
@@ -314,14 +638,155 @@ auto Simu::recordCommandBuffer(uint32_t index) -> VkCommandBuffer
                 0,
                 sizeof(ComputePushConstant),
                 &pc);
+        vkCmdDispatch(buf, groups.x, groups.y, 1);
+        barrier();
+        mark(name, bytesPerCell);
     };
 
-    uint32_t const workgroupSizeX = 16;
-    uint32_t const workgroupSizeY = 16;
-    uint32_t const numGroupsX = (_grid.size.x + workgroupSizeX - 1) / workgroupSizeX;
-    uint32_t const numGroupsY = (_grid.size.y + workgroupSizeY - 1) / workgroupSizeY;
+    if(_profiler)
+    {
+        _profiler->begin(buf, scope);
+    }
+
+    // Previous submission wrote the lattice we are about to read
+    barrier();
+
+    for(uint32_t i = 0; i < steps; ++i)
+    {
+        if(isStableFluids())
+        { // Passes are timed per stage, the iterations of a stage share one timestamp
+            _fluids->recordStep(buf, mark);
+        }
+        else if(_config.kernel == params::SolverKernel::InPlaceAA)
+        { // Even and odd steps alternate over the single lattice
+            inPlace();
+            pc.parity = _grid.parity;
+            dispatch(_compute.aa, "aa", fusedBytes);
+            _grid.parity ^= 1u;
+        }
+        else if(_config.kernel == params::SolverKernel::Fused)
+        { // Stream, boundary, macro and collision
+            pingPong();
+            dispatch(_compute.fused, "fused", fusedBytes);
+            swap();
+        }
+        else
+        {
+            inPlace();
+            dispatch(_compute.collision, "collision", collisionBytes);
+            pingPong();
+            dispatch(_compute.streaming, "streaming", streamingBytes);
+            swap();
+            inPlace();
+            dispatch(_compute.boundary, "boundary", boundaryBytes);
+            inPlace();
+            dispatch(_compute.macro, "macro", macroBytes);
+        }
+
+        profilePasses = false;
+    }
+
+    if(_profiler)
+    {
+        _profiler->span(buf, scope, "step", uint64_t{N} * steps, stepBytes);
+    }
+}
+
+auto Simu::phase() const -> uint32_t
+{
+    if(isStableFluids())
+    { // Every step starts and ends in the same slots
+        return 0;
+    }
+    return _config.kernel == params::SolverKernel::InPlaceAA ? _grid.parity
+                                                              : _grid.readBufferIndex;
+}
+
+auto Simu::advance(uint32_t steps) -> void
+{
+    if(steps % 2 == 0 || isStableFluids())
+    {
+        return;
+    }
+
+    if(_config.kernel == params::SolverKernel::InPlaceAA)
+    {
+        _grid.parity ^= 1u;
+    }
+    else
+    {
+        std::swap(_grid.readBufferIndex, _grid.writeBufferIndex);
+    }
+}
+
+auto Simu::invalidateCommandBuffers(uint32_t imageCount) -> void
+{
+    for(auto& recorded : _compute.recorded)
+    {
+        recorded.valid = false;
+    }
+    for(auto& buf : _compute.renderBuffers)
+    {
+        VK_CHECK(vkResetCommandBuffer(buf, 0));
+    }
+    _compute.renderRecorded = {};
+
+    if(_compute.commandBuffers.size() == 2 * imageCount)
+    {
+        return;
+    }
+
+    vkFreeCommandBuffers(
+            _device->getLogicalDevice(),
+            _device->getComputeCommandPool(),
+            static_cast<uint32_t>(_compute.commandBuffers.size()),
+            _compute.commandBuffers.data());
+    allocateStepBuffers(imageCount);
 
-    auto* buf = _compute.commandBuffers.at(index);
+    if(_descriptors.sets.size() < imageCount)
+    { // Every set holds the same resources
+        while(_descriptors.sets.size() < imageCount)
+        {
+            _descriptors.sets.push_back(generateDescriptorSet());
+        }
+        _descGen->updateSetContents();
+    }
+
+    // Profiler scopes follow the command buffers, the timings gathered so far are reported
+    if(_profiler)
+    {
+        reportProfile();
+        _profiler.reset();
+        createProfiler();
+    }
+}
+
+auto Simu::recordCommandBuffer(uint32_t index, uint32_t steps) -> VkCommandBuffer
+{
+    // The recorded offsets and parities depend on the state the lattice starts from
+    auto const slot = 2 * index + phase();
+    auto* buf = _compute.commandBuffers.at(slot);
+    auto& recorded = _compute.recorded.at(slot);
+
+    // The previous submission of this buffer has completed
+    if(_profiler)
+    {
+        _profiler->resolve(slot);
+        _profiler->submitted(slot);
+    }
+
+    _grid.step += steps;
+    if(recorded.valid && recorded.steps == steps)
+    {
+        advance(steps);
+        return buf;
+    }
+
+    recorded = {steps, true};
+
+    VkCommandBufferBeginInfo beginInfo = {};
+    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_SIMULTANEOUS_USE_BIT;
 
     VK_CHECK(vkResetCommandBuffer(buf, 0));
     VK_CHECK(vkBeginCommandBuffer(buf, &beginInfo));
@@ -336,48 +801,758 @@ auto Simu::recordCommandBuffer(uint32_t index) -> VkCommandBuffer
             0,
             nullptr);
 
-    for(int i = 0; i < 4; ++i)
+    recordSteps(buf, steps, slot);
+
+    VK_CHECK(vkEndCommandBuffer(buf));
+
+    return buf;
+}
+
+auto Simu::renderCommandBuffer(bool render) -> VkCommandBuffer
+{
+    // One buffer per lattice phase that renders, and one that only hands the image over
+    auto const slot = render ? phase() : 2;
+    auto* buf = _compute.renderBuffers.at(slot);
+    auto const scope = static_cast<uint32_t>(_compute.commandBuffers.size()) + slot;
+
+    // Render buffers are resubmitted once the graphics queue released the image, which
+    // happens after the previous submission completed
+    if(_profiler)
     {
-        { // Collision
-            vkCmdBindPipeline(buf, VK_PIPELINE_BIND_POINT_COMPUTE, _compute.collision);
-            pushConstants(buf);
-            vkCmdDispatch(buf, numGroupsX, numGroupsY, 1);
-            barrier(buf);
-            swap();
-        }
-        { // Streaming
-            vkCmdBindPipeline(buf, VK_PIPELINE_BIND_POINT_COMPUTE, _compute.streaming);
-            pushConstants(buf);
-            vkCmdDispatch(buf, numGroupsX, numGroupsY, 1);
-            barrier(buf);
-            swap();
+        _profiler->resolve(scope);
+        _profiler->submitted(scope);
+    }
+
+    if(_compute.renderRecorded.at(slot))
+    {
+        return buf;
+    }
+
+    VkCommandBufferBeginInfo beginInfo = {};
+    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_SIMULTANEOUS_USE_BIT;
+
+    VK_CHECK(vkBeginCommandBuffer(buf, &beginInfo));
+
+    // Acquire from graphics, the wait on the graphics timeline happens in COMPUTE_SHADER stage
+    renderImageBarrier(
+            buf,
+            _device->getGraphicsQueueFamily(),
+            _device->getComputeQueueFamily(),
+            VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+            VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+            0,
+            VK_ACCESS_SHADER_WRITE_BIT);
+
+    if(_profiler)
+    {
+        _profiler->begin(buf, scope);
+    }
+
+    if(render)
+    {
+        uint32_t const N = _grid.size.x * _grid.size.y;
+        auto pc = ComputePushConstant{};
+        pc.readBufferOffset = _grid.readBufferIndex * N;
+        pc.writeBufferOffset = _grid.readBufferIndex * N;
+
+        vkCmdBindDescriptorSets(
+                buf,
+                VK_PIPELINE_BIND_POINT_COMPUTE,
+                _compute.layout,
+                0,
+                1,
+                &_descriptors.sets.at(0),
+                0,
+                nullptr);
+
+        if(isStableFluids())
+        {
+            _fluids->recordRender(buf);
         }
-        { // Boundary
-            vkCmdBindPipeline(buf, VK_PIPELINE_BIND_POINT_COMPUTE, _compute.boundary);
-            pushConstants(buf);
-            vkCmdDispatch(buf, numGroupsX, numGroupsY, 1);
-            barrier(buf);
-            swap();
+        else
+        {
+            auto const groups = groupCount();
+            vkCmdBindPipeline(buf, VK_PIPELINE_BIND_POINT_COMPUTE, _compute.render);
+            vkCmdPushConstants(
+                    buf,
+                    _compute.layout,
+                    VK_SHADER_STAGE_COMPUTE_BIT,
+                    0,
+                    sizeof(ComputePushConstant),
+                    &pc);
+            vkCmdDispatch(buf, groups.x, groups.y, 1);
         }
-        { // Macro
-            vkCmdBindPipeline(buf, VK_PIPELINE_BIND_POINT_COMPUTE, _compute.macro);
-            pushConstants(buf);
-            vkCmdDispatch(buf, numGroupsX, numGroupsY, 1);
-            barrier(buf);
-            swap();
+
+        if(_profiler)
+        {
+            _profiler->mark(buf, scope, "render", N, renderBytes);
         }
     }
 
-    // Render !!
-    vkCmdBindPipeline(buf, VK_PIPELINE_BIND_POINT_COMPUTE, _compute.render);
-    vkCmdPushConstants(
-            buf, _compute.layout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(ComputePushConstant), &pc);
-
-    vkCmdDispatch(buf, numGroupsX, numGroupsY, 1);
+    // Release to graphics
+    renderImageBarrier(
+            buf,
+            _device->getComputeQueueFamily(),
+            _device->getGraphicsQueueFamily(),
+            VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+            VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
+            VK_ACCESS_SHADER_WRITE_BIT,
+            0);
 
     VK_CHECK(vkEndCommandBuffer(buf));
+    _compute.renderRecorded.at(slot) = true;
 
     return buf;
 }
 
+auto Simu::acquireRenderImage(VkCommandBuffer buf) -> void
+{
+    // Pairs with the release in renderCommandBuffer, waited on in FRAGMENT_SHADER stage
+    renderImageBarrier(
+            buf,
+            _device->getComputeQueueFamily(),
+            _device->getGraphicsQueueFamily(),
+            VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+            VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+            0,
+            VK_ACCESS_SHADER_READ_BIT);
+}
+
+auto Simu::releaseRenderImage(VkCommandBuffer buf) -> void
+{
+    renderImageBarrier(
+            buf,
+            _device->getGraphicsQueueFamily(),
+            _device->getComputeQueueFamily(),
+            VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+            VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
+            0,
+            0);
+}
+
+auto Simu::renderImageBarrier(
+        VkCommandBuffer buf,
+        uint32_t srcQueueFamily,
+        uint32_t dstQueueFamily,
+        VkPipelineStageFlags srcStage,
+        VkPipelineStageFlags dstStage,
+        VkAccessFlags srcAccess,
+        VkAccessFlags dstAccess) -> void
+{
+    // Plain execution and memory dependency when both queues share a family
+    if(srcQueueFamily == dstQueueFamily)
+    {
+        srcQueueFamily = VK_QUEUE_FAMILY_IGNORED;
+        dstQueueFamily = VK_QUEUE_FAMILY_IGNORED;
+    }
+
+    auto barrier = VkImageMemoryBarrier{};
+    barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+    barrier.srcAccessMask = srcAccess;
+    barrier.dstAccessMask = dstAccess;
+    barrier.oldLayout = _texture.layout;
+    barrier.newLayout = _texture.layout;
+    barrier.srcQueueFamilyIndex = srcQueueFamily;
+    barrier.dstQueueFamilyIndex = dstQueueFamily;
+    barrier.image = _texture.image;
+    barrier.subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1};
+
+    vkCmdPipelineBarrier(buf, srcStage, dstStage, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+}
+
+auto Simu::transferOwnership() -> void
+{
+    // The render image is created on the graphics queue and then used from the compute queue.
+    // The grid never leaves the compute queue.
+    auto const compute = _device->getComputeQueueFamily();
+    auto const graphics = _device->getGraphicsQueueFamily();
+
+    if(graphics != compute)
+    { // The first renderCommandBuffer acquires it
+        auto* release = _device->createCommandBuffer(
+                VK_COMMAND_BUFFER_LEVEL_PRIMARY, VK_QUEUE_GRAPHICS_BIT, true);
+        releaseRenderImage(release);
+        _device->flushCommandBuffer(release, _device->getGraphicsQueue(), true);
+    }
+}
+
+auto Simu::simulate(uint64_t steps) -> void
+{
+    // Steps recorded into a single submission, large enough to hide the recording cost
+    uint64_t const batchSize = 256;
+
+    VkFenceCreateInfo fenceInfo = {};
+    fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+    fenceInfo.flags = 0;
+
+    struct Batch
+    {
+        VkCommandBuffer buf = VK_NULL_HANDLE;
+        VkFence fence = VK_NULL_HANDLE;
+        bool pending = false;
+    };
+    auto batches = std::array<Batch, headlessBatches>{};
+    for(auto& batch : batches)
+    {
+        batch.buf = _device->createCommandBuffer(
+                VK_COMMAND_BUFFER_LEVEL_PRIMARY, VK_QUEUE_COMPUTE_BIT, false);
+        VK_CHECK(vkCreateFence(_device->getLogicalDevice(), &fenceInfo, nullptr, &batch.fence));
+    }
+
+    auto const firstScope =
+            static_cast<uint32_t>(_compute.commandBuffers.size() + _compute.renderBuffers.size());
+
+    // Only a buffer about to be reused is waited for, its results are resolved before its
+    // profiler scope is recorded again
+    auto complete = [&](uint32_t index) {
+        auto& batch = batches[index];
+        if(!batch.pending)
+        {
+            return;
+        }
+        VK_CHECK(vkWaitForFences(
+                _device->getLogicalDevice(), 1, &batch.fence, VK_TRUE, UINT64_MAX));
+        VK_CHECK(vkResetFences(_device->getLogicalDevice(), 1, &batch.fence));
+        batch.pending = false;
+        if(_profiler)
+        {
+            _profiler->resolve(firstScope + index);
+        }
+    };
+
+    uint32_t next = 0;
+    for(uint64_t done = 0; done < steps;)
+    {
+        auto const count = static_cast<uint32_t>(std::min(batchSize, steps - done));
+        auto const scope = firstScope + next;
+        complete(next);
+        auto& batch = batches[next];
+
+        _device->beginCommandBuffer(batch.buf, VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT);
+        vkCmdBindDescriptorSets(
+                batch.buf,
+                VK_PIPELINE_BIND_POINT_COMPUTE,
+                _compute.layout,
+                0,
+                1,
+                &_descriptors.sets.at(0),
+                0,
+                nullptr);
+        recordSteps(batch.buf, count, scope);
+        VK_CHECK(vkEndCommandBuffer(batch.buf));
+
+        VkSubmitInfo submitInfo = {};
+        submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+        submitInfo.commandBufferCount = 1;
+        submitInfo.pCommandBuffers = &batch.buf;
+
+        VK_CHECK(vkQueueSubmit(_device->getComputeQueue(), 1, &submitInfo, batch.fence));
+        batch.pending = true;
+        if(_profiler)
+        {
+            _profiler->submitted(scope);
+        }
+
+        // Readbacks and checkpoints are queued behind the batch and see its state
+        done += count;
+        _grid.step += count;
+        checkpointIfDue();
+        outputIfDue();
+        statisticsIfDue();
+
+        next = (next + 1) % headlessBatches;
+    }
+
+    for(uint32_t i = 0; i < headlessBatches; ++i)
+    {
+        complete(i);
+        vkDestroyFence(_device->getLogicalDevice(), batches[i].fence, nullptr);
+        vkFreeCommandBuffers(
+                _device->getLogicalDevice(),
+                _device->getComputeCommandPool(),
+                1,
+                &batches[i].buf);
+    }
+
+    reportProfile();
+}
+
+auto Simu::reportProfile() -> void
+{
+    if(_profiler)
+    {
+        _profiler->report(_config.profileOutput);
+    }
+}
+
+auto Simu::checkpointRegions() const -> std::vector<VkBufferCopy>
+{
+    auto const cells = static_cast<VkDeviceSize>(_grid.size.x) * _grid.size.y;
+    if(_config.layout == params::LatticeLayout::AoS)
+    { // The cell records of the current lattice carry the macroscopic fields
+        auto const bytes = cells * sizeof(GridCell);
+        return {VkBufferCopy{_grid.readBufferIndex * bytes, 0, bytes}};
+    }
+
+    // The four macroscopic planes and the nine population planes of the current lattice
+    auto const plane = cells * sizeof(float);
+    return {VkBufferCopy{0, 0, 4 * plane},
+            VkBufferCopy{(4 + 9 * _grid.readBufferIndex) * plane, 4 * plane, 9 * plane}};
+}
+
+auto Simu::createCheckpointReadback() -> void
+{
+    auto const regions = checkpointRegions();
+    auto const payloadBytes = regions.back().dstOffset + regions.back().size;
+
+    // A single slot, a checkpoint due while the previous one is still copied waits for the next
+    // interval
+    _checkpointWriter = std::make_unique<CheckpointWriter>(_config.checkpointPath);
+    _checkpointReadback = std::make_unique<FieldReadback>(_device, payloadBytes, 1);
+    _checkpointReadback->addConsumer(
+            [this, payloadBytes](uint64_t step, std::span<std::byte const> slot) {
+                // Written by the fill, which only runs once the previous consumer returned
+                auto checkpoint = Checkpoint{};
+                checkpoint.header = _checkpointHeader;
+                checkpoint.header.step = step;
+                auto const payload = slot.first(payloadBytes);
+                checkpoint.payload.assign(payload.begin(), payload.end());
+                // Blocks this thread, not the solver, while the previous file is written
+                _checkpointWriter->submit(std::move(checkpoint));
+            });
+}
+
+auto Simu::recordCheckpointCopy(VkCommandBuffer buf, VkDeviceSize offset) -> void
+{
+    _checkpointHeader = CheckpointHeader{};
+    _checkpointHeader.width = _grid.size.x;
+    _checkpointHeader.height = _grid.size.y;
+    _checkpointHeader.layout = static_cast<uint32_t>(_config.layout);
+    _checkpointHeader.kernel = static_cast<uint32_t>(_config.kernel);
+    _checkpointHeader.parity = _grid.parity;
+    _checkpointHeader.tau = _config.tau;
+
+    auto regions = checkpointRegions();
+    for(auto& region : regions)
+    {
+        region.dstOffset += offset;
+    }
+
+    // Steps submitted earlier wrote the lattice
+    vk::utils::bufferBarrier(
+            buf,
+            _grid.buffers.buffer,
+            VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+            VK_ACCESS_SHADER_WRITE_BIT,
+            VK_PIPELINE_STAGE_TRANSFER_BIT,
+            VK_ACCESS_TRANSFER_READ_BIT);
+    vkCmdCopyBuffer(
+            buf,
+            _grid.buffers.buffer,
+            _checkpointReadback->ring().buffer,
+            static_cast<uint32_t>(regions.size()),
+            regions.data());
+}
+
+auto Simu::checkpointIfDue() -> void
+{
+    if(!_checkpointReadback || _grid.step < _checkpointStep + _config.checkpointInterval)
+    {
+        return;
+    }
+
+    auto const queued = _checkpointReadback->submit(
+            _grid.step, [this](VkCommandBuffer buf, VkDeviceSize offset) {
+                recordCheckpointCopy(buf, offset);
+            });
+    if(queued)
+    {
+        _checkpointStep = _grid.step;
+    }
+}
+
+auto Simu::outputIfDue() -> void
+{
+    if(!_readback || _grid.step < _outputStep + _config.outputInterval)
+    {
+        return;
+    }
+
+    _outputStep = _grid.step;
+    _readback->submit(_grid.step, [this](VkCommandBuffer buf, VkDeviceSize offset) {
+        if(compressesOutput())
+        {
+            recordFieldCompression(buf, offset);
+        }
+        else
+        {
+            recordFieldCopy(buf, offset);
+        }
+    });
+}
+
+auto Simu::createFieldOutput(std::optional<uint64_t> resumeStep) -> void
+{
+    if(_config.outputInterval == 0)
+    {
+        return;
+    }
+
+    auto const size = _grid.size;
+    auto const csvPath = _config.outputCsv;
+    auto series = std::shared_ptr<FieldSeriesWriter>{};
+    if(!_config.outputSeries.empty())
+    { // Shared with the consumer, which runs on the readback thread
+        auto encoding = FieldEncoding::Half;
+        if(_config.outputPrecision == params::OutputPrecision::Float)
+        {
+            encoding = FieldEncoding::Float;
+        }
+        else if(_config.outputPrecision == params::OutputPrecision::Quantized)
+        {
+            encoding = FieldEncoding::Quantized;
+        }
+        series = std::make_shared<FieldSeriesWriter>(
+                _config.outputSeries, size.x, size.y, encoding, resumeStep);
+    }
+
+    if(!compressesOutput())
+    {
+        auto const layout = _config.layout;
+        _readback = std::make_unique<FieldReadback>(
+                _device, fieldCopyBytes(layout, size), _config.outputSlots);
+        _readback->addConsumer(
+                [series, csvPath, layout, size](uint64_t step, std::span<std::byte const> slot) {
+                    auto const snapshot = unpackFieldCopy(slot, layout, size, step);
+                    if(series)
+                    {
+                        series->append(snapshot);
+                    }
+                    if(!csvPath.empty())
+                    {
+                        writeFieldCsv(csvPath, snapshot);
+                    }
+                });
+        return;
+    }
+
+    // A slot fits the frame of tiles that do not compress at all
+    auto const groups = groupCount();
+    auto const entries = VkDeviceSize{QuantizedFrameHeader::planes} * groups.x * groups.y;
+    auto const tileCells = VkDeviceSize{_config.workgroupWidth} * _config.workgroupHeight;
+    auto const frameBytes = sizeof(QuantizedFrameHeader)
+                            + entries * (sizeof(QuantizedTile) + tileCells * sizeof(uint32_t));
+    _readback = std::make_unique<FieldReadback>(_device, frameBytes, _config.outputSlots);
+    _outputScratch = _device->createBuffer(
+            VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+            VMA_MEMORY_USAGE_GPU_ONLY,
+            VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+            entries * (tileCells + 5) * sizeof(uint32_t));
+
+    auto const rawBytes = 3 * static_cast<uint64_t>(size.x) * static_cast<uint64_t>(size.y)
+                          * sizeof(float);
+    _readback->addConsumer([log = _log, series, csvPath, size, rawBytes](
+                                   uint64_t step, std::span<std::byte const> slot) {
+        auto const frame = quantizedFrame(slot);
+        auto header = QuantizedFrameHeader{};
+        std::memcpy(reinterpret_cast<char*>(&header), frame.data(), sizeof(header));
+        log->info(
+                "Fields of step {}: {} bytes, {:.1f}x smaller, max error {:.3g} {:.3g} {:.3g} "
+                "(bound {:.3g})",
+                step,
+                frame.size_bytes(),
+                static_cast<double>(rawBytes) / static_cast<double>(frame.size_bytes()),
+                header.maxError[0],
+                header.maxError[1],
+                header.maxError[2],
+                header.errorBound);
+
+        if(series)
+        {
+            series->append(step, frame);
+        }
+        if(!csvPath.empty())
+        {
+            writeFieldCsv(csvPath, dequantizeFields(frame, size.x, size.y, step));
+        }
+    });
+}
+
+auto Simu::recordFieldCopy(VkCommandBuffer buf, VkDeviceSize offset) -> void
+{
+    auto const bytes = fieldCopyBytes(_config.layout, _grid.size);
+    auto region = VkBufferCopy{0, offset, bytes};
+    if(_config.layout == params::LatticeLayout::AoS)
+    { // Cell records of the current lattice
+        region.srcOffset = _grid.readBufferIndex * bytes;
+    }
+
+    // Steps submitted earlier wrote the fields
+    vk::utils::bufferBarrier(
+            buf,
+            _grid.buffers.buffer,
+            VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+            VK_ACCESS_SHADER_WRITE_BIT,
+            VK_PIPELINE_STAGE_TRANSFER_BIT,
+            VK_ACCESS_TRANSFER_READ_BIT);
+    vkCmdCopyBuffer(buf, _grid.buffers.buffer, _readback->ring().buffer, 1, &region);
+}
+
+auto Simu::recordFieldCompression(VkCommandBuffer buf, VkDeviceSize offset) -> void
+{
+    // The size of a frame is only known on the device, so the pack pass writes it to the mapped
+    // ring itself instead of a copy of fixed size
+    auto pc = ComputePushConstant{};
+    pc.readBufferOffset = _grid.readBufferIndex * _grid.size.x * _grid.size.y;
+    pc.outputOffset = static_cast<uint32_t>(offset / sizeof(uint32_t));
+
+    vkCmdBindDescriptorSets(
+            buf,
+            VK_PIPELINE_BIND_POINT_COMPUTE,
+            _compute.layout,
+            0,
+            1,
+            &_descriptors.sets.at(0),
+            0,
+            nullptr);
+
+    auto dispatch = [&](VkPipeline pipeline, glm::uvec2 groups) {
+        vkCmdBindPipeline(buf, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline);
+        vkCmdPushConstants(
+                buf,
+                _compute.layout,
+                VK_SHADER_STAGE_COMPUTE_BIT,
+                0,
+                sizeof(ComputePushConstant),
+                &pc);
+        vkCmdDispatch(buf, groups.x, groups.y, 1);
+    };
+    auto scratchBarrier = [&]() {
+        vk::utils::bufferBarrier(
+                buf,
+                _outputScratch.buffer,
+                VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                VK_ACCESS_SHADER_WRITE_BIT,
+                VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                VK_ACCESS_SHADER_READ_BIT);
+    };
+
+    // Steps submitted earlier wrote the fields, the previous readback is done with the scratch
+    // once its own closing barrier has passed
+    vk::utils::bufferBarrier(
+            buf,
+            _grid.buffers.buffer,
+            VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+            VK_ACCESS_SHADER_WRITE_BIT,
+            VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+            VK_ACCESS_SHADER_READ_BIT);
+    dispatch(_compute.compressQuantize, groupCount());
+    scratchBarrier();
+    dispatch(_compute.compressScan, glm::uvec2(1, 1));
+    scratchBarrier();
+    dispatch(_compute.compressPack, groupCount());
+}
+
+auto Simu::statisticsIfDue() -> void
+{
+    if(!_statistics || _grid.step < _statisticsStep + _config.statsInterval)
+    {
+        return;
+    }
+
+    _statisticsStep = _grid.step;
+    _statistics->submit(_grid.step, [this](VkCommandBuffer buf, VkDeviceSize offset) {
+        recordFlowStatistics(buf, offset);
+    });
+}
+
+auto Simu::createFlowStatistics(std::optional<uint64_t> resumeStep) -> void
+{
+    if(_config.statsInterval == 0)
+    {
+        return;
+    }
+
+    auto const groups = groupCount();
+    _statistics = std::make_unique<FieldReadback>(
+            _device, sizeof(FlowStatistics), _config.outputSlots);
+    _statisticsPartials = _device->createBuffer(
+            VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+            VMA_MEMORY_USAGE_GPU_ONLY,
+            VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+            VkDeviceSize{groups.x} * groups.y * 2 * sizeof(glm::vec4));
+
+    // Shared with the consumer, which runs on the readback thread
+    auto writer = std::make_shared<FlowStatsWriter>(
+            _config.statsPath, inletVelocity, cylinderDiameter(_grid.size), resumeStep);
+    _statistics->addConsumer([writer](uint64_t step, std::span<std::byte const> slot) {
+        auto statistics = FlowStatistics{};
+        std::memcpy(reinterpret_cast<char*>(&statistics), slot.data(), sizeof(statistics));
+        writer->append(step, statistics);
+    });
+}
+
+auto Simu::recordFlowStatistics(VkCommandBuffer buf, VkDeviceSize offset) -> void
+{
+    uint32_t const N = _grid.size.x * _grid.size.y;
+    auto pc = ComputePushConstant{};
+    pc.readBufferOffset = _grid.readBufferIndex * N;
+    pc.outputOffset = static_cast<uint32_t>(offset / sizeof(float));
+
+    // Post-collision populations of the last step, see stats.glsl. The fused kernel streams them
+    // into the current lattice, the collision pass leaves them in the previous one and the AA
+    // kernel keeps them in its single lattice, swapped after an even step and streamed to the
+    // neighbours after an odd one.
+    if(_config.kernel == params::SolverKernel::InPlaceAA)
+    {
+        pc.writeBufferOffset = pc.readBufferOffset;
+        pc.parity = _grid.parity == 1 ? 1u : 2u;
+    }
+    else if(_config.kernel == params::SolverKernel::Fused)
+    {
+        pc.writeBufferOffset = pc.readBufferOffset;
+    }
+    else
+    {
+        pc.writeBufferOffset = _grid.writeBufferIndex * N;
+    }
+
+    vkCmdBindDescriptorSets(
+            buf,
+            VK_PIPELINE_BIND_POINT_COMPUTE,
+            _compute.layout,
+            0,
+            1,
+            &_descriptors.sets.at(0),
+            0,
+            nullptr);
+
+    auto dispatch = [&](VkPipeline pipeline, glm::uvec2 groups) {
+        vkCmdBindPipeline(buf, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline);
+        vkCmdPushConstants(
+                buf,
+                _compute.layout,
+                VK_SHADER_STAGE_COMPUTE_BIT,
+                0,
+                sizeof(ComputePushConstant),
+                &pc);
+        vkCmdDispatch(buf, groups.x, groups.y, 1);
+    };
+
+    // Steps submitted earlier wrote the lattice
+    vk::utils::bufferBarrier(
+            buf,
+            _grid.buffers.buffer,
+            VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+            VK_ACCESS_SHADER_WRITE_BIT,
+            VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+            VK_ACCESS_SHADER_READ_BIT);
+    dispatch(_compute.flowStats, groupCount());
+    vk::utils::bufferBarrier(
+            buf,
+            _statisticsPartials.buffer,
+            VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+            VK_ACCESS_SHADER_WRITE_BIT,
+            VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+            VK_ACCESS_SHADER_READ_BIT);
+    dispatch(_compute.flowStatsReduce, glm::uvec2(1, 1));
+}
+
+auto Simu::checkRestart(Checkpoint const& checkpoint) const -> void
+{
+    auto const& path = _config.restartPath;
+    auto const& header = checkpoint.header;
+
+    if(header.width != _grid.size.x || header.height != _grid.size.y)
+    {
+        throw std::runtime_error(fmt::format(
+                "Checkpoint {} holds a {}x{} lattice, the grid is {}x{}",
+                path,
+                header.width,
+                header.height,
+                _grid.size.x,
+                _grid.size.y));
+    }
+    if(header.layout != static_cast<uint32_t>(_config.layout))
+    {
+        throw std::runtime_error(
+                fmt::format("Checkpoint {} was written with the other lattice layout", path));
+    }
+    if(header.parity != 0 && _config.kernel != params::SolverKernel::InPlaceAA)
+    { // Only the odd AA step puts the swapped populations back in their natural slots
+        throw std::runtime_error(fmt::format(
+                "Checkpoint {} stopped after an even AA step, only the aa kernel continues it",
+                path));
+    }
+    if(!continuesWith(header, _config.kernel))
+    { // The first step would collide twice or not at all
+        throw std::runtime_error(fmt::format(
+                "Checkpoint {} was written by a kernel that leaves the lattice in another state",
+                path));
+    }
+
+    auto const regions = checkpointRegions();
+    if(checkpoint.payload.size() != regions.back().dstOffset + regions.back().size)
+    {
+        throw std::runtime_error(
+                fmt::format("Checkpoint {} does not match the lattice size", path));
+    }
+
+    if(header.tau != _config.tau)
+    {
+        _log->warn(
+                "Checkpoint {} ran with tau {}, continuing with {}", path, header.tau, _config.tau);
+    }
+}
+
+auto Simu::restoreCheckpoint(Checkpoint const& checkpoint) -> void
+{
+    auto const& header = checkpoint.header;
+
+    // Restored into the lattice the first step reads
+    auto regions = checkpointRegions();
+    for(auto& region : regions)
+    {
+        std::swap(region.srcOffset, region.dstOffset);
+    }
+
+    auto staging = _device->createBuffer(
+            VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+            VMA_MEMORY_USAGE_CPU_ONLY,
+            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+            checkpoint.payload.size(),
+            checkpoint.payload.data());
+
+    // Overwrites the starting state init.comp wrote
+    auto* buf = _device->createCommandBuffer(
+            VK_COMMAND_BUFFER_LEVEL_PRIMARY, VK_QUEUE_COMPUTE_BIT, true);
+    vk::utils::bufferBarrier(
+            buf,
+            _grid.buffers.buffer,
+            VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+            VK_ACCESS_SHADER_WRITE_BIT,
+            VK_PIPELINE_STAGE_TRANSFER_BIT,
+            VK_ACCESS_TRANSFER_WRITE_BIT);
+    vkCmdCopyBuffer(
+            buf,
+            staging.buffer,
+            _grid.buffers.buffer,
+            static_cast<uint32_t>(regions.size()),
+            regions.data());
+    vk::utils::bufferBarrier(
+            buf,
+            _grid.buffers.buffer,
+            VK_PIPELINE_STAGE_TRANSFER_BIT,
+            VK_ACCESS_TRANSFER_WRITE_BIT,
+            VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+            VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT);
+    _device->flushCommandBuffer(buf, _device->getComputeQueue(), false);
+    vkFreeCommandBuffers(_device->getLogicalDevice(), _device->getComputeCommandPool(), 1, &buf);
+
+    _grid.parity = header.parity;
+    _grid.step = header.step;
+    _log->info("Restarted from {} at step {}", _config.restartPath, header.step);
+}
+
 } // namespace app::simu
@@ -0,0 +1,32 @@
+#include "rocket/solver.h"
+
+#include "logs/log.h"
+#include "utils/timer.h"
+
+#include <chrono>
+
+namespace app::simu
+{
+
+auto timedSimulate(Solver& solver, uint64_t steps) -> double
+{
+    auto log = logs::getLogger("Solver");
+    auto const gridSize = solver.getGridSize();
+    log->info("Simulating {} steps on a {}x{} grid", steps, gridSize.x, gridSize.y);
+
+    auto timer = utils::Timer<std::chrono::duration<double>>{};
+    solver.simulate(steps);
+    auto const seconds = timer.elapsed().count();
+
+    auto const updates = static_cast<double>(gridSize.x) * gridSize.y * static_cast<double>(steps);
+    log->info(
+            "Simulated {} steps in {:.3f} s, {:.1f} steps/s, {:.1f} MLUPS",
+            steps,
+            seconds,
+            static_cast<double>(steps) / seconds,
+            updates / seconds * 1e-6);
+
+    return seconds;
+}
+
+} // namespace app::simu
@@ -0,0 +1,573 @@
+#include "rocket/stablefluids.h"
+
+#include "utils/vkutils.h"
+
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+
+namespace app::simu
+{
+
+namespace
+{
+// Planes of gridSize floats: three velocity slots of two components, two pressure slots, the
+// divergence and the solid flag. Multigrid adds the residual of the grid.
+constexpr uint32_t fieldPlanes = 3 * 2 + 2 + 1 + 1;
+constexpr uint32_t residualPlanes = 1;
+// Solution, right hand side, residual and wall mask of every coarse level
+constexpr uint32_t levelPlanes = 4;
+// Residual, preconditioned residual, search direction and its matrix product
+constexpr uint32_t conjugateGradientPlanes = 4;
+// r.z, alpha, beta and the residual norm
+constexpr uint32_t conjugateGradientScalars = 4;
+constexpr uint32_t maxLevels = 16;
+constexpr uint32_t workgroupSize = 16;
+
+// Red-black sweeps before and after the coarse grid correction, and on the coarsest level
+constexpr uint32_t preSweeps = 2;
+constexpr uint32_t postSweeps = 2;
+constexpr uint32_t coarsestSweeps = 16;
+
+// Modelled memory traffic of one cell update in bytes, counting each float read or written once
+constexpr uint64_t advectBytes = (2 + 1 + 2) * 4;
+constexpr uint64_t diffuseBytes = (2 + 2 + 1 + 2) * 4;
+constexpr uint64_t divergenceBytes = (2 + 1 + 1) * 4;
+constexpr uint64_t projectBytes = (1 + 1 + 1 + 1) * 4;
+constexpr uint64_t updateBytes = (1 + 2 + 1 + 2) * 4;
+// Per cell of the level they run on: solution, right hand side and mask in, solution out
+constexpr uint64_t sweepBytes = (1 + 1 + 1 + 1) * 4;
+constexpr uint64_t residualBytes = (1 + 1 + 1 + 1) * 4;
+constexpr uint64_t restrictBytes = (4 + 1 + 1) * 4;
+constexpr uint64_t prolongBytes = (1 + 1 + 1 + 1) * 4;
+constexpr uint64_t normBytes = 1 * 4;
+// Conjugate gradient passes, the single workgroup reductions are left out
+constexpr uint64_t cgResidualBytes = (1 + 1 + 1 + 1 + 1) * 4;
+constexpr uint64_t cgJacobiBytes = (1 + 1 + 1) * 4;
+constexpr uint64_t cgPoissonBytes = (1 + 1 + 1 + 1 + 1 + 1 + 1) * 4;
+constexpr uint64_t cgApplyBytes = (1 + 1 + 1) * 4;
+constexpr uint64_t cgUpdateBytes = (2 + 2 + 1 + 1) * 4;
+constexpr uint64_t cgDirectionBytes = (1 + 2) * 4;
+
+auto cellCount(glm::ivec2 size) -> VkDeviceSize
+{
+    return static_cast<VkDeviceSize>(size.x) * size.y;
+}
+
+auto groupCount(glm::ivec2 size) -> glm::uvec2
+{
+    return glm::uvec2(
+            (size.x + workgroupSize - 1) / workgroupSize,
+            (size.y + workgroupSize - 1) / workgroupSize);
+}
+
+auto levelSizes(glm::ivec2 size) -> std::vector<glm::ivec2>
+{
+    auto levels = std::vector<glm::ivec2>{size};
+    while(levels.size() < maxLevels && std::max(size.x, size.y) > 2)
+    {
+        size = glm::ivec2((size.x + 1) / 2, (size.y + 1) / 2);
+        levels.push_back(size);
+    }
+    return levels;
+}
+
+// Modelled traffic of the multigrid cycles per grid cell, every level costs in proportion to
+// its share of the grid cells
+auto multigridBytesPerCell(std::vector<glm::ivec2> const& levels, uint32_t cycles) -> uint64_t
+{
+    auto const cells = static_cast<double>(cellCount(levels.front()));
+    auto cycle = static_cast<double>(normBytes);
+    for(size_t l = 0; l < levels.size(); ++l)
+    {
+        auto const share = static_cast<double>(cellCount(levels[l])) / cells;
+        auto const coarsest = l + 1 == levels.size();
+        auto bytes = static_cast<double>(
+                (coarsest ? coarsestSweeps : preSweeps + postSweeps) * sweepBytes);
+        if(!coarsest)
+        {
+            bytes += residualBytes + prolongBytes;
+        }
+        if(l > 0)
+        {
+            bytes += restrictBytes;
+        }
+        cycle += share * bytes;
+    }
+    return static_cast<uint64_t>(cycle * cycles);
+}
+
+// Float offsets of the multigrid solver state, mirrors multigrid.glsl
+struct MultigridLayout
+{
+    VkDeviceSize partials = 0;
+    VkDeviceSize arguments = 0;
+    VkDeviceSize end = 0;
+};
+
+auto multigridLayout(std::vector<glm::ivec2> const& levels) -> MultigridLayout
+{
+    auto layout = MultigridLayout{};
+    layout.partials = (fieldPlanes + residualPlanes) * cellCount(levels.front());
+    for(size_t l = 1; l < levels.size(); ++l)
+    {
+        layout.partials += levelPlanes * cellCount(levels[l]);
+    }
+    auto const groups = groupCount(levels.front());
+    // Partial sums of the residual norm, the norm itself, then three words per level
+    layout.arguments = layout.partials + static_cast<VkDeviceSize>(groups.x) * groups.y + 1;
+    layout.end = layout.arguments + 3 * levels.size();
+    return layout;
+}
+
+// Float offsets of the conjugate gradient solver state, mirrors cg.glsl
+struct ConjugateGradientLayout
+{
+    VkDeviceSize partials = 0;
+    VkDeviceSize arguments = 0;
+    VkDeviceSize end = 0;
+};
+
+auto conjugateGradientLayout(glm::ivec2 size) -> ConjugateGradientLayout
+{
+    auto layout = ConjugateGradientLayout{};
+    layout.partials = (fieldPlanes + conjugateGradientPlanes) * cellCount(size);
+    auto const groups = groupCount(size);
+    // Two partial sums per workgroup and the scalars, then the arguments of the full grid and
+    // of a single workgroup
+    layout.arguments = layout.partials + 2 * static_cast<VkDeviceSize>(groups.x) * groups.y
+                       + conjugateGradientScalars;
+    layout.end = layout.arguments + 2 * 3;
+    return layout;
+}
+
+// Modelled traffic of the conjugate gradient solve per cell, with every iteration running
+auto conjugateGradientBytesPerCell(params::Params::SimulationConfig const& config) -> uint64_t
+{
+    auto const precondition =
+            config.pressurePreconditioner == params::PressurePreconditioner::Jacobi
+                    ? cgJacobiBytes
+                    : cgPoissonBytes;
+    auto const iteration = cgApplyBytes + cgUpdateBytes + precondition + cgDirectionBytes;
+    return cgResidualBytes + precondition + cgDirectionBytes
+           + config.pressureIterations * iteration;
+}
+} // namespace
+
+StableFluids::StableFluids(
+        vk::Device* device,
+        VkPipelineLayout layout,
+        VkBuffer fields,
+        params::Params::SimulationConfig const& config)
+    : _device(device), _layout(layout), _fields(fields), _config(config)
+{
+    _levels = levelSizes(glm::ivec2(_config.gridWidth, _config.gridHeight));
+    if(_config.pressureSolver == params::PressureSolver::ConjugateGradient)
+    {
+        vk::utils::requireSubgroupArithmetic(
+                _device->getPhysicalDevice(), "The pcg pressure solver");
+        _argumentsOffset = conjugateGradientLayout(_levels.front()).arguments * sizeof(float);
+    }
+    else
+    {
+        _argumentsOffset = multigridLayout(_levels).arguments * sizeof(float);
+    }
+    createPipelines();
+}
+
+StableFluids::~StableFluids()
+{
+    for(auto pipeline :
+        {_pipelines.init,
+         _pipelines.advect,
+         _pipelines.diffuse,
+         _pipelines.divergence,
+         _pipelines.project,
+         _pipelines.update,
+         _pipelines.render,
+         _pipelines.mask,
+         _pipelines.smooth,
+         _pipelines.residual,
+         _pipelines.restriction,
+         _pipelines.prolongation,
+         _pipelines.norm,
+         _pipelines.converged,
+         _pipelines.cg.residual,
+         _pipelines.cg.jacobi,
+         _pipelines.cg.poissonUpper,
+         _pipelines.cg.poissonLower,
+         _pipelines.cg.apply,
+         _pipelines.cg.alpha,
+         _pipelines.cg.update,
+         _pipelines.cg.beta,
+         _pipelines.cg.direction})
+    {
+        if(pipeline)
+            vkDestroyPipeline(_device->getLogicalDevice(), pipeline, nullptr);
+    }
+}
+
+auto StableFluids::bufferSize(params::Params::SimulationConfig const& config) -> VkDeviceSize
+{
+    auto const size = glm::ivec2(config.gridWidth, config.gridHeight);
+    if(config.pressureSolver == params::PressureSolver::Multigrid)
+    {
+        return multigridLayout(levelSizes(size)).end * sizeof(float);
+    }
+    if(config.pressureSolver == params::PressureSolver::ConjugateGradient)
+    {
+        return conjugateGradientLayout(size).end * sizeof(float);
+    }
+    return cellCount(size) * fieldPlanes * sizeof(float);
+}
+
+auto StableFluids::pressureIterations(params::Params::SimulationConfig const& config) -> uint32_t
+{
+    return config.pressureIterations + config.pressureIterations % 2;
+}
+
+auto StableFluids::modelledBytesPerCell(params::Params::SimulationConfig const& config)
+        -> uint64_t
+{
+    auto bytes = advectBytes + config.diffuseIterations * diffuseBytes + divergenceBytes
+                 + updateBytes;
+
+    if(config.pressureSolver == params::PressureSolver::Jacobi)
+    {
+        return bytes + pressureIterations(config) * projectBytes;
+    }
+    if(config.pressureSolver == params::PressureSolver::ConjugateGradient)
+    {
+        return bytes + conjugateGradientBytesPerCell(config);
+    }
+
+    auto const levels = levelSizes(glm::ivec2(config.gridWidth, config.gridHeight));
+    return bytes + multigridBytesPerCell(levels, config.pressureCycles);
+}
+
+auto StableFluids::createPipelines() -> void
+{
+    VkComputePipelineCreateInfo pipelineInfo = {};
+    pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+    pipelineInfo.pNext = nullptr;
+    pipelineInfo.flags = 0;
+    pipelineInfo.layout = _layout;
+    pipelineInfo.basePipelineHandle = VK_NULL_HANDLE;
+    pipelineInfo.basePipelineIndex = 0;
+
+    auto addPipeline = [&](std::string const& name, VkPipeline& pipeline) {
+        auto shaderInfo = _device->loadShaderFromFile(
+                "data/shaders/" + name + ".comp.spv", VK_SHADER_STAGE_COMPUTE_BIT);
+
+        pipelineInfo.stage = shaderInfo;
+        VK_CHECK(vkCreateComputePipelines(
+                _device->getLogicalDevice(),
+                _device->getPipelineCache(),
+                1,
+                &pipelineInfo,
+                nullptr,
+                &pipeline));
+
+        vkDestroyShaderModule(_device->getLogicalDevice(), shaderInfo.module, nullptr);
+    };
+
+    addPipeline("cfd_vel_init", _pipelines.init);
+    addPipeline("cfd_vel_advect", _pipelines.advect);
+    addPipeline("cfd_vel_diffuse", _pipelines.diffuse);
+    addPipeline("cfd_vel_divergence", _pipelines.divergence);
+    addPipeline("cfd_vel_update", _pipelines.update);
+    addPipeline("cfd_vel_render", _pipelines.render);
+
+    if(_config.pressureSolver == params::PressureSolver::Multigrid)
+    {
+        addPipeline("mg_mask", _pipelines.mask);
+        addPipeline("mg_smooth", _pipelines.smooth);
+        addPipeline("mg_residual", _pipelines.residual);
+        addPipeline("mg_restrict", _pipelines.restriction);
+        addPipeline("mg_prolong", _pipelines.prolongation);
+        addPipeline("mg_norm", _pipelines.norm);
+        addPipeline("mg_converged", _pipelines.converged);
+    }
+    else if(_config.pressureSolver == params::PressureSolver::ConjugateGradient)
+    {
+        addPipeline("cg_residual", _pipelines.cg.residual);
+        if(_config.pressurePreconditioner == params::PressurePreconditioner::Jacobi)
+        {
+            addPipeline("cg_jacobi", _pipelines.cg.jacobi);
+        }
+        else
+        {
+            addPipeline("cg_poisson_upper", _pipelines.cg.poissonUpper);
+            addPipeline("cg_poisson_lower", _pipelines.cg.poissonLower);
+        }
+        addPipeline("cg_apply", _pipelines.cg.apply);
+        addPipeline("cg_alpha", _pipelines.cg.alpha);
+        addPipeline("cg_update", _pipelines.cg.update);
+        addPipeline("cg_beta", _pipelines.cg.beta);
+        addPipeline("cg_direction", _pipelines.cg.direction);
+    }
+    else
+    {
+        addPipeline("cfd_vel_project", _pipelines.project);
+    }
+}
+
+auto StableFluids::push(VkCommandBuffer buf, FluidPushConstant const& pc) -> void
+{
+    vkCmdPushConstants(
+            buf, _layout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(FluidPushConstant), &pc);
+}
+
+auto StableFluids::dispatch(VkCommandBuffer buf, VkPipeline pipeline, uint32_t level, bool indirect)
+        -> void
+{
+    vkCmdBindPipeline(buf, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline);
+    if(indirect)
+    {
+        vkCmdDispatchIndirect(
+                buf, _fields, _argumentsOffset + level * sizeof(VkDispatchIndirectCommand));
+    }
+    else
+    {
+        auto const groups = groupCount(_levels.at(level));
+        vkCmdDispatch(buf, groups.x, groups.y, 1);
+    }
+    barrier(buf);
+}
+
+auto StableFluids::reduce(VkCommandBuffer buf, VkPipeline pipeline, bool indirect) -> void
+{
+    vkCmdBindPipeline(buf, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline);
+    if(indirect)
+    {
+        vkCmdDispatchIndirect(buf, _fields, _argumentsOffset + sizeof(VkDispatchIndirectCommand));
+    }
+    else
+    {
+        vkCmdDispatch(buf, 1, 1, 1);
+    }
+    barrier(buf);
+}
+
+auto StableFluids::barrier(VkCommandBuffer buf) -> void
+{
+    auto barrierInfo = VkBufferMemoryBarrier{};
+    barrierInfo.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+    barrierInfo.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+    barrierInfo.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT
+                                | VK_ACCESS_INDIRECT_COMMAND_READ_BIT;
+    barrierInfo.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrierInfo.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrierInfo.buffer = _fields;
+    barrierInfo.offset = 0;
+    barrierInfo.size = VK_WHOLE_SIZE;
+
+    vkCmdPipelineBarrier(
+            buf,
+            VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+            VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT,
+            0,
+            0,
+            nullptr,
+            1,
+            &barrierInfo,
+            0,
+            nullptr);
+}
+
+auto StableFluids::recordInit(VkCommandBuffer buf) -> void
+{
+    auto pc = FluidPushConstant{};
+    pc.levels = static_cast<uint32_t>(_levels.size());
+    push(buf, pc);
+    dispatch(buf, _pipelines.init, 0);
+
+    // Coarse wall masks, each built from the one below it
+    if(_config.pressureSolver == params::PressureSolver::Multigrid)
+    {
+        for(uint32_t level = 1; level < _levels.size(); ++level)
+        {
+            pc.level = level;
+            push(buf, pc);
+            dispatch(buf, _pipelines.mask, level);
+        }
+    }
+}
+
+auto StableFluids::recordStep(VkCommandBuffer buf, Mark const& mark) -> void
+{
+    auto pc = FluidPushConstant{};
+
+    // Slot 0 holds the divergence free velocity of the previous step
+    pc.velocityRead = 0;
+    pc.velocityWrite = 1;
+    push(buf, pc);
+    dispatch(buf, _pipelines.advect, 0);
+    mark("advect", advectBytes);
+
+    // Jacobi iterations ping-pong between slots 2 and 0 against the advected velocity in slot 1
+    uint32_t velocity = 1;
+    pc.velocitySource = 1;
+    for(uint32_t i = 0; i < _config.diffuseIterations; ++i)
+    {
+        pc.velocityRead = velocity;
+        pc.velocityWrite = velocity == 2 ? 0 : 2;
+        push(buf, pc);
+        dispatch(buf, _pipelines.diffuse, 0);
+        velocity = pc.velocityWrite;
+    }
+    if(_config.diffuseIterations > 0)
+    {
+        mark("diffuse", _config.diffuseIterations * diffuseBytes);
+    }
+
+    pc.velocityRead = velocity;
+    push(buf, pc);
+    dispatch(buf, _pipelines.divergence, 0);
+    mark("divergence", divergenceBytes);
+
+    // Every solver is warm started from the pressure of the previous step in slot 0
+    if(_config.pressureSolver == params::PressureSolver::Multigrid)
+    {
+        recordMultigrid(buf);
+        mark("multigrid", multigridBytesPerCell(_levels, _config.pressureCycles));
+    }
+    else if(_config.pressureSolver == params::PressureSolver::ConjugateGradient)
+    {
+        recordConjugateGradient(buf);
+        mark("pcg", conjugateGradientBytesPerCell(_config));
+    }
+    else
+    {
+        recordJacobi(buf);
+        mark("project", pressureIterations(_config) * projectBytes);
+    }
+
+    // Only reads the velocity of its own cell, so updating slot 0 in place is safe
+    pc.pressureRead = 0;
+    pc.velocityWrite = 0;
+    push(buf, pc);
+    dispatch(buf, _pipelines.update, 0);
+    mark("update", updateBytes);
+}
+
+auto StableFluids::recordJacobi(VkCommandBuffer buf) -> void
+{
+    auto pc = FluidPushConstant{};
+    for(uint32_t i = 0; i < pressureIterations(_config); ++i)
+    {
+        pc.pressureRead = i % 2;
+        pc.pressureWrite = 1 - i % 2;
+        push(buf, pc);
+        dispatch(buf, _pipelines.project, 0);
+    }
+}
+
+auto StableFluids::recordMultigrid(VkCommandBuffer buf) -> void
+{
+    auto const levels = static_cast<uint32_t>(_levels.size());
+    auto const coarsest = levels - 1;
+
+    auto pc = FluidPushConstant{};
+    pc.levels = levels;
+    pc.tolerance = _config.pressureTolerance;
+
+    auto run = [&](VkPipeline pipeline, uint32_t level, bool indirect) {
+        pc.level = level;
+        push(buf, pc);
+        dispatch(buf, pipeline, level, indirect);
+    };
+    auto smooth = [&](uint32_t level, uint32_t sweeps, bool indirect) {
+        for(uint32_t i = 0; i < sweeps; ++i)
+        {
+            for(uint32_t color = 0; color < 2; ++color)
+            {
+                pc.color = color;
+                run(_pipelines.smooth, level, indirect);
+            }
+        }
+    };
+
+    // Every pass after the first convergence check is an indirect dispatch whose arguments
+    // mg_converged clears once the residual is small enough, so the remaining cycles cost no
+    // more than their barriers and nothing is read back to the host
+    for(uint32_t cycle = 0; cycle < _config.pressureCycles; ++cycle)
+    {
+        auto const indirect = cycle > 0;
+        smooth(0, levels == 1 ? coarsestSweeps : preSweeps, indirect);
+        run(_pipelines.residual, 0, indirect);
+        run(_pipelines.norm, 0, indirect);
+
+        pc.level = 0;
+        push(buf, pc);
+        reduce(buf, _pipelines.converged, false);
+
+        if(levels == 1)
+        {
+            continue;
+        }
+
+        // Down to the coarsest level and back up
+        run(_pipelines.restriction, 1, true);
+        for(uint32_t level = 1; level < coarsest; ++level)
+        {
+            smooth(level, preSweeps, true);
+            run(_pipelines.residual, level, true);
+            run(_pipelines.restriction, level + 1, true);
+        }
+        smooth(coarsest, coarsestSweeps, true);
+        for(uint32_t level = coarsest; level-- > 0;)
+        {
+            run(_pipelines.prolongation, level, true);
+            smooth(level, postSweeps, true);
+        }
+    }
+}
+
+auto StableFluids::recordConjugateGradient(VkCommandBuffer buf) -> void
+{
+    auto pc = FluidPushConstant{};
+    pc.tolerance = _config.pressureTolerance;
+    push(buf, pc);
+
+    // Leaves z = M^-1 r and the partial sums of r.z and r.r
+    auto precondition = [&](bool indirect) {
+        if(_config.pressurePreconditioner == params::PressurePreconditioner::Jacobi)
+        {
+            dispatch(buf, _pipelines.cg.jacobi, 0, indirect);
+        }
+        else
+        {
+            dispatch(buf, _pipelines.cg.poissonUpper, 0, indirect);
+            dispatch(buf, _pipelines.cg.poissonLower, 0, indirect);
+        }
+    };
+
+    // The starting residual and its check run directly, cg_beta then rewrites the arguments
+    // the previous step left cleared. Every later pass is indirect and stops costing more than
+    // its barrier once the residual is below tolerance, without reading anything back.
+    dispatch(buf, _pipelines.cg.residual, 0);
+    precondition(false);
+    reduce(buf, _pipelines.cg.beta, false);
+    dispatch(buf, _pipelines.cg.direction, 0, true);
+
+    for(uint32_t i = 0; i < _config.pressureIterations; ++i)
+    {
+        dispatch(buf, _pipelines.cg.apply, 0, true);
+        reduce(buf, _pipelines.cg.alpha, true);
+        dispatch(buf, _pipelines.cg.update, 0, true);
+        precondition(true);
+        reduce(buf, _pipelines.cg.beta, true);
+        dispatch(buf, _pipelines.cg.direction, 0, true);
+    }
+}
+
+auto StableFluids::recordRender(VkCommandBuffer buf) -> void
+{
+    push(buf, FluidPushConstant{});
+    vkCmdBindPipeline(buf, VK_PIPELINE_BIND_POINT_COMPUTE, _pipelines.render);
+    auto const groups = groupCount(_levels.front());
+    vkCmdDispatch(buf, groups.x, groups.y, 1);
+}
+
+} // namespace app::simu
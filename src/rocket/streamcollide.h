@@ -0,0 +1,295 @@
+#pragma once
+
+// Fused D2Q9 step of the CPU backend, included by one translation unit per instruction set.
+// The physics mirror lbm.glsl and lbm_fused.comp; see simd.h for why nothing here is shared
+// between those units.
+
+#include "rocket/cpukernel.h"
+#include "rocket/lattice.h"
+#include "simd.h"
+
+#include <cstddef>
+
+namespace app::simu::cpu
+{
+namespace
+{
+
+constexpr int ex[9] = {0, 1, 0, -1, 0, 1, -1, -1, 1};
+constexpr int ey[9] = {0, 0, 1, 0, -1, 1, 1, -1, -1};
+constexpr float wi[9] = {
+        4.0f / 9.0f,
+        1.0f / 9.0f,
+        1.0f / 9.0f,
+        1.0f / 9.0f,
+        1.0f / 9.0f,
+        1.0f / 36.0f,
+        1.0f / 36.0f,
+        1.0f / 36.0f,
+        1.0f / 36.0f};
+// Opposite direction of each population
+constexpr int opposite[9] = {0, 3, 4, 1, 2, 7, 8, 5, 6};
+
+// Columns ramping up to inletVelocity, INFLOW_COLUMNS of lbm.glsl
+constexpr int inflowColumns = 20;
+
+auto clampf(float v, float lo, float hi) -> float
+{
+    return v < lo ? lo : (hi < v ? hi : v);
+}
+
+auto equilibrium(int i, float ux, float uy, float rho) -> float
+{
+    float eu = static_cast<float>(ex[i]) * ux + static_cast<float>(ey[i]) * uy;
+    float u2 = ux * ux + uy * uy;
+    return wi[i] * rho * (1.0f + 3.0f * eu + 4.5f * eu * eu - 1.5f * u2);
+}
+
+// Shear relaxation rate with the Smagorinsky eddy viscosity, from the xx, yy and xy components of
+// the non-equilibrium momentum flux. Mirrors shearRate in lbm.glsl.
+template<typename Lanes>
+auto smagorinskyRate(
+        LatticeView const& l,
+        typename Lanes::Reg xx,
+        typename Lanes::Reg yy,
+        typename Lanes::Reg xy,
+        typename Lanes::Reg rho) -> typename Lanes::Reg
+{
+    auto const tau = Lanes::set(1.0f / l.omega);
+    auto const norm = Lanes::sqrt(Lanes::add(
+            Lanes::add(Lanes::mul(xx, xx), Lanes::mul(yy, yy)),
+            Lanes::mul(Lanes::set(2.0f), Lanes::mul(xy, xy))));
+    auto const eddy = Lanes::mul(
+            Lanes::set(18.0f * std::sqrt(2.0f) * l.smagorinsky * l.smagorinsky),
+            Lanes::div(norm, rho));
+    return Lanes::div(
+            Lanes::set(2.0f), Lanes::add(tau, Lanes::sqrt(Lanes::add(Lanes::mul(tau, tau), eddy))));
+}
+
+// Full rules for a single cell, used wherever the boundary conditions apply
+auto updateCell(LatticeView const& l, int x, int y) -> void
+{
+    auto const plane = static_cast<size_t>(l.width) * static_cast<size_t>(l.height);
+    auto const index = static_cast<size_t>(y) * static_cast<size_t>(l.width) + x;
+
+    float f[9];
+    for(int i = 0; i < 9; ++i)
+    {
+        int const nx = x - ex[i];
+        int const ny = y - ey[i];
+        auto source = index;
+        if(nx >= 0 && nx < l.width && ny >= 0 && ny < l.height)
+        {
+            source = static_cast<size_t>(ny) * static_cast<size_t>(l.width) + nx;
+        }
+        f[i] = l.src[i * plane + source];
+    }
+
+    float ux = l.velocityX[index];
+    float uy = l.velocityY[index];
+    float rho = l.density[index];
+
+    // Zou/He on the obstacle with zero velocity and unit density
+    if(l.solid[index] != 0)
+    {
+        float feq[9];
+        for(int i = 0; i < 9; ++i)
+        {
+            feq[i] = equilibrium(i, 0.0f, 0.0f, 1.0f);
+        }
+        for(int i : {1, 2, 5, 6})
+        {
+            f[opposite[i]] = feq[opposite[i]] + f[i] - feq[i];
+        }
+        ux = 0.0f;
+        uy = 0.0f;
+        rho = 1.0f;
+    }
+
+    if(x < inflowColumns)
+    {
+        ux = x < 1 ? inletVelocity
+                   : inletVelocity * clampf(
+                             static_cast<float>(x) / static_cast<float>(inflowColumns), 0.0f, 1.0f);
+        uy = 0.0f;
+        rho = 1.0f;
+        for(int i = 0; i < 9; ++i)
+        {
+            f[i] = equilibrium(i, ux, uy, rho);
+        }
+    }
+    else if(x == l.width - 1)
+    { // Zou/He outflow at unit density keeping the current velocity
+        float feq[9];
+        for(int i = 0; i < 9; ++i)
+        {
+            feq[i] = equilibrium(i, ux, uy, 1.0f);
+        }
+        f[1] = feq[1] + f[3] - feq[3];
+        f[5] = feq[5] + f[7] - feq[7];
+        f[8] = feq[8] + f[6] - feq[6];
+    }
+    else if(y == 0 || y == l.height - 1)
+    { // Bounce-back walls
+        for(int i : {2, 5, 6})
+        {
+            float const tmp = f[i];
+            f[i] = f[opposite[i]];
+            f[opposite[i]] = tmp;
+        }
+    }
+
+    rho = 0.0f;
+    ux = 0.0f;
+    uy = 0.0f;
+    for(int i = 0; i < 9; ++i)
+    {
+        rho += f[i];
+        ux += f[i] * static_cast<float>(ex[i]);
+        uy += f[i] * static_cast<float>(ey[i]);
+    }
+    ux = clampf(ux / (rho + 0.01f), -500.0f, 500.0f);
+    uy = clampf(uy / (rho + 0.01f), -500.0f, 500.0f);
+    rho = clampf(rho, 0.1f, 10.0f);
+
+    l.velocityX[index] = ux;
+    l.velocityY[index] = uy;
+    l.density[index] = rho;
+
+    float feq[9];
+    float flux[3] = {};
+    for(int i = 0; i < 9; ++i)
+    {
+        feq[i] = equilibrium(i, ux, uy, rho);
+        auto const neq = f[i] - feq[i];
+        flux[0] += neq * static_cast<float>(ex[i] * ex[i]);
+        flux[1] += neq * static_cast<float>(ey[i] * ey[i]);
+        flux[2] += neq * static_cast<float>(ex[i] * ey[i]);
+    }
+    auto const omega = l.smagorinsky > 0.0f
+                               ? smagorinskyRate<ScalarLanes>(l, flux[0], flux[1], flux[2], rho)
+                               : l.omega;
+
+    for(int i = 0; i < 9; ++i)
+    {
+        l.dst[i * plane + index] = f[i] - (f[i] - feq[i]) * omega;
+    }
+}
+
+// Bulk fluid cells: every neighbour is inside the domain and no boundary rule applies
+template<typename Lanes>
+auto updateInterior(LatticeView const& l, size_t index) -> void
+{
+    using Reg = typename Lanes::Reg;
+    auto const plane = static_cast<size_t>(l.width) * static_cast<size_t>(l.height);
+    auto const width = static_cast<ptrdiff_t>(l.width);
+
+    Reg f[9];
+    for(int i = 0; i < 9; ++i)
+    {
+        auto const offset = -static_cast<ptrdiff_t>(ex[i]) - static_cast<ptrdiff_t>(ey[i]) * width;
+        f[i] = Lanes::load(l.src + i * plane + index + offset);
+    }
+
+    Reg rho = f[0];
+    for(int i = 1; i < 9; ++i)
+    {
+        rho = Lanes::add(rho, f[i]);
+    }
+    Reg ux = Lanes::sub(
+            Lanes::add(Lanes::add(f[1], f[5]), f[8]), Lanes::add(Lanes::add(f[3], f[6]), f[7]));
+    Reg uy = Lanes::sub(
+            Lanes::add(Lanes::add(f[2], f[5]), f[6]), Lanes::add(Lanes::add(f[4], f[7]), f[8]));
+
+    auto const clamp = [](Reg v, float lo, float hi) {
+        return Lanes::min(Lanes::max(v, Lanes::set(lo)), Lanes::set(hi));
+    };
+    auto const inverse = Lanes::div(Lanes::set(1.0f), Lanes::add(rho, Lanes::set(0.01f)));
+    ux = clamp(Lanes::mul(ux, inverse), -500.0f, 500.0f);
+    uy = clamp(Lanes::mul(uy, inverse), -500.0f, 500.0f);
+    rho = clamp(rho, 0.1f, 10.0f);
+
+    Lanes::store(l.velocityX + index, ux);
+    Lanes::store(l.velocityY + index, uy);
+    Lanes::store(l.density + index, rho);
+
+    // BGK collision, eu per direction built from the two velocity components
+    auto const base = Lanes::sub(
+            Lanes::set(1.0f),
+            Lanes::mul(Lanes::set(1.5f), Lanes::add(Lanes::mul(ux, ux), Lanes::mul(uy, uy))));
+    auto const zero = Lanes::set(0.0f);
+    Reg const eu[9] = {
+            zero,
+            ux,
+            uy,
+            Lanes::sub(zero, ux),
+            Lanes::sub(zero, uy),
+            Lanes::add(ux, uy),
+            Lanes::sub(uy, ux),
+            Lanes::sub(zero, Lanes::add(ux, uy)),
+            Lanes::sub(ux, uy)};
+
+    Reg neq[9];
+    for(int i = 0; i < 9; ++i)
+    {
+        auto const polynomial = Lanes::add(
+                base,
+                Lanes::mul(
+                        eu[i],
+                        Lanes::add(Lanes::set(3.0f), Lanes::mul(Lanes::set(4.5f), eu[i]))));
+        auto const feq = Lanes::mul(Lanes::mul(Lanes::set(wi[i]), rho), polynomial);
+        neq[i] = Lanes::sub(f[i], feq);
+    }
+
+    auto omega = Lanes::set(l.omega);
+    if(l.smagorinsky > 0.0f)
+    { // Momentum flux components, the diagonal populations contribute to all three
+        auto const diagonal = Lanes::add(Lanes::add(neq[5], neq[6]), Lanes::add(neq[7], neq[8]));
+        auto const xx = Lanes::add(Lanes::add(neq[1], neq[3]), diagonal);
+        auto const yy = Lanes::add(Lanes::add(neq[2], neq[4]), diagonal);
+        auto const xy = Lanes::sub(Lanes::add(neq[5], neq[7]), Lanes::add(neq[6], neq[8]));
+        omega = smagorinskyRate<Lanes>(l, xx, yy, xy, rho);
+    }
+
+    for(int i = 0; i < 9; ++i)
+    {
+        Lanes::store(l.dst + i * plane + index, Lanes::sub(f[i], Lanes::mul(neq[i], omega)));
+    }
+}
+
+template<typename Lanes>
+auto streamCollideRow(LatticeView const& l, int y) -> void
+{
+    auto const row = static_cast<size_t>(y) * static_cast<size_t>(l.width);
+
+    // Walls, inflow and outflow columns take the per cell path, as do vectors touching the
+    // obstacle
+    bool const wall = y == 0 || y == l.height - 1;
+    int const begin = wall ? l.width : (inflowColumns < l.width ? inflowColumns : l.width);
+    int const end = wall ? l.width : l.width - 1;
+
+    int x = 0;
+    for(; x < begin; ++x)
+    {
+        updateCell(l, x, y);
+    }
+    for(; x + Lanes::width <= end; x += Lanes::width)
+    {
+        if(x < l.solidEnd[y] && x + Lanes::width > l.solidBegin[y])
+        {
+            for(int k = 0; k < Lanes::width; ++k)
+            {
+                updateCell(l, x + k, y);
+            }
+            continue;
+        }
+        updateInterior<Lanes>(l, row + x);
+    }
+    for(; x < l.width; ++x)
+    {
+        updateCell(l, x, y);
+    }
+}
+
+} // namespace
+} // namespace app::simu::cpu
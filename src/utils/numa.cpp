@@ -0,0 +1,176 @@
+#include "utils/numa.h"
+
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <thread>
+
+#include <sched.h>
+
+namespace utils
+{
+
+namespace
+{
+auto allowedCpus() -> std::vector<int>
+{
+    auto cpus = std::vector<int>{};
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    if(sched_getaffinity(0, sizeof(set), &set) == 0)
+    {
+        for(int cpu = 0; cpu < CPU_SETSIZE; ++cpu)
+        {
+            if(CPU_ISSET(cpu, &set))
+            {
+                cpus.push_back(cpu);
+            }
+        }
+    }
+    if(cpus.empty())
+    {
+        for(int cpu = 0; cpu < static_cast<int>(std::thread::hardware_concurrency()); ++cpu)
+        {
+            cpus.push_back(cpu);
+        }
+    }
+    return cpus;
+}
+
+// "Node 0 MemTotal:       65843068 kB"
+auto nodeMemory(std::filesystem::path const& meminfo) -> uint64_t
+{
+    auto file = std::ifstream(meminfo);
+    auto line = std::string{};
+    while(std::getline(file, line))
+    {
+        auto const key = line.find("MemTotal:");
+        if(key != std::string::npos)
+        {
+            auto stream = std::istringstream(line.substr(key + 9));
+            uint64_t kilobytes = 0;
+            stream >> kilobytes;
+            return kilobytes * 1024;
+        }
+    }
+    return 0;
+}
+} // namespace
+
+auto parseCpuList(std::string const& list) -> std::vector<int>
+{
+    auto cpus = std::vector<int>{};
+    auto stream = std::istringstream(list);
+    auto range = std::string{};
+    while(std::getline(stream, range, ','))
+    {
+        if(range.empty() || range == "\n")
+        {
+            continue;
+        }
+        auto const dash = range.find('-');
+        auto const first = std::stoi(range.substr(0, dash));
+        auto const last = dash == std::string::npos ? first : std::stoi(range.substr(dash + 1));
+        for(int cpu = first; cpu <= last; ++cpu)
+        {
+            cpus.push_back(cpu);
+        }
+    }
+    return cpus;
+}
+
+auto NumaTopology::detect() -> NumaTopology
+{
+    auto const allowed = allowedCpus();
+    auto topology = NumaTopology{};
+
+    auto const root = std::filesystem::path("/sys/devices/system/node");
+    auto error = std::error_code{};
+    for(auto const& entry : std::filesystem::directory_iterator(root, error))
+    {
+        auto const name = entry.path().filename().string();
+        if(name.rfind("node", 0) != 0 || name.size() == 4
+           || !std::all_of(name.begin() + 4, name.end(), ::isdigit))
+        {
+            continue;
+        }
+
+        auto node = Node{};
+        node.id = std::stoi(name.substr(4));
+        auto file = std::ifstream(entry.path() / "cpulist");
+        auto list = std::string{};
+        std::getline(file, list);
+        for(auto cpu : parseCpuList(list))
+        {
+            if(std::find(allowed.begin(), allowed.end(), cpu) != allowed.end())
+            {
+                node.cpus.push_back(cpu);
+            }
+        }
+        node.memoryBytes = nodeMemory(entry.path() / "meminfo");
+
+        if(!node.cpus.empty())
+        {
+            topology.nodes.push_back(std::move(node));
+        }
+    }
+
+    if(topology.nodes.empty())
+    {
+        topology.nodes.push_back(Node{0, allowed, 0});
+    }
+    std::sort(topology.nodes.begin(), topology.nodes.end(), [](auto const& a, auto const& b) {
+        return a.id < b.id;
+    });
+    return topology;
+}
+
+auto NumaTopology::cpuCount() const -> uint32_t
+{
+    size_t count = 0;
+    for(auto const& node : nodes)
+    {
+        count += node.cpus.size();
+    }
+    return static_cast<uint32_t>(count);
+}
+
+auto NumaTopology::placement(uint32_t workers) const -> std::vector<int>
+{
+    auto cpus = std::vector<int>{};
+    auto const total = cpuCount();
+    if(total == 0)
+    {
+        return cpus;
+    }
+
+    // Share of the workers per node, rounding handed out front to back
+    uint32_t assigned = 0;
+    size_t seen = 0;
+    for(auto const& node : nodes)
+    {
+        seen += node.cpus.size();
+        auto const upTo = static_cast<uint32_t>(workers * seen / total);
+        for(uint32_t i = 0; assigned < upTo; ++i, ++assigned)
+        {
+            // More workers than processors wrap around the node
+            cpus.push_back(node.cpus[i % node.cpus.size()]);
+        }
+    }
+    return cpus;
+}
+
+auto NumaTopology::nodeOf(int cpu) const -> int
+{
+    for(auto const& node : nodes)
+    {
+        if(std::find(node.cpus.begin(), node.cpus.end(), cpu) != node.cpus.end())
+        {
+            return node.id;
+        }
+    }
+    return -1;
+}
+
+} // namespace utils
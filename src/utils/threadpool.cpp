@@ -0,0 +1,139 @@
+#include "utils/threadpool.h"
+
+#include <algorithm>
+
+#include <pthread.h>
+#include <sched.h>
+
+namespace utils
+{
+
+namespace
+{
+auto pin(pthread_t thread, int cpu) -> bool
+{
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    return pthread_setaffinity_np(thread, sizeof(set), &set) == 0;
+}
+} // namespace
+
+ThreadPool::ThreadPool(uint32_t threads, std::vector<int> const& cpus)
+{
+    if(threads == 0)
+    {
+        threads = std::max(std::thread::hardware_concurrency(), 1u);
+    }
+
+    _workers.reserve(threads - 1);
+    for(uint32_t i = 1; i < threads; ++i)
+    {
+        _workers.emplace_back([this, i] { workerLoop(i); });
+    }
+
+    if(!cpus.empty())
+    {
+        // Worker 0 is borrowed from the caller, which gets its own mask back with the pool
+        _caller = pthread_self();
+        auto const saved =
+                pthread_getaffinity_np(_caller, sizeof(_callerAffinity), &_callerAffinity);
+        _restoreCaller = saved == 0;
+        _cpus.assign(threads, -1);
+        for(uint32_t i = 0; i < threads && i < cpus.size(); ++i)
+        {
+            auto const thread = i == 0 ? pthread_self() : _workers[i - 1].native_handle();
+            _cpus[i] = pin(thread, cpus[i]) ? cpus[i] : -1;
+        }
+    }
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        auto lock = std::lock_guard(_mutex);
+        _stop = true;
+    }
+    _start.notify_all();
+
+    for(auto& worker : _workers)
+    {
+        worker.join();
+    }
+
+    if(_restoreCaller)
+    {
+        pthread_setaffinity_np(_caller, sizeof(_callerAffinity), &_callerAffinity);
+    }
+}
+
+auto ThreadPool::range(size_t count, uint32_t worker, uint32_t workers) -> std::pair<size_t, size_t>
+{
+    auto const chunk = count / workers;
+    auto const rest = count % workers;
+    auto const begin = worker * chunk + std::min<size_t>(worker, rest);
+    return {begin, begin + chunk + (worker < rest ? 1 : 0)};
+}
+
+auto ThreadPool::parallelFor(size_t count, Job const& job) -> void
+{
+    if(_workers.empty())
+    {
+        job(0, count, 0);
+        return;
+    }
+
+    {
+        auto lock = std::lock_guard(_mutex);
+        _job = &job;
+        _count = count;
+        _pending = static_cast<uint32_t>(_workers.size());
+        ++_generation;
+    }
+    _start.notify_all();
+
+    auto const [begin, end] = range(count, 0, size());
+    if(begin < end)
+    {
+        job(begin, end, 0);
+    }
+
+    auto lock = std::unique_lock(_mutex);
+    _done.wait(lock, [this] { return _pending == 0; });
+    _job = nullptr;
+}
+
+auto ThreadPool::workerLoop(uint32_t worker) -> void
+{
+    uint64_t generation = 0;
+    while(true)
+    {
+        Job const* job = nullptr;
+        size_t count = 0;
+        {
+            auto lock = std::unique_lock(_mutex);
+            _start.wait(lock, [&] { return _stop || _generation != generation; });
+            if(_stop)
+            {
+                return;
+            }
+            generation = _generation;
+            job = _job;
+            count = _count;
+        }
+
+        auto const [begin, end] = range(count, worker, size());
+        if(begin < end)
+        {
+            (*job)(begin, end, worker);
+        }
+
+        {
+            auto lock = std::lock_guard(_mutex);
+            --_pending;
+        }
+        _done.notify_one();
+    }
+}
+
+} // namespace utils
@@ -2,6 +2,7 @@
 #include "utils/vkutils.h"
 
 #include <cassert>
+#include <stdexcept>
 
 namespace app::vk::utils
 {
@@ -60,4 +61,42 @@ auto deviceType(VkPhysicalDeviceType deviceType) -> std::string
     // clang-format on
 }
 
+auto bufferBarrier(
+        VkCommandBuffer buf,
+        VkBuffer buffer,
+        VkPipelineStageFlags srcStage,
+        VkAccessFlags srcAccess,
+        VkPipelineStageFlags dstStage,
+        VkAccessFlags dstAccess) -> void
+{
+    auto barrierInfo = VkBufferMemoryBarrier{};
+    barrierInfo.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+    barrierInfo.srcAccessMask = srcAccess;
+    barrierInfo.dstAccessMask = dstAccess;
+    barrierInfo.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrierInfo.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrierInfo.buffer = buffer;
+    barrierInfo.offset = 0;
+    barrierInfo.size = VK_WHOLE_SIZE;
+    vkCmdPipelineBarrier(buf, srcStage, dstStage, 0, 0, nullptr, 1, &barrierInfo, 0, nullptr);
+}
+
+auto requireSubgroupArithmetic(VkPhysicalDevice physicalDevice, std::string const& feature)
+        -> void
+{
+    auto subgroup = VkPhysicalDeviceSubgroupProperties{};
+    subgroup.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_SUBGROUP_PROPERTIES;
+    auto properties = VkPhysicalDeviceProperties2{};
+    properties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+    properties.pNext = &subgroup;
+    vkGetPhysicalDeviceProperties2(physicalDevice, &properties);
+
+    if(properties.properties.apiVersion < VK_API_VERSION_1_1
+       || !(subgroup.supportedStages & VK_SHADER_STAGE_COMPUTE_BIT)
+       || !(subgroup.supportedOperations & VK_SUBGROUP_FEATURE_ARITHMETIC_BIT))
+    {
+        throw std::runtime_error(feature + " needs subgroup arithmetic in compute shaders");
+    }
+}
+
 } // namespace app::vk::utils
@@ -0,0 +1,136 @@
+#include "gtest/gtest.h"
+
+#include "common/appcontext.h"
+#include "rocket/checkpoint.h"
+
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+
+namespace
+{
+auto tempPath(std::string const& name) -> std::string
+{
+    return (std::filesystem::temp_directory_path() / name).string();
+}
+
+auto makeCheckpoint(uint64_t step) -> app::simu::Checkpoint
+{
+    auto checkpoint = app::simu::Checkpoint{};
+    checkpoint.header.width = 4;
+    checkpoint.header.height = 2;
+    checkpoint.header.parity = 1;
+    checkpoint.header.step = step;
+    checkpoint.header.tau = 0.6f;
+    for(int i = 0; i < 32; ++i)
+    {
+        checkpoint.payload.push_back(static_cast<std::byte>(i + step));
+    }
+    return checkpoint;
+}
+} // namespace
+
+TEST(Checkpoint, RoundTrip)
+{
+    auto const path = tempPath("checkpoint_roundtrip.bin");
+    app::simu::writeCheckpoint(path, makeCheckpoint(1234));
+
+    auto const checkpoint = app::simu::readCheckpoint(path);
+    EXPECT_EQ(checkpoint.header.width, 4);
+    EXPECT_EQ(checkpoint.header.height, 2);
+    EXPECT_EQ(checkpoint.header.parity, 1u);
+    EXPECT_EQ(checkpoint.header.step, 1234u);
+    EXPECT_FLOAT_EQ(checkpoint.header.tau, 0.6f);
+    EXPECT_EQ(checkpoint.header.payloadBytes, 32u);
+    EXPECT_EQ(checkpoint.payload, makeCheckpoint(1234).payload);
+    std::remove(path.c_str());
+}
+
+TEST(Checkpoint, RejectsOtherVersionsAndTruncatedFiles)
+{
+    auto const path = tempPath("checkpoint_invalid.bin");
+    auto checkpoint = makeCheckpoint(1);
+
+    checkpoint.header.version = app::simu::CheckpointHeader::currentVersion + 1;
+    app::simu::writeCheckpoint(path, checkpoint);
+    EXPECT_THROW((void)app::simu::readCheckpoint(path), std::runtime_error);
+
+    checkpoint.header.version = app::simu::CheckpointHeader::currentVersion;
+    app::simu::writeCheckpoint(path, checkpoint);
+    std::filesystem::resize_file(path, std::filesystem::file_size(path) - 1);
+    EXPECT_THROW((void)app::simu::readCheckpoint(path), std::runtime_error);
+
+    // A payload size far beyond the file is rejected before anything is allocated
+    checkpoint.header.payloadBytes = uint64_t{1} << 60;
+    {
+        auto file = std::ofstream(path, std::ios::binary | std::ios::trunc);
+        file.write(reinterpret_cast<char const*>(&checkpoint.header), sizeof(checkpoint.header));
+    }
+    EXPECT_THROW((void)app::simu::readCheckpoint(path), std::runtime_error);
+
+    {
+        auto file = std::ofstream(path, std::ios::binary | std::ios::trunc);
+        file << "not a checkpoint at all, just some text";
+    }
+    EXPECT_THROW((void)app::simu::readCheckpoint(path), std::runtime_error);
+    std::remove(path.c_str());
+}
+
+TEST(CheckpointWriter, KeepsTheLastSnapshot)
+{
+    auto const path = tempPath("checkpoint_writer.bin");
+    {
+        auto writer = app::simu::CheckpointWriter(path);
+        for(uint64_t step = 1; step <= 5; ++step)
+        {
+            writer.submit(makeCheckpoint(step));
+        }
+        writer.wait();
+        EXPECT_EQ(app::simu::readCheckpoint(path).header.step, 5u);
+
+        // The destructor flushes the snapshot still in flight
+        writer.submit(makeCheckpoint(6));
+    }
+    EXPECT_EQ(app::simu::readCheckpoint(path).header.step, 6u);
+    std::remove(path.c_str());
+}
+
+TEST(CheckpointWriter, ReportsFailedWrites)
+{
+    auto writer = app::simu::CheckpointWriter(tempPath("missing_directory/checkpoint.bin"));
+    writer.submit(makeCheckpoint(1));
+    EXPECT_THROW(writer.wait(), std::runtime_error);
+    // The error is reported once
+    EXPECT_NO_THROW(writer.wait());
+}
+
+TEST(Checkpoint, OnlyKernelsLeavingTheSameStateContinue)
+{
+    using app::simu::continuesWith;
+    constexpr auto multipass = params::SolverKernel::MultiPass;
+    constexpr auto fused = params::SolverKernel::Fused;
+    constexpr auto aa = params::SolverKernel::InPlaceAA;
+
+    auto const written = [](params::SolverKernel kernel, uint32_t parity) {
+        auto header = app::simu::CheckpointHeader{};
+        header.kernel = static_cast<uint32_t>(kernel);
+        header.parity = parity;
+        return header;
+    };
+
+    for(auto kernel : {multipass, fused, aa})
+    {
+        EXPECT_TRUE(continuesWith(written(kernel, 0), kernel));
+    }
+    EXPECT_TRUE(continuesWith(written(aa, 1), aa));
+    EXPECT_TRUE(continuesWith(written(fused, 0), aa));
+    EXPECT_TRUE(continuesWith(written(aa, 0), fused));
+    // Populations still swapped
+    EXPECT_FALSE(continuesWith(written(aa, 1), fused));
+    // Pre-collision against post-collision populations
+    EXPECT_FALSE(continuesWith(written(multipass, 0), fused));
+    EXPECT_FALSE(continuesWith(written(multipass, 0), aa));
+    EXPECT_FALSE(continuesWith(written(fused, 0), multipass));
+    EXPECT_FALSE(continuesWith(written(aa, 0), multipass));
+}
@@ -0,0 +1,99 @@
+#include "gtest/gtest.h"
+
+#include "rocket/cpusolver.h"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include <vector>
+
+namespace
+{
+using Config = params::Params::SimulationConfig;
+
+auto smallLattice() -> Config
+{
+    auto config = Config{};
+    config.gridWidth = 64;
+    config.gridHeight = 48;
+    config.cpuIsa = params::CpuIsa::Scalar;
+    config.cpuPinning = false;
+    return config;
+}
+
+// Velocity, density and population planes after the given steps
+auto run(Config const& config, uint64_t steps) -> std::vector<float>
+{
+    auto solver = app::simu::CpuSolver(config);
+    solver.simulate(steps);
+
+    auto fields = std::vector<float>{};
+    auto append = [&](std::span<float const> plane) {
+        fields.insert(fields.end(), plane.begin(), plane.end());
+    };
+    append(solver.getVelocityX());
+    append(solver.getVelocityY());
+    append(solver.getDensity());
+    for(size_t i = 0; i < 9; ++i)
+    {
+        append(solver.getDistribution(i));
+    }
+    return fields;
+}
+} // namespace
+
+// Every cell goes through the same row kernel with the same inputs whichever order the sweep
+// visits the rows in, so the blocked run matches the plain one bit for bit
+TEST(CpuSolver, TemporalBlockingMatchesSingleSteps)
+{
+    for(uint32_t threads : {2u, 3u, 4u})
+    {
+        auto config = smallLattice();
+        config.cpuThreads = threads;
+        config.cpuTemporalDepth = 1;
+        auto const reference = run(config, 10);
+
+        config.cpuTemporalDepth = 3;
+        // Ten steps end on a partial sweep
+        EXPECT_EQ(run(config, 10), reference) << threads << " threads";
+    }
+}
+
+// The vector rows run the scalar arithmetic lane by lane, only fused multiply-adds round
+// differently
+TEST(CpuSolver, VectorRowsMatchScalar)
+{
+    auto config = smallLattice();
+    config.cpuThreads = 1;
+    auto const reference = run(config, 5);
+
+    auto tested = 0;
+    for(auto isa : {params::CpuIsa::Avx2, params::CpuIsa::Avx512})
+    {
+        try
+        {
+            config.cpuIsa = app::simu::cpu::resolveIsa(isa);
+        }
+        catch(std::runtime_error const&)
+        {
+            continue; // Not supported by this processor
+        }
+        ++tested;
+
+        auto const fields = run(config, 5);
+        ASSERT_EQ(fields.size(), reference.size());
+        for(size_t i = 0; i < fields.size(); ++i)
+        {
+            auto const same = std::isnan(reference[i])
+                                      ? std::isnan(fields[i])
+                                      : std::abs(reference[i] - fields[i])
+                                                <= 1e-5f * std::max(1.0f, std::abs(reference[i]));
+            ASSERT_TRUE(same) << app::simu::cpu::isaName(isa) << " value " << i << ": scalar "
+                              << reference[i] << ", vector " << fields[i];
+        }
+    }
+    if(tested == 0)
+    {
+        GTEST_SKIP() << "No vector instruction set on this processor";
+    }
+}
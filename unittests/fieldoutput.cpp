@@ -0,0 +1,293 @@
+#include "gtest/gtest.h"
+
+#include "rocket/fieldoutput.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace
+{
+auto tempPath(std::string const& name) -> std::string
+{
+    return (std::filesystem::temp_directory_path() / name).string();
+}
+
+auto makeSnapshot() -> app::simu::FieldSnapshot
+{
+    auto snapshot = app::simu::FieldSnapshot{};
+    snapshot.step = 42;
+    snapshot.width = 2;
+    snapshot.height = 1;
+    snapshot.velocityX = {0.5f, -0.25f};
+    snapshot.velocityY = {0.0f, 0.125f};
+    snapshot.density = {1.0f, 0.75f};
+    return snapshot;
+}
+
+// Smooth flow on a grid that is not a multiple of the tile size
+auto makeFlow(int width, int height) -> app::simu::FieldSnapshot
+{
+    auto snapshot = app::simu::FieldSnapshot{};
+    snapshot.width = width;
+    snapshot.height = height;
+    for(int y = 0; y < height; ++y)
+    {
+        for(int x = 0; x < width; ++x)
+        {
+            snapshot.velocityX.push_back(0.1f * std::sin(0.2f * static_cast<float>(x + y)));
+            snapshot.velocityY.push_back(-0.05f * std::cos(0.3f * static_cast<float>(y)));
+            snapshot.density.push_back(1.0f + 0.01f * static_cast<float>(x % 7));
+        }
+    }
+    return snapshot;
+}
+} // namespace
+
+TEST(FieldOutput, CsvHasTheColumnsOfVisualPy)
+{
+    auto const path = tempPath("fields.csv");
+    app::simu::writeFieldCsv(path, makeSnapshot());
+
+    auto file = std::ifstream(path);
+    auto line = std::string{};
+    std::getline(file, line);
+    EXPECT_EQ(line, "Element,data.velocity.x,data.velocity.y,data.density");
+    std::getline(file, line);
+    EXPECT_EQ(line, "0,0.5,0,1");
+    std::getline(file, line);
+    EXPECT_EQ(line, "1,-0.25,0.125,0.75");
+    EXPECT_FALSE(std::getline(file, line));
+    std::remove(path.c_str());
+}
+
+TEST(FieldOutput, HalfConversion)
+{
+    using app::simu::fromHalf;
+    using app::simu::toHalf;
+
+    EXPECT_EQ(toHalf(0.0f), 0x0000);
+    EXPECT_EQ(toHalf(-0.0f), 0x8000);
+    EXPECT_EQ(toHalf(1.0f), 0x3c00);
+    EXPECT_EQ(toHalf(-2.0f), 0xc000);
+    EXPECT_EQ(toHalf(65504.0f), 0x7bff);
+    // Ties round to the even mantissa
+    EXPECT_EQ(toHalf(1.0f + 1.0f / 2048.0f), 0x3c00);
+    EXPECT_EQ(toHalf(1.0f + 3.0f / 2048.0f), 0x3c02);
+    // Overflow, smallest subnormal and underflow
+    EXPECT_EQ(toHalf(65520.0f), 0x7c00);
+    EXPECT_EQ(toHalf(5.9604645e-8f), 0x0001);
+    EXPECT_EQ(toHalf(2.0e-8f), 0x0000);
+
+    for(float value : {0.5f, -0.125f, 1.0f / 3.0f, 0.0173f, 1.25e-6f, 1000.0f})
+    {
+        EXPECT_NEAR(fromHalf(toHalf(value)), value, std::abs(value) / 1024.0f + 6e-8f);
+    }
+}
+
+TEST(FieldOutput, VorticityOfSolidRotation)
+{
+    // u = (-y, x) turns at a rate of one, its vorticity is two everywhere
+    auto snapshot = app::simu::FieldSnapshot{};
+    snapshot.width = 5;
+    snapshot.height = 4;
+    for(int y = 0; y < snapshot.height; ++y)
+    {
+        for(int x = 0; x < snapshot.width; ++x)
+        {
+            snapshot.velocityX.push_back(-static_cast<float>(y));
+            snapshot.velocityY.push_back(static_cast<float>(x));
+            snapshot.density.push_back(1.0f);
+        }
+    }
+    for(auto const value : app::simu::vorticity(snapshot))
+    {
+        EXPECT_FLOAT_EQ(value, 2.0f);
+    }
+}
+
+TEST(FieldOutput, SeriesAppendsWholeFrames)
+{
+    auto const path = tempPath("fields.series");
+    std::remove(path.c_str());
+    auto snapshot = makeSnapshot();
+
+    auto frameBytes = uint64_t{0};
+    {
+        auto writer = app::simu::FieldSeriesWriter(path, 2, 1, app::simu::FieldEncoding::Half);
+        writer.append(snapshot);
+        frameBytes = writer.header().frameBytes;
+        EXPECT_EQ(frameBytes % 16, 0u);
+    }
+
+    // A torn frame is dropped and the series continued by a restart
+    {
+        auto file = std::ofstream(path, std::ios::binary | std::ios::app);
+        file << "torn";
+    }
+    {
+        auto writer =
+                app::simu::FieldSeriesWriter(path, 2, 1, app::simu::FieldEncoding::Half, 42);
+        EXPECT_EQ(writer.frames(), 1u);
+        snapshot.step = 43;
+        writer.append(snapshot);
+    }
+    EXPECT_EQ(std::filesystem::file_size(path), 64 + 2 * frameBytes);
+
+    auto file = std::ifstream(path, std::ios::binary);
+    auto header = app::simu::FieldSeriesHeader{};
+    file.read(reinterpret_cast<char*>(&header), sizeof(header));
+    EXPECT_EQ(header.magic, app::simu::FieldSeriesHeader::expectedMagic);
+    EXPECT_EQ(header.valueBytes, 2u);
+
+    file.seekg(static_cast<std::streamoff>(64 + frameBytes));
+    auto frame = app::simu::FieldFrameHeader{};
+    file.read(reinterpret_cast<char*>(&frame), sizeof(frame));
+    EXPECT_EQ(frame.magic, app::simu::FieldFrameHeader::expectedMagic);
+    EXPECT_EQ(frame.step, 43u);
+
+    // Velocity x, velocity y, density, then vorticity
+    auto values = std::array<uint16_t, 8>{};
+    file.read(reinterpret_cast<char*>(values.data()), sizeof(values));
+    EXPECT_EQ(app::simu::fromHalf(values[0]), 0.5f);
+    EXPECT_EQ(app::simu::fromHalf(values[3]), 0.125f);
+    EXPECT_EQ(app::simu::fromHalf(values[5]), 0.75f);
+    EXPECT_EQ(app::simu::fromHalf(values[6]), 0.125f);
+    std::remove(path.c_str());
+
+    // Another precision starts over
+    {
+        auto writer = app::simu::FieldSeriesWriter(path, 2, 1, app::simu::FieldEncoding::Float);
+        EXPECT_EQ(writer.frames(), 0u);
+    }
+    EXPECT_EQ(std::filesystem::file_size(path), 64u);
+    std::remove(path.c_str());
+}
+
+TEST(FieldOutput, SeriesIsContinuedOnlyUpToTheRestartStep)
+{
+    auto const path = tempPath("restart.series");
+    std::remove(path.c_str());
+    auto snapshot = makeSnapshot();
+
+    auto frameBytes = uint64_t{0};
+    {
+        auto writer = app::simu::FieldSeriesWriter(path, 2, 1, app::simu::FieldEncoding::Float);
+        for(uint64_t step : {10, 20, 30})
+        {
+            snapshot.step = step;
+            writer.append(snapshot);
+        }
+        frameBytes = writer.header().frameBytes;
+    }
+
+    // The checkpoint was taken at step 20, the frame of step 30 is run again
+    {
+        auto writer =
+                app::simu::FieldSeriesWriter(path, 2, 1, app::simu::FieldEncoding::Float, 20);
+        EXPECT_EQ(writer.frames(), 2u);
+    }
+    EXPECT_EQ(std::filesystem::file_size(path), 64 + 2 * frameBytes);
+
+    // A fresh run starts over
+    {
+        auto writer = app::simu::FieldSeriesWriter(path, 2, 1, app::simu::FieldEncoding::Float);
+        EXPECT_EQ(writer.frames(), 0u);
+    }
+    EXPECT_EQ(std::filesystem::file_size(path), 64u);
+    std::remove(path.c_str());
+}
+
+TEST(FieldOutput, QuantizedFieldsStayWithinTheBound)
+{
+    using app::simu::QuantizedFrameHeader;
+    constexpr auto bound = 1e-3f;
+
+    auto snapshot = makeFlow(37, 21);
+    // A tile too wide for 31 bits keeps its floats
+    snapshot.density[5] = 1e30f;
+
+    auto const frame = app::simu::quantizeFields(snapshot, 16, 8, bound);
+    auto header = QuantizedFrameHeader{};
+    std::memcpy(reinterpret_cast<char*>(&header), frame.data(), sizeof(header));
+    EXPECT_EQ(header.frameWords, frame.size());
+    EXPECT_EQ(header.tilesX, 3u);
+    EXPECT_EQ(header.tilesY, 3u);
+    EXPECT_LT(frame.size(), 3u * 37u * 21u / 2u);
+
+    auto const decoded = app::simu::dequantizeFields(frame, 37, 21, 7);
+    EXPECT_EQ(decoded.step, 7u);
+    EXPECT_EQ(decoded.density[5], 1e30f);
+
+    auto const original = std::array{&snapshot.velocityX, &snapshot.velocityY, &snapshot.density};
+    auto const restored = std::array{&decoded.velocityX, &decoded.velocityY, &decoded.density};
+    for(size_t p = 0; p < original.size(); ++p)
+    {
+        auto maxError = 0.0f;
+        for(size_t i = 0; i < original[p]->size(); ++i)
+        {
+            maxError = std::max(maxError, std::abs((*original[p])[i] - (*restored[p])[i]));
+        }
+        EXPECT_LE(maxError, bound * 1.001f);
+        EXPECT_FLOAT_EQ(header.maxError[p], maxError);
+    }
+
+    // Cut short or for another grid
+    auto const truncated = std::span(frame).first(frame.size() - 1);
+    EXPECT_THROW((void)app::simu::dequantizeFields(truncated, 37, 21, 7), std::runtime_error);
+    EXPECT_THROW((void)app::simu::dequantizeFields(frame, 64, 21, 7), std::runtime_error);
+}
+
+TEST(FieldOutput, QuantizedSeriesStepsOverFramesOfAnySize)
+{
+    auto const path = tempPath("quantized.series");
+    std::remove(path.c_str());
+    auto const flat = app::simu::quantizeFields(makeSnapshot(), 16, 16, 1e-3f);
+    auto const flow = app::simu::quantizeFields(makeFlow(2, 1), 16, 16, 1e-6f);
+    ASSERT_NE(flat.size(), flow.size());
+
+    auto bytes = uint64_t{64};
+    {
+        auto writer = app::simu::FieldSeriesWriter(path, 2, 1, app::simu::FieldEncoding::Quantized);
+        EXPECT_EQ(writer.header().frameBytes, 0u);
+        EXPECT_THROW(writer.append(makeSnapshot()), std::invalid_argument);
+        writer.append(1, flat);
+        writer.append(2, flow);
+        for(auto const* frame : {&flat, &flow})
+        {
+            bytes += 16 + (frame->size() * 4 + 15) / 16 * 16;
+        }
+    }
+    EXPECT_EQ(std::filesystem::file_size(path), bytes);
+
+    // A torn frame is dropped and the series continued by a restart
+    {
+        auto file = std::ofstream(path, std::ios::binary | std::ios::app);
+        file << "FRAM torn";
+    }
+    {
+        auto writer = app::simu::FieldSeriesWriter(
+                path, 2, 1, app::simu::FieldEncoding::Quantized, 2);
+        EXPECT_EQ(writer.frames(), 2u);
+        writer.append(3, flat);
+    }
+    EXPECT_EQ(std::filesystem::file_size(path), bytes + 16 + (flat.size() * 4 + 15) / 16 * 16);
+
+    auto file = std::ifstream(path, std::ios::binary);
+    file.seekg(static_cast<std::streamoff>(bytes));
+    auto frame = app::simu::FieldFrameHeader{};
+    file.read(reinterpret_cast<char*>(&frame), sizeof(frame));
+    EXPECT_EQ(frame.step, 3u);
+    auto words = std::vector<uint32_t>(flat.size());
+    file.read(reinterpret_cast<char*>(words.data()), static_cast<std::streamsize>(flat.size() * 4));
+    EXPECT_EQ(words, flat);
+    std::remove(path.c_str());
+}
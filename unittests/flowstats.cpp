@@ -0,0 +1,80 @@
+#include "gtest/gtest.h"
+
+#include "rocket/flowstats.h"
+
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+namespace
+{
+auto readLines(std::string const& path) -> std::vector<std::string>
+{
+    auto file = std::ifstream(path);
+    auto lines = std::vector<std::string>{};
+    for(auto line = std::string{}; std::getline(file, line);)
+    {
+        lines.push_back(line);
+    }
+    return lines;
+}
+} // namespace
+
+TEST(FlowStats, ForceCoefficient)
+{
+    // Half the dynamic pressure times the diameter
+    EXPECT_FLOAT_EQ(app::simu::forceCoefficient(4.0f, 1.0f, 2.0f, 1.0f), 2.0f);
+    EXPECT_FLOAT_EQ(app::simu::forceCoefficient(-1.0f, 2.0f, 0.5f, 8.0f), -0.5f);
+}
+
+TEST(FlowStats, HistoryIsContinuedAfterARestart)
+{
+    auto const path = (std::filesystem::temp_directory_path() / "stats.csv").string();
+    std::remove(path.c_str());
+
+    auto statistics = app::simu::FlowStatistics{};
+    statistics.mass = 100.0f;
+    statistics.forceX = 2.0f;
+    statistics.forceY = -1.0f;
+    {
+        auto writer = app::simu::FlowStatsWriter(path, 1.0f, 4.0f);
+        writer.append(10, statistics);
+        writer.append(20, statistics);
+    }
+    { // The checkpoint was taken at step 10, the sample of step 20 is run again
+        auto writer = app::simu::FlowStatsWriter(path, 1.0f, 4.0f, 10);
+        writer.append(20, statistics);
+    }
+
+    auto const lines = readLines(path);
+    ASSERT_EQ(lines.size(), 3u);
+    EXPECT_EQ(lines[0].rfind("step,mass,kinetic_energy,force_x,force_y,drag_coefficient", 0), 0u);
+    EXPECT_EQ(lines[1], "10,100,0,2,-1,1,-0.5,0,0,0");
+    EXPECT_EQ(lines[2].rfind("20,", 0), 0u);
+    std::remove(path.c_str());
+}
+
+TEST(FlowStats, FreshRunReplacesTheHistory)
+{
+    auto const path = (std::filesystem::temp_directory_path() / "stats_fresh.csv").string();
+    std::remove(path.c_str());
+
+    auto statistics = app::simu::FlowStatistics{};
+    {
+        auto writer = app::simu::FlowStatsWriter(path, 1.0f, 4.0f);
+        writer.append(10, statistics);
+        writer.append(20, statistics);
+    }
+    {
+        auto writer = app::simu::FlowStatsWriter(path, 1.0f, 4.0f);
+        writer.append(5, statistics);
+    }
+
+    auto const lines = readLines(path);
+    ASSERT_EQ(lines.size(), 2u);
+    EXPECT_EQ(lines[0].rfind("step,", 0), 0u);
+    EXPECT_EQ(lines[1].rfind("5,", 0), 0u);
+    std::remove(path.c_str());
+}
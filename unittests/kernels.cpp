@@ -0,0 +1,151 @@
+#include "gtest/gtest.h"
+
+#include "common/appcontext.h"
+#include "core/vulkan/context.h"
+#include "rocket/cpusolver.h"
+#include "rocket/fieldoutput.h"
+
+#include <algorithm>
+#include <cmath>
+#include <exception>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace
+{
+constexpr size_t gridWidth = 48;
+constexpr size_t gridHeight = 32;
+// Even, the AA lattice is back in its natural order
+constexpr uint64_t steps = 16;
+
+auto smallLattice() -> params::Params
+{
+    auto parameters = params::Params{};
+    parameters.simulationConfig.gridWidth = static_cast<int>(gridWidth);
+    parameters.simulationConfig.gridHeight = static_cast<int>(gridHeight);
+    return parameters;
+}
+
+auto tempPath(std::string const& name) -> std::string
+{
+    return (std::filesystem::temp_directory_path() / name).string();
+}
+
+// Velocity and density planes of the single frame the run leaves in its float series
+auto runGpu(params::SolverKernel kernel, params::LatticeLayout layout, std::string const& series)
+        -> std::vector<float>
+{
+    std::filesystem::remove(series);
+
+    auto parameters = smallLattice();
+    auto& config = parameters.simulationConfig;
+    config.kernel = kernel;
+    config.layout = layout;
+    config.outputInterval = static_cast<uint32_t>(steps);
+    config.outputSeries = series;
+    config.outputPrecision = params::OutputPrecision::Float;
+    {
+        auto appContext = std::make_shared<app::AppContext>(parameters);
+        auto context = app::vk::Context(appContext);
+        context.initHeadless();
+        context.simulate(steps);
+    } // The readback is drained before the solver goes away
+
+    auto file = std::ifstream(series, std::ios::binary);
+    auto header = app::simu::FieldSeriesHeader{};
+    file.read(reinterpret_cast<char*>(&header), sizeof(header));
+    auto frame = app::simu::FieldFrameHeader{};
+    file.seekg(header.headerBytes);
+    file.read(reinterpret_cast<char*>(&frame), sizeof(frame));
+    EXPECT_EQ(frame.step, steps);
+
+    auto planes = std::vector<float>(3 * gridWidth * gridHeight);
+    file.read(
+            reinterpret_cast<char*>(planes.data()),
+            static_cast<std::streamsize>(planes.size() * sizeof(float)));
+    EXPECT_TRUE(file) << series << " holds no whole frame";
+    return planes;
+}
+
+// The same planes from the host backend, stepped with the scalar rows
+auto runCpu() -> std::vector<float>
+{
+    auto config = smallLattice().simulationConfig;
+    config.backend = params::SolverBackend::Cpu;
+    config.cpuIsa = params::CpuIsa::Scalar;
+    config.cpuPinning = false;
+
+    auto solver = app::simu::CpuSolver(config);
+    solver.simulate(steps);
+
+    auto planes = std::vector<float>{};
+    for(auto plane : {solver.getVelocityX(), solver.getVelocityY(), solver.getDensity()})
+    {
+        planes.insert(planes.end(), plane.begin(), plane.end());
+    }
+    return planes;
+}
+
+// Both runs take the same steps from the same values, NaN from an unstable inlet included
+auto expectSameFields(
+        std::vector<float> const& fused,
+        std::vector<float> const& other,
+        float tolerance,
+        char const* name) -> void
+{
+    ASSERT_EQ(fused.size(), other.size());
+    for(size_t i = 0; i < fused.size(); ++i)
+    {
+        auto const same = std::isnan(fused[i])
+                                  ? std::isnan(other[i])
+                                  : std::abs(fused[i] - other[i])
+                                            <= tolerance * std::max(1.0f, std::abs(fused[i]));
+        ASSERT_TRUE(same) << "plane " << i / (gridWidth * gridHeight) << ", cell "
+                          << i % (gridWidth * gridHeight) << ": fused " << fused[i] << ", "
+                          << name << " " << other[i];
+    }
+}
+} // namespace
+
+// The in-place AA kernel streams over one lattice with other slots than the fused kernel, but
+// takes the same values from the domain edges, so both end up with the same fields
+TEST(LatticeKernels, InPlaceAAMatchesFused)
+{
+    for(auto layout : {params::LatticeLayout::AoS, params::LatticeLayout::SoA})
+    {
+        auto fused = std::vector<float>{};
+        auto aa = std::vector<float>{};
+        try
+        {
+            fused = runGpu(params::SolverKernel::Fused, layout, tempPath("kernels_fused.series"));
+            aa = runGpu(params::SolverKernel::InPlaceAA, layout, tempPath("kernels_aa.series"));
+        }
+        catch(std::exception const& e)
+        {
+            GTEST_SKIP() << "No Vulkan device to run the kernels on: " << e.what();
+        }
+
+        expectSameFields(fused, aa, 1e-5f, "aa");
+    }
+}
+
+// The host backend is the reference the shaders are debugged against. Its scalar rows round
+// differently from the shader, so the fields only agree to a looser tolerance.
+TEST(LatticeKernels, CpuMatchesFused)
+{
+    auto fused = std::vector<float>{};
+    try
+    {
+        auto const series = tempPath("kernels_cpu.series");
+        fused = runGpu(params::SolverKernel::Fused, params::LatticeLayout::SoA, series);
+    }
+    catch(std::exception const& e)
+    {
+        GTEST_SKIP() << "No Vulkan device to run the kernels on: " << e.what();
+    }
+
+    expectSameFields(fused, runCpu(), 1e-4f, "cpu");
+}
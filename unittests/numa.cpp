@@ -0,0 +1,75 @@
+#include "gtest/gtest.h"
+
+#include "utils/numa.h"
+#include "utils/threadpool.h"
+
+#include <algorithm>
+
+#include <sched.h>
+
+TEST(NumaTopology, ParseCpuList)
+{
+    auto const cpus = utils::parseCpuList("0-3,8,10-11\n");
+    EXPECT_EQ(cpus, (std::vector<int>{0, 1, 2, 3, 8, 10, 11}));
+    EXPECT_TRUE(utils::parseCpuList("").empty());
+}
+
+TEST(NumaTopology, PlacementSpreadsOverNodes)
+{
+    auto topology = utils::NumaTopology{};
+    topology.nodes.push_back({0, {0, 1, 2, 3}, 0});
+    topology.nodes.push_back({1, {4, 5, 6, 7}, 0});
+
+    // Contiguous halves, one per node
+    EXPECT_EQ(topology.placement(4), (std::vector<int>{0, 1, 4, 5}));
+    EXPECT_EQ(topology.placement(8), (std::vector<int>{0, 1, 2, 3, 4, 5, 6, 7}));
+    // Oversubscribed nodes wrap around
+    EXPECT_EQ(topology.placement(10), (std::vector<int>{0, 1, 2, 3, 0, 4, 5, 6, 7, 4}));
+    EXPECT_EQ(topology.nodeOf(5), 1);
+    EXPECT_EQ(topology.nodeOf(9), -1);
+}
+
+TEST(ThreadPool, RangesCoverEveryItemOnce)
+{
+    for(uint32_t workers : {1u, 3u, 7u})
+    {
+        size_t next = 0;
+        for(uint32_t w = 0; w < workers; ++w)
+        {
+            auto const [begin, end] = utils::ThreadPool::range(100, w, workers);
+            EXPECT_EQ(begin, next);
+            next = end;
+        }
+        EXPECT_EQ(next, 100u);
+    }
+
+    auto pool = utils::ThreadPool(4);
+    auto hits = std::vector<int>(1000, 0);
+    pool.parallelFor(hits.size(), [&](size_t begin, size_t end, uint32_t) {
+        for(auto i = begin; i < end; ++i)
+        {
+            ++hits[i];
+        }
+    });
+    EXPECT_EQ(std::count(hits.begin(), hits.end(), 1), 1000);
+}
+
+TEST(ThreadPool, CallerAffinityIsRestored)
+{
+    auto const before = utils::NumaTopology::detect().cpuCount();
+    cpu_set_t mask;
+    CPU_ZERO(&mask);
+    ASSERT_EQ(sched_getaffinity(0, sizeof(mask), &mask), 0);
+
+    {
+        // Pins the calling thread as worker 0
+        auto pool = utils::ThreadPool(2, utils::NumaTopology::detect().placement(2));
+        pool.parallelFor(2, [](size_t, size_t, uint32_t) {});
+    }
+
+    cpu_set_t after;
+    CPU_ZERO(&after);
+    ASSERT_EQ(sched_getaffinity(0, sizeof(after), &after), 0);
+    EXPECT_TRUE(CPU_EQUAL(&mask, &after));
+    EXPECT_EQ(utils::NumaTopology::detect().cpuCount(), before);
+}
@@ -1,34 +1,71 @@
-import pandas as pd
+import sys
+
 import matplotlib.pyplot as plt
+import numpy as np
+
+# A field series written by the solver (outputseries), or a data.csv dump (outputcsv)
+path = sys.argv[1] if len(sys.argv) > 1 else 'data.csv'
+
+
+def plot_csv(path):
+    import pandas as pd
+
+    # Read the CSV data
+    data = pd.read_csv(path, skipinitialspace=True)
+
+    # Plot the data
+    plt.figure(figsize=(10, 8))
+
+    plt.subplot(2, 2, 1)
+    plt.plot(data['Element'], data['data.velocity.x'], label='Velocity X')
+    plt.plot(data['Element'], data['data.velocity.y'], label='Velocity Y')
+    plt.title('Velocity')
+    plt.legend()
+
+    plt.subplot(2, 2, 2)
+    # plt.plot(data['Element'], data['data.externalForce.x'], label='External Force X')
+    # plt.plot(data['Element'], data['data.externalForce.y'], label='External Force Y')
+    plt.title('External Force')
+    plt.legend()
+
+    plt.subplot(2, 2, 3)
+    # plt.plot(data['Element'], data['data.pressure'], label='Pressure')
+    plt.plot(data['Element'], data['data.density'], label='Density')
+    plt.title('Pressure and Density')
+    plt.legend()
+
+    plt.subplot(2, 2, 4)
+    # plt.plot(data['Element'], data['data.temperature'], label='Temperature')
+    plt.title('Temperature')
+    plt.legend()
+
+
+def plot_series(path):
+    from fieldseries import FieldSeries
+
+    # Last frame of the series, only its pages are read from disk
+    series = FieldSeries(path)
+    if len(series) == 0:
+        sys.exit(f'{path} has no frames yet')
+    frame = series.frame(-1)
+    speed = np.hypot(frame['velocity_x'].astype(np.float32), frame['velocity_y'].astype(np.float32))
+
+    plt.figure(figsize=(10, 8))
+    plt.suptitle(f'Step {series.steps[-1]}, frame {len(series)}')
+    for i, (title, plane, cmap) in enumerate([
+            ('Velocity magnitude', speed, 'viridis'),
+            ('Density', frame['density'], 'viridis'),
+            ('Vorticity', frame['vorticity'], 'RdBu_r')]):
+        plt.subplot(3, 1, i + 1)
+        plt.imshow(plane.astype(np.float32), origin='lower', cmap=cmap)
+        plt.title(title)
+        plt.colorbar()
+
 
-# Read the CSV data
-data = pd.read_csv('data.csv', skipinitialspace=True)
-
-# Plot the data
-plt.figure(figsize=(10, 8))
-
-plt.subplot(2, 2, 1)
-plt.plot(data['Element'], data['data.velocity.x'], label='Velocity X')
-plt.plot(data['Element'], data['data.velocity.y'], label='Velocity Y')
-plt.title('Velocity')
-plt.legend()
-
-plt.subplot(2, 2, 2)
-# plt.plot(data['Element'], data['data.externalForce.x'], label='External Force X')
-# plt.plot(data['Element'], data['data.externalForce.y'], label='External Force Y')
-plt.title('External Force')
-plt.legend()
-
-plt.subplot(2, 2, 3)
-# plt.plot(data['Element'], data['data.pressure'], label='Pressure')
-plt.plot(data['Element'], data['data.density'], label='Density')
-plt.title('Pressure and Density')
-plt.legend()
-
-plt.subplot(2, 2, 4)
-# plt.plot(data['Element'], data['data.temperature'], label='Temperature')
-plt.title('Temperature')
-plt.legend()
+if path.endswith('.csv'):
+    plot_csv(path)
+else:
+    plot_series(path)
 
 plt.tight_layout()
 plt.show()